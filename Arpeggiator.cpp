@@ -0,0 +1,133 @@
+#include "Arpeggiator.h"
+#include "Synthesizer.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+
+void Arpeggiator::noteOn(int note) {
+    for (int i = 0; i < numHeld; ++i) {
+        if (held[i] == note) return;
+    }
+    if (numHeld == MAX_HELD) return;
+    held[numHeld++] = note;
+    patternDirty = true;
+    if (!running) {
+        // First held note: the first step starts on this very frame
+        running = true;
+        startPending = true;
+        stepIndex = 0;
+        hitIndex = 0;
+        nextHitAt = 0;
+        schedule();
+    }
+}
+
+void Arpeggiator::noteOff(int note, bool hold) {
+    if (hold) return;
+    int keep = 0;
+    for (int i = 0; i < numHeld; ++i) {
+        if (held[i] != note) held[keep++] = held[i];
+    }
+    if (keep == numHeld) return;
+    numHeld = keep;
+    patternDirty = true;
+    if (numHeld == 0) {
+        // Nothing left to arpeggiate: stop the playing note right away
+        running = false;
+        if (activeNote >= 0) noteOffAt = 0;
+        schedule();
+    }
+}
+
+void Arpeggiator::reset() {
+    numHeld = 0;
+    patternDirty = true;
+    running = false;
+    activeNote = -1;
+    noteOffAt = IDLE;
+    schedule();
+}
+
+void Arpeggiator::process(Synthesizer& synth, int64_t now) {
+    if (!synth.arpEnabled) {
+        // Switched off (e.g. by a preset): let go of everything, like the GUI toggle does
+        if (activeNote >= 0) stopNote(synth);
+        reset();
+        return;
+    }
+    if (activeNote >= 0 && now >= noteOffAt) stopNote(synth);
+
+    if (running && now >= nextHitAt) {
+        int ratchet = std::clamp(synth.arpRatchet, 1, 4);
+        if (hitIndex == 0) {
+            // New step. Swing lengthens even steps and shortens odd ones, so pairs keep the tempo.
+            stepStart = startPending ? now : nextHitAt;
+            startPending = false;
+            double base = SAMPLE_RATE * 60.0 / std::max(1.0f, synth.arpBpm) / 4.0; // 16th notes
+            float swing = std::clamp(synth.arpSwing, 0.0f, 0.5f);
+            stepLength = std::max<int64_t>(ratchet, std::llround(base * (stepIndex % 2 == 0 ? 1.0f + swing : 1.0f - swing)));
+            currentNote = nextNote(synth.arpDirection, std::clamp(synth.arpRange, 1, MAX_RANGE));
+            ++stepIndex;
+        }
+
+        // Ratchets split the step into equal hits of the same note
+        int64_t hitStart = stepStart + hitIndex * stepLength / ratchet;
+        int64_t hitLength = stepLength / ratchet;
+        if (activeNote >= 0) stopNote(synth);
+        if (currentNote >= 0 && synth.noteOn(0, currentNote, 0.8f) >= 0) { // Fixed velocity for now
+            activeNote = currentNote;
+            noteOffAt = hitStart + std::max<int64_t>(1, std::llround(hitLength * std::clamp(synth.arpGate, 0.01f, 1.0f)));
+        }
+        if (++hitIndex >= ratchet) {
+            hitIndex = 0;
+            nextHitAt = stepStart + stepLength;
+        } else {
+            nextHitAt = stepStart + hitIndex * stepLength / ratchet;
+        }
+    }
+    schedule();
+}
+
+void Arpeggiator::rebuildPattern(int direction, int range) {
+    int sorted[MAX_HELD];
+    std::copy(held, held + numHeld, sorted);
+    std::sort(sorted, sorted + numHeld);
+
+    patternSize = 0;
+    for (int r = 0; r < range; ++r) {
+        for (int i = 0; i < numHeld; ++i) {
+            if (sorted[i] + r * 12 <= 127) pattern[patternSize++] = sorted[i] + r * 12;
+        }
+    }
+    if (direction == 1) { // Down
+        std::reverse(pattern, pattern + patternSize);
+    } else if (direction == 2) { // Up-Down, without repeating the top and bottom notes
+        int upSize = patternSize;
+        for (int i = upSize - 2; i > 0; --i) pattern[patternSize++] = pattern[i];
+    }
+    patternDirty = false;
+    patternDirection = direction;
+    patternRange = range;
+}
+
+int Arpeggiator::nextNote(int direction, int range) {
+    if (patternDirty || direction != patternDirection || range != patternRange) rebuildPattern(direction, range);
+    if (patternSize == 0) return -1;
+    if (direction == 3) { // Random
+        rngState ^= rngState << 13;
+        rngState ^= rngState >> 17;
+        rngState ^= rngState << 5;
+        return pattern[rngState % patternSize];
+    }
+    return pattern[stepIndex % patternSize];
+}
+
+void Arpeggiator::stopNote(Synthesizer& synth) {
+    synth.voiceAllocator.noteOff(0, activeNote);
+    activeNote = -1;
+    noteOffAt = IDLE;
+}
+
+void Arpeggiator::schedule() {
+    nextEventAt = std::min(activeNote >= 0 ? noteOffAt : IDLE, running ? nextHitAt : IDLE);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+struct Synthesizer;
+
+// Arpeggiator driven by the render loop's sample clock. Held notes come in through noteOn/noteOff
+// (the MIDI handler, on the exact frame), and process() starts and stops the arpeggiated notes on
+// the frame they are due, so steps, swing and ratchets are exact to the sample.
+// The parameters (rate, gate, direction, range, hold, swing, ratchet) live in Synthesizer.
+// No allocation: held notes and the pattern are fixed arrays, and the pattern is only rebuilt when
+// the held notes, the direction or the range change.
+class Arpeggiator {
+public:
+    static constexpr int MAX_HELD = 32;
+    static constexpr int MAX_RANGE = 4;
+    static constexpr int64_t IDLE = INT64_MAX;
+
+    void noteOn(int note);
+    void noteOff(int note, bool hold);
+
+    // Forget held notes and the playing note (for after allNotesOff())
+    void reset();
+    // Start the random direction's sequence over from seed
+    void seed(uint32_t seed) { rngState = seed ? seed : 0x9E3779B9u; } // xorshift never leaves 0
+
+    // Sample position of the next note on/off, IDLE if nothing is scheduled
+    int64_t nextEvent() const { return nextEventAt; }
+
+    // Render loop: handle everything due at sample position now
+    void process(Synthesizer& synth, int64_t now);
+
+    int heldCount() const { return numHeld; }
+
+private:
+    void rebuildPattern(int direction, int range);
+    int nextNote(int direction, int range);
+    void stopNote(Synthesizer& synth);
+    void schedule();
+
+    int held[MAX_HELD];
+    int numHeld = 0;
+    bool patternDirty = true;
+    int patternDirection = -1;
+    int patternRange = -1;
+    int pattern[MAX_HELD * MAX_RANGE * 2]; // up-down plays the pattern forth and back
+    int patternSize = 0;
+
+    int stepIndex = 0;
+    int hitIndex = 0;            // ratchet repeat within the current step
+    bool running = false;
+    bool startPending = false;   // first step starts on the next process() call
+    int64_t stepStart = 0;
+    int64_t stepLength = 0;
+    int64_t nextHitAt = 0;
+    int64_t noteOffAt = IDLE;
+    int64_t nextEventAt = IDLE;
+    int activeNote = -1;
+    int currentNote = -1;        // note of the current step, repeated by ratchets
+    uint32_t rngState = 0x9E3779B9u;
+};
@@ -0,0 +1,152 @@
+#include "AudioOutput.h"
+#include "LockFree.h"
+#include "Log.h"
+#include "Utils.h"
+#include <algorithm>
+#include <string>
+
+namespace {
+
+const Uint64 SETTLE_MS = 500;              // glitches right after opening the device do not count
+const Uint64 UNDERRUN_WINDOW_MS = 5000;
+const int UNDERRUNS_TO_STEP_UP = 2;        // within the window
+const Uint64 CLEAN_MS = 10000;             // without underruns before trying the next smaller period
+const Uint64 FIRST_RETRY_HOLD_MS = 60000;
+const Uint64 MAX_RETRY_HOLD_MS = 600000;
+const int FRAME_BYTES = 2 * (int)sizeof(int16_t);
+
+} // namespace
+
+bool AudioOutput::open(int setting, SDL_AudioStreamCallback cb, void* data) {
+    callback = cb;
+    userdata = data;
+    periodSetting = setting;
+    if (setting == AUTO) {
+        periodIndex = autoIndex();
+        if (openStream(PERIODS[periodIndex])) return true;
+    } else if (openStream(setting)) {
+        return true;
+    }
+    if (setting == SDL_DEFAULT) return false;
+    LOG_WARN("Falling back to SDL's device period");
+    periodSetting = SDL_DEFAULT;
+    return openStream(0);
+}
+
+void AudioOutput::close() {
+    if (!stream) return;
+    SDL_DestroyAudioStream(stream); // waits for a callback in progress
+    stream = nullptr;
+}
+
+bool AudioOutput::openStream(int frames) {
+    close();
+    // Read when the physical device opens, which it does again once its last stream is gone
+    if (frames > 0) SDL_SetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES, std::to_string(frames).c_str());
+    else SDL_ResetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES);
+
+    SDL_AudioSpec spec;
+    SDL_zero(spec);
+    spec.freq = SAMPLE_RATE;
+    spec.format = SDL_AUDIO_S16LE;
+    spec.channels = 2; // stereo
+    stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, callback, userdata);
+    if (!stream) {
+        LOG_ERROR("Failed to open audio device stream: %s", SDL_GetError());
+        return false;
+    }
+
+    // The device opens paused, so the audio thread is not measuring yet
+    SDL_AudioSpec deviceSpec;
+    int deviceFrames = 0;
+    if (!SDL_GetAudioDeviceFormat(SDL_GetAudioStreamDevice(stream), &deviceSpec, &deviceFrames)) {
+        deviceSpec.freq = SAMPLE_RATE;
+        deviceFrames = 0;
+    }
+    devicePeriod.store(deviceFrames, std::memory_order_relaxed);
+    deviceRate.store(deviceSpec.freq > 0 ? deviceSpec.freq : SAMPLE_RATE, std::memory_order_relaxed);
+    lastCallbackNs = 0;
+    bufferedFrames = 0.0;
+    periodStartUnderruns.store(underruns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    openedMs = SDL_GetTicks();
+    recentUnderruns = 0;
+
+    if (!SDL_ResumeAudioStreamDevice(stream)) {
+        LOG_ERROR("Failed to resume audio device stream: %s", SDL_GetError());
+        close();
+        return false;
+    }
+    if (frames > 0) LOG_INFO("Audio device period: %d frames (%d requested)", deviceFrames, frames);
+    else LOG_INFO("Audio device period: %d frames (SDL default)", deviceFrames);
+    return true;
+}
+
+// The smallest period not on hold, starting from 256 frames
+int AudioOutput::autoIndex() const {
+    Uint64 now = SDL_GetTicks();
+    int index = 2;
+    while (index + 1 < NUM_PERIODS && now < retryAfterMs[index]) ++index;
+    return index;
+}
+
+void AudioOutput::poll(bool idle) {
+    if (!stream) return;
+    Uint64 now = SDL_GetTicks();
+    uint64_t total = underruns.load(std::memory_order_relaxed);
+    uint64_t fresh = total - seenUnderruns;
+    seenUnderruns = total;
+    if (periodSetting != AUTO || now - openedMs < SETTLE_MS) return;
+
+    if (fresh > 0) {
+        recentUnderruns = now - lastUnderrunMs <= UNDERRUN_WINDOW_MS ? recentUnderruns + (int)fresh : (int)fresh;
+        lastUnderrunMs = now;
+        if (recentUnderruns < UNDERRUNS_TO_STEP_UP || periodIndex + 1 >= NUM_PERIODS) return;
+        Uint64& hold = retryHoldMs[periodIndex];
+        hold = hold ? std::min(hold * 2, MAX_RETRY_HOLD_MS) : FIRST_RETRY_HOLD_MS;
+        retryAfterMs[periodIndex] = now + hold;
+        LOG_WARN("%d underruns at %d frames, raising the device period", recentUnderruns, PERIODS[periodIndex]);
+        ++periodIndex;
+    } else if (idle && periodIndex > 0 && now - std::max(openedMs, lastUnderrunMs) >= CLEAN_MS &&
+               now >= retryAfterMs[periodIndex - 1]) {
+        --periodIndex; // reopening while nothing sounds, so the gap is not heard
+    } else {
+        return;
+    }
+    if (!openStream(PERIODS[periodIndex])) {
+        LOG_WARN("Falling back to SDL's device period");
+        periodSetting = SDL_DEFAULT;
+        openStream(0);
+    }
+}
+
+void AudioOutput::measure(SDL_AudioStream* s, int numFrames, int sampleRate) {
+    Uint64 now = SDL_GetTicksNS();
+    int queued = std::max(0, SDL_GetAudioStreamQueued(s)) / FRAME_BYTES;
+    // One device period in stream frames; the device may run at another rate
+    double period = devicePeriod.load(std::memory_order_relaxed) * (double)sampleRate / deviceRate.load(std::memory_order_relaxed);
+    if (lastCallbackNs != 0) {
+        // The device played for the time since the previous callback; half a period of slack covers
+        // the jitter of its own thread
+        double played = (double)(now - lastCallbackNs) * 1e-9 * sampleRate;
+        if (played > bufferedFrames + 0.5 * period) bump(underruns);
+    }
+    lastCallbackNs = now;
+    bufferedFrames = queued + period;
+
+    blockFrames.store(numFrames, std::memory_order_relaxed);
+    queuedFrames.store(queued, std::memory_order_relaxed);
+    rate.store((float)sampleRate, std::memory_order_relaxed);
+}
+
+void AudioOutput::report(LatencyReport& out) const {
+    out.devicePeriod = devicePeriod.load(std::memory_order_relaxed);
+    out.blockFrames = blockFrames.load(std::memory_order_relaxed);
+    out.queuedFrames = queuedFrames.load(std::memory_order_relaxed);
+    float r = rate.load(std::memory_order_relaxed);
+    if (r > 0.0f) {
+        out.outputMs = out.queuedFrames * 1000.0f / r + out.devicePeriod * 1000.0f / deviceRate.load(std::memory_order_relaxed);
+        out.midiToSoundMs = out.outputMs + out.blockFrames * 1000.0f / r;
+    }
+    out.underruns = underruns.load(std::memory_order_relaxed);
+    out.periodUnderruns = out.underruns - periodStartUnderruns.load(std::memory_order_relaxed);
+}
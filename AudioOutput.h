@@ -0,0 +1,76 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <cstdint>
+
+// Output latency and glitches as measured by the audio callback
+struct LatencyReport {
+    int devicePeriod = 0;    // frames the device plays per period, at its own rate, as SDL opened it
+    int blockFrames = 0;     // frames rendered by the last callback
+    int queuedFrames = 0;    // in the stream right after the last callback, the period being fetched included
+    float outputMs = 0.0f;   // block queued until it leaves the device: queued frames plus one device period
+    float midiToSoundMs = 0.0f; // MIDI arrival to sound: one block of MIDI placement plus the output latency
+    uint64_t underruns = 0;  // since start
+    uint64_t periodUnderruns = 0; // since the current period was opened
+};
+
+// The playback stream and the size of the device period it runs at.
+// SDL picks the period unless SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES asks for one before the device
+// opens, so changing it means reopening the stream. In AUTO mode poll() does that by itself: it steps
+// the period up after repeated underruns, and down again after a long clean run while nothing plays,
+// so the device settles on the smallest period that does not glitch. A period that glitched is not
+// tried again for a while, twice as long each time.
+// An underrun is counted when the device asks for data later than what it had buffered at the previous
+// callback would last; SDL does not report them itself.
+class AudioOutput {
+public:
+    static constexpr int SDL_DEFAULT = 0; // period settings besides a frame count
+    static constexpr int AUTO = -1;
+    static constexpr int PERIODS[] = {64, 128, 256, 512, 1024, 2048};
+    static constexpr int NUM_PERIODS = (int)(sizeof(PERIODS) / sizeof(PERIODS[0]));
+
+    // Main thread. setting is SDL_DEFAULT, AUTO or a frame count. False if no stream could be opened.
+    bool open(int setting, SDL_AudioStreamCallback callback, void* userdata);
+    // Main thread: reopen with another setting and the same callback
+    bool reopen(int setting) { return open(setting, callback, userdata); }
+    void close();
+    // Main thread, once per GUI frame. idle: nothing is sounding, so a reopen will not be heard.
+    void poll(bool idle);
+    int setting() const { return periodSetting; }
+
+    // Audio thread, at the end of the callback once the block is queued
+    void measure(SDL_AudioStream* stream, int numFrames, int sampleRate);
+
+    // Any thread
+    void report(LatencyReport& out) const;
+
+private:
+    bool openStream(int frames); // 0: SDL's choice
+    int autoIndex() const;
+
+    // Main thread
+    SDL_AudioStream* stream = nullptr;
+    SDL_AudioStreamCallback callback = nullptr;
+    void* userdata = nullptr;
+    int periodSetting = SDL_DEFAULT;
+    int periodIndex = 2;                     // AUTO: index into PERIODS of the period open now
+    Uint64 openedMs = 0;
+    Uint64 lastUnderrunMs = 0;
+    uint64_t seenUnderruns = 0;
+    int recentUnderruns = 0;                 // within UNDERRUN_WINDOW_MS of each other
+    Uint64 retryAfterMs[NUM_PERIODS] = {};   // AUTO: a period that glitched is skipped until then
+    Uint64 retryHoldMs[NUM_PERIODS] = {};
+
+    // Audio thread
+    Uint64 lastCallbackNs = 0;
+    double bufferedFrames = 0.0;             // what the device had left after the previous callback
+
+    std::atomic<int> devicePeriod{0};
+    std::atomic<int> deviceRate{1};
+    std::atomic<int> blockFrames{0};
+    std::atomic<int> queuedFrames{0};
+    std::atomic<float> rate{0.0f};
+    std::atomic<uint64_t> underruns{0};
+    std::atomic<uint64_t> periodStartUnderruns{0};
+};
@@ -0,0 +1,268 @@
+// sdl3-synth-bench: microbenchmarks of the DSP building blocks and of whole engine renders.
+// Every result is the cost of one sample (one frame for stereo stages and renders) in ns, and the
+// realtime factor: seconds of audio produced per second of CPU time on one core.
+//
+//   sdl3-synth-bench [--out results.json] [--filter text] [--min-time ms]
+//
+// Results go to stdout as JSON unless --out names a file; --filter runs only the benchmarks whose
+// "group/name" contains the text.
+
+#include "Engine.h"
+#include "Denormals.h"
+#include "Synthesizer.h"
+#include "Oscillator.h"
+#include "Voice.h"
+#include "Filter.h"
+#include "Fft.h"
+#include "SpectrumAnalyzer.h"
+#include "SineTable.h"
+#include "Utils.h"
+#include <SDL3/SDL.h>
+#include <cJSON.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int BLOCK_FRAMES = 512;
+const int RUNS = 5; // the fastest run counts; the others absorb warm-up and scheduler noise
+const char* WAVEFORM_NAMES[] = {"sine", "square", "saw", "triangle", "saw_up", "saw_down", "pulse", "random"};
+
+struct Options {
+    const char* out = nullptr;
+    const char* filter = nullptr;
+    double minSeconds = 0.2; // per run
+};
+
+Options g_options;
+cJSON* g_results = nullptr;
+volatile float g_sink; // keeps the compiler from dropping work whose result is unused
+
+// White noise in [-0.5, 0.5), the same on every run
+std::vector<float> makeNoise(int count) {
+    std::vector<float> noise(count);
+    uint32_t state = 12345u;
+    for (float& s : noise) {
+        state = state * 1664525u + 1013904223u;
+        s = (float)(state >> 8) / 16777216.0f - 0.5f;
+    }
+    return noise;
+}
+
+// Call block() until minSeconds have passed, RUNS times, and record the fastest run.
+// block() processes samplesPerCall samples.
+template <typename Block>
+void bench(const char* group, const std::string& name, int samplesPerCall, Block block) {
+    std::string id = std::string(group) + "/" + name;
+    if (g_options.filter && id.find(g_options.filter) == std::string::npos) return;
+
+    double best = 0.0;
+    for (int run = 0; run < RUNS; ++run) {
+        int64_t samples = 0;
+        double start = getCurrentTime();
+        double elapsed = 0.0;
+        do {
+            block();
+            samples += samplesPerCall;
+            elapsed = getCurrentTime() - start;
+        } while (elapsed < g_options.minSeconds);
+        double ns = elapsed * 1e9 / (double)samples;
+        if (run == 0 || ns < best) best = ns;
+    }
+
+    cJSON* result = cJSON_CreateObject();
+    cJSON_AddStringToObject(result, "Group", group);
+    cJSON_AddStringToObject(result, "Name", name.c_str());
+    cJSON_AddNumberToObject(result, "NsPerSample", best);
+    cJSON_AddNumberToObject(result, "RealtimeFactor", 1e9 / (best * SAMPLE_RATE));
+    cJSON_AddItemToArray(g_results, result);
+    SDL_Log("%-28s %10.2f ns/sample %10.1fx realtime", id.c_str(), best, 1e9 / (best * SAMPLE_RATE));
+}
+
+void benchOscillators() {
+    for (int w = 0; w < (int)std::size(WAVEFORM_NAMES); ++w) {
+        VoiceParams params;
+        params.vcos[0].waveform = w;
+        Oscillator osc;
+        osc.setFrequency(220.0f);
+        osc.noteOn(1.0f);
+        bench("oscillator", WAVEFORM_NAMES[w], BLOCK_FRAMES, [&] {
+            float sum = 0.0f;
+            for (int i = 0; i < BLOCK_FRAMES; ++i) sum += osc.generateSample(params, params.vcos[0]);
+            g_sink = sum;
+        });
+    }
+}
+
+// A voice of the default patch (three VCOs) with 1 to 8 unison copies
+void benchVoices() {
+    VoiceParams params;
+    for (int unison = 1; unison <= 8; ++unison) {
+        Voice voice;
+        voice.setParams(&params);
+        voice.noteOn(57, 1.0f);
+        bench("voice", "unison_" + std::to_string(unison), BLOCK_FRAMES, [&] {
+            float sum = 0.0f;
+            for (int i = 0; i < BLOCK_FRAMES; ++i) {
+                float left, right, center;
+                renderUnison(voice, unison, 2, left, right, center);
+                sum += left + right;
+            }
+            g_sink = sum;
+        });
+    }
+}
+
+void benchFilter(const std::vector<float>& noise) {
+    for (int oversampling : {0, 2, 4, 8}) {
+        Filter filter;
+        filter.setSampleRate(SAMPLE_RATE);
+        filter.setCutoff(2000.0f);
+        filter.setResonance(2.0f);
+        filter.setOversampling(oversampling);
+        bench("filter", "oversampling_" + std::to_string(oversampling), BLOCK_FRAMES, [&] {
+            float sum = 0.0f;
+            for (int i = 0; i < BLOCK_FRAMES; ++i) sum += filter.process(noise[i]);
+            g_sink = sum;
+        });
+    }
+}
+
+// Master bus stages on stereo noise, each with its effect enabled at the default settings
+void benchEffects(const std::vector<float>& noise) {
+    auto synth = std::make_unique<Synthesizer>();
+    synth->flangerEnabled = synth->delayEnabled = synth->reverbEnabled = synth->compressorEnabled = true;
+    synth->filterEnabled = synth->dcFilterEnabled = synth->softClipEnabled = synth->autoGainEnabled = true;
+
+    struct Stage {
+        const char* name;
+        void (*process)(Synthesizer*, float&, float&);
+    };
+    const Stage stages[] = {
+        {"flanger", processFlanger},
+        {"delay", processDelay},
+        {"reverb", processReverb},
+        {"compressor", processCompressor},
+        {"filter", processFilter},
+        {"master", processMaster},
+    };
+    for (const Stage& stage : stages) {
+        bench("effect", stage.name, BLOCK_FRAMES, [&] {
+            float sum = 0.0f;
+            for (int i = 0; i < BLOCK_FRAMES; ++i) {
+                float left = noise[2 * i], right = noise[2 * i + 1];
+                stage.process(synth.get(), left, right);
+                sum += left + right;
+            }
+            g_sink = sum;
+        });
+    }
+}
+
+void benchMath() {
+    float phase = 0.0f;
+    const float step = 2.0f * (float)M_PI * 440.0f / SAMPLE_RATE;
+    bench("math", "fast_sin", BLOCK_FRAMES, [&] {
+        float sum = 0.0f;
+        for (int i = 0; i < BLOCK_FRAMES; ++i) {
+            sum += fastSin(phase);
+            phase += step;
+            if (phase >= 2.0f * (float)M_PI) phase -= 2.0f * (float)M_PI;
+        }
+        g_sink = sum;
+    });
+
+    // The analyzer's transform; the cost of one frame is spread over its input samples
+    const int n = SpectrumAnalyzer::FFT_SIZE;
+    Fft fft(n);
+    std::vector<float> input = makeNoise(n);
+    std::vector<float> re(n), im(n);
+    bench("math", "fft_" + std::to_string(n), n, [&] {
+        std::copy(input.begin(), input.end(), re.begin());
+        std::fill(im.begin(), im.end(), 0.0f);
+        fft.forward(re.data(), im.data());
+        g_sink = re[1];
+    });
+}
+
+// renderAudio() with every voice holding a note of the default patch, all effects at their defaults,
+// and with no notes at all but every effect on, once their tails have died away
+void benchRenders() {
+    for (int numVoices : {8, 32, 128}) {
+        auto synth = std::make_unique<Synthesizer>();
+        synth->voices.resize(numVoices);
+        synth->voiceAllocator.reset();
+        for (int v = 0; v < numVoices; ++v) {
+            // Past the allocator's voices too, so the note is started on the voice directly
+            synth->voices[v].setParams(&synth->voicePatch);
+            synth->voices[v].noteOn(36 + v % 48, 0.8f);
+        }
+        std::vector<int16_t> buffer(BLOCK_FRAMES * 2);
+        bench("render", "voices_" + std::to_string(numVoices), BLOCK_FRAMES, [&] {
+            renderAudio(synth.get(), buffer.data(), BLOCK_FRAMES);
+        });
+    }
+
+    auto synth = std::make_unique<Synthesizer>();
+    synth->flangerEnabled = synth->delayEnabled = synth->reverbEnabled = synth->compressorEnabled = true;
+    synth->filterEnabled = synth->dcFilterEnabled = synth->softClipEnabled = synth->autoGainEnabled = true;
+    std::vector<int16_t> buffer(BLOCK_FRAMES * 2);
+    int tail = std::max(synth->delayMaxSamples, synth->reverbMaxSamples);
+    for (int frames = 0; frames < tail + BLOCK_FRAMES; frames += BLOCK_FRAMES) {
+        renderAudio(synth.get(), buffer.data(), BLOCK_FRAMES);
+    }
+    bench("render", "idle", BLOCK_FRAMES, [&] {
+        renderAudio(synth.get(), buffer.data(), BLOCK_FRAMES);
+    });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) g_options.out = argv[++i];
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) g_options.filter = argv[++i];
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) g_options.minSeconds = atof(argv[++i]) * 0.001;
+        else {
+            SDL_Log("Usage: %s [--out results.json] [--filter text] [--min-time ms]", argv[0]);
+            return 1;
+        }
+    }
+    initSineTable();
+    DenormalGuard denormals; // as on the audio thread
+
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "SampleRate", SAMPLE_RATE);
+    cJSON_AddNumberToObject(root, "BlockFrames", BLOCK_FRAMES);
+    cJSON_AddBoolToObject(root, "Profiler", DspProfiler::ENABLED);
+    g_results = cJSON_AddArrayToObject(root, "Benchmarks");
+
+    std::vector<float> noise = makeNoise(BLOCK_FRAMES * 2);
+    benchOscillators();
+    benchVoices();
+    benchFilter(noise);
+    benchEffects(noise);
+    benchMath();
+    benchRenders();
+
+    char* text = cJSON_Print(root);
+    cJSON_Delete(root);
+    if (!text) return 1;
+    bool ok = true;
+    if (g_options.out) {
+        FILE* file = fopen(g_options.out, "wb");
+        ok = file && fputs(text, file) >= 0;
+        if (file) ok = fclose(file) == 0 && ok;
+        if (!ok) SDL_Log("Cannot write %s", g_options.out);
+    } else {
+        printf("%s\n", text);
+    }
+    cJSON_free(text);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include "ControlLink.h"
+#include "Synthesizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void ControlState::capture(const Synthesizer& synth) {
+    patch.capture(synth);
+    mpeEnabled = synth.mpe.enabled;
+    mpeLowerMembers = synth.mpe.lowerMembers;
+    mpeUpperMembers = synth.mpe.upperMembers;
+    mpeMemberBendRange = synth.mpe.memberBendRange;
+    mpePressureDepth = synth.mpe.pressureDepth;
+    if (!synth.voices.empty()) {
+        voiceFrequency = synth.voices[0].getFrequency();
+        voiceAmplitude = synth.voices[0].getAmplitude();
+    }
+}
+
+void ControlState::apply(Synthesizer& synth, const ControlState& since) const {
+    patch.apply(synth, &since.patch);
+    if (mpeEnabled != since.mpeEnabled) synth.mpe.enabled = mpeEnabled;
+    if (mpeLowerMembers != since.mpeLowerMembers) synth.mpe.lowerMembers = mpeLowerMembers;
+    if (mpeUpperMembers != since.mpeUpperMembers) synth.mpe.upperMembers = mpeUpperMembers;
+    if (mpeMemberBendRange != since.mpeMemberBendRange) synth.mpe.memberBendRange = mpeMemberBendRange;
+    if (mpePressureDepth != since.mpePressureDepth) synth.mpe.pressureDepth = mpePressureDepth;
+    if (voiceFrequency != since.voiceFrequency) {
+        for (Voice& voice : synth.voices) voice.setFrequency(voiceFrequency);
+    }
+    if (voiceAmplitude != since.voiceAmplitude) {
+        for (Voice& voice : synth.voices) voice.setAmplitude(voiceAmplitude);
+    }
+}
+
+bool ControlLink::pollTelemetry(Telemetry& out) {
+    if (!telemetry.update()) return false;
+    out = telemetry.front();
+    return true;
+}
+
+bool ControlLink::pollEngineState(ControlState& out) {
+    if (!engineState.update()) return false;
+    if (engineState.front().serial != publishedSerial) {
+        resendState.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    std::string name = out.patch.name; // library metadata is the GUI's own
+    std::vector<std::string> tags = out.patch.tags;
+    out = engineState.front().state;
+    out.patch.name = std::move(name);
+    out.patch.tags = std::move(tags);
+    return true;
+}
+
+void ControlLink::update(Synthesizer& synth) {
+    const Snapshot* snapshot = controls.acquire();
+    if (!snapshot) return;
+    if (applied) snapshot->state.apply(synth, applied->state);
+    applied = snapshot; // kept alive by the exchange until the next snapshot has been applied
+}
+
+void ControlLink::measure(const Synthesizer& synth, const int16_t* output, int numFrames, int sampleRate) {
+    for (int i = 0; i < numFrames; ++i) {
+        for (int c = 0; c < 2; ++c) {
+            float x = output[i * 2 + c] * (1.0f / 32768.0f);
+            peak[c] = std::max(peak[c], std::fabs(x));
+            sumSquares[c] += x * x;
+        }
+    }
+    intervalFrames += numFrames;
+    if (intervalFrames < sampleRate / UPDATES_PER_SECOND) return;
+
+    Telemetry& t = telemetry.back();
+    t.sampleClock = synth.sampleClock;
+    t.numVoices = (int)synth.voices.size();
+    t.activeVoices = 0;
+    for (int v = 0; v < t.numVoices; ++v) {
+        bool sounding = synth.voices[v].isSounding();
+        if (sounding) ++t.activeVoices;
+        if (v < Telemetry::MAX_VOICES) t.envelope[v] = sounding ? synth.voices[v].getEnvelopeLevel() : 0.0f;
+    }
+    for (int v = t.numVoices; v < Telemetry::MAX_VOICES; ++v) t.envelope[v] = 0.0f;
+    for (int c = 0; c < 2; ++c) {
+        t.peak[c] = peak[c];
+        t.rms[c] = (float)std::sqrt(sumSquares[c] / intervalFrames);
+        peak[c] = 0.0f;
+        sumSquares[c] = 0.0;
+    }
+    for (int p = 0; p < NUM_PARTS; ++p) t.partVoices[p] = synth.voiceAllocator.voicesOnChannel(p);
+    t.songPlaying = synth.songPlayer.playing();
+    t.songPosition = t.songPlaying ? synth.songPlayer.position(synth.sampleClock) : 0;
+    t.melodyPlaying = synth.melody.melodyPlaying;
+    telemetry.publish();
+    intervalFrames = 0;
+
+    if (stateChanged || resendState.exchange(false, std::memory_order_relaxed)) {
+        Snapshot& state = engineState.back();
+        state.state.capture(synth);
+        state.serial = applied ? applied->serial : 0;
+        engineState.publish();
+        stateChanged = false;
+    }
+}
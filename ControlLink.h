@@ -0,0 +1,98 @@
+#pragma once
+
+#include "LockFree.h"
+#include "Patch.h"
+#include <atomic>
+#include <cstdint>
+
+struct Synthesizer;
+
+// Everything the controls window edits. The GUI keeps its own copy (the mirror) and never writes the
+// engine's parameters directly.
+struct ControlState {
+    Patch patch;
+
+    // MPE zones (not stored in presets)
+    bool mpeEnabled = false;
+    int mpeLowerMembers = 15;
+    int mpeUpperMembers = 0;
+    float mpeMemberBendRange = 48.0f;
+    float mpePressureDepth = 0.5f;
+
+    // Test tone of the voice section, applied to every voice
+    float voiceFrequency = 440.0f;
+    float voiceAmplitude = 1.0f;
+
+    // Caller holds g_synthMutex or is the audio thread; does not allocate
+    void capture(const Synthesizer& synth);
+    // Audio thread: write the fields that differ from since
+    void apply(Synthesizer& synth, const ControlState& since) const;
+
+    bool operator==(const ControlState&) const = default;
+};
+
+// Engine status for display, published a few dozen times a second
+struct Telemetry {
+    static constexpr int MAX_VOICES = 16;
+
+    int64_t sampleClock = 0;
+    int numVoices = 0;
+    int activeVoices = 0;
+    float envelope[MAX_VOICES] = {}; // per voice, 0..1
+    float peak[2] = {};              // master output over the last interval, 0..1
+    float rms[2] = {};
+    int partVoices[NUM_PARTS] = {};  // sounding voices per MIDI channel
+    bool songPlaying = false;
+    int64_t songPosition = 0;        // frames
+    bool melodyPlaying = false;
+};
+
+// Parameter traffic between the GUI and the audio thread, so the GUI never holds g_synthMutex while
+// it builds a frame and a stalled frame cannot hold up audio.
+// The GUI publishes snapshots of its mirror whenever it edited something. The audio thread applies
+// each one as a diff against the previous snapshot it applied, so it writes only what the GUI changed:
+// values set meanwhile by MIDI controllers or presets stay until the GUI edits them, and skipped
+// snapshots are covered by the next diff.
+// The other way, the audio thread publishes telemetry and, after parameter changes that did not come
+// from the GUI, its own parameter state for the mirror to follow. That state is stamped with the last
+// snapshot applied; the mirror takes it only once every snapshot it published is in, since an older
+// state would overwrite edits still on their way. A state turned down is sent again.
+class ControlLink {
+public:
+    static constexpr int UPDATES_PER_SECOND = 30;
+
+    // GUI thread. The first snapshot published is the baseline and is not applied.
+    void publish(const ControlState& state) { controls.publish(new Snapshot{state, ++publishedSerial}); }
+    void collect() { controls.collect(); }
+    // Newest telemetry into out; false if nothing new arrived
+    bool pollTelemetry(Telemetry& out);
+    // Engine parameters into out, if they changed on the engine side since the last call and every
+    // published snapshot has been applied
+    bool pollEngineState(ControlState& out);
+
+    // Audio thread, before a block: apply the newest GUI snapshot
+    void update(Synthesizer& synth);
+    // Audio thread: parameters changed outside the GUI (presets, MIDI controllers)
+    void engineChanged() { stateChanged = true; }
+    // Audio thread, after a block
+    void measure(const Synthesizer& synth, const int16_t* output, int numFrames, int sampleRate);
+
+private:
+    struct Snapshot {
+        ControlState state;
+        uint64_t serial = 0; // GUI snapshots in publishing order, from 1
+    };
+
+    SnapshotExchange<Snapshot> controls;
+    const Snapshot* applied = nullptr; // audio thread: last snapshot applied
+    TripleBuffer<Telemetry> telemetry;
+    TripleBuffer<Snapshot> engineState; // serial: last GUI snapshot applied before the capture
+    uint64_t publishedSerial = 0;       // GUI thread
+    std::atomic<bool> resendState{false}; // GUI turned down a state older than its edits
+
+    // Audio thread
+    bool stateChanged = false;
+    int intervalFrames = 0;
+    float peak[2] = {};
+    double sumSquares[2] = {};
+};
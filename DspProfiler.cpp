@@ -0,0 +1,236 @@
+#include "DspProfiler.h"
+#include <algorithm>
+#include <bit>
+#include <cJSON.h>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+namespace {
+
+const char* STAGE_NAMES[(int)DspStage::Count] = {
+    "wait", "control", "voices", "flanger", "delay", "reverb", "compressor", "filter", "master", "output"
+};
+
+const double CALIBRATION_SECONDS = 0.25;
+
+} // namespace
+
+const char* dspStageName(DspStage stage) {
+    return STAGE_NAMES[(int)stage];
+}
+
+// Values below SUB_BINS get a bin each; above, every octave splits into SUB_BINS equal bins
+int DspProfiler::binOf(uint32_t value) {
+    if (value < (uint32_t)SUB_BINS) return (int)value;
+    int octave = std::bit_width(value) - 1; // 4 and up
+    int sub = (int)(value >> (octave - 4)) & (SUB_BINS - 1);
+    return (octave - 3) * SUB_BINS + sub;
+}
+
+double DspProfiler::binLow(int bin) {
+    if (bin < SUB_BINS) return bin;
+    int octave = bin / SUB_BINS + 3;
+    return std::ldexp((double)(SUB_BINS + bin % SUB_BINS), octave - 4);
+}
+
+void DspProfiler::endFrames(int numFrames) {
+    if constexpr (!ENABLED) return;
+    if (sampledFrames == 0) return;
+    double scale = (double)numFrames / sampledFrames;
+    for (int s = 0; s < (int)DspStage::Count; ++s) {
+        stageTicks[s] += (uint64_t)(frameTicks[s] * scale);
+        frameTicks[s] = 0;
+    }
+    sampledFrames = 0;
+    sampling = false;
+    lap = ticks(); // the loop is accounted for by the scaled frames
+}
+
+void DspProfiler::endCallback(int numFrames, int sampleRate) {
+    if constexpr (!ENABLED) return;
+    mark(DspStage::Output);
+    if (nsPerTick == 0.0) {
+        // Rate of the time stamp counter against SDL's clock, read back to back with the last mark
+        uint64_t counter = SDL_GetPerformanceCounter();
+        if (calibrationCounter == 0) {
+            calibrationCounter = counter;
+            calibrationTicks = lap;
+            return;
+        }
+        double seconds = (double)(counter - calibrationCounter) / SDL_GetPerformanceFrequency();
+        if (seconds < CALIBRATION_SECONDS || lap <= calibrationTicks) return;
+        nsPerTick = seconds * 1e9 / (double)(lap - calibrationTicks);
+    }
+
+    const int stages = (int)DspStage::Count;
+    double budgetNs = 1e9 * numFrames / sampleRate;
+    double totalNs = (double)(lap - callbackStart) * nsPerTick;
+    for (int s = 0; s < stages; ++s) record(s, (uint64_t)(stageTicks[s] * nsPerTick));
+    record(stages, (uint64_t)totalNs);
+    lastLoadRatio = (float)(totalNs / budgetNs);
+    record(stages + 1, (uint64_t)(totalNs / budgetNs * 1e6));
+    budgetUs.store((float)(budgetNs * 1e-3), std::memory_order_relaxed);
+    if (totalNs > budgetNs) bump(overruns);
+    bump(callbacks);
+}
+
+void DspProfiler::report(DspReport& out, Window& since) const {
+    auto stats = [&](int histogram, double scale) {
+        uint32_t delta[BINS];
+        uint64_t n = 0;
+        for (int b = 0; b < BINS; ++b) {
+            uint32_t c = counts[histogram][b].load(std::memory_order_relaxed);
+            delta[b] = c - since.counts[histogram][b];
+            since.counts[histogram][b] = c;
+            n += delta[b];
+        }
+        DspStats s;
+        if (n == 0) return s;
+        // Percentiles at the middle of their bin, the maximum at the top of the highest bin used
+        auto percentile = [&](double q) {
+            uint64_t target = std::max<uint64_t>(1, (uint64_t)std::ceil(q * n));
+            uint64_t seen = 0;
+            for (int b = 0; b < BINS; ++b) {
+                seen += delta[b];
+                if (seen >= target) return (float)(0.5 * (binLow(b) + binLow(b + 1)) * scale);
+            }
+            return 0.0f;
+        };
+        s.p50 = percentile(0.5);
+        s.p99 = percentile(0.99);
+        for (int b = BINS - 1; b >= 0; --b) {
+            if (delta[b]) {
+                s.max = (float)(binLow(b + 1) * scale);
+                break;
+            }
+        }
+        return s;
+    };
+
+    const int stages = (int)DspStage::Count;
+    for (int s = 0; s < stages; ++s) out.stages[s] = stats(s, 1e-3);
+    out.total = stats(stages, 1e-3);
+    out.load = stats(stages + 1, 1e-4);
+    out.budgetUs = budgetUs.load(std::memory_order_relaxed);
+
+    uint64_t c = callbacks.load(std::memory_order_relaxed);
+    uint64_t o = overruns.load(std::memory_order_relaxed);
+    out.callbacks = c - since.callbacks;
+    out.overruns = o - since.overruns;
+    out.totalCallbacks = since.callbacks = c;
+    out.totalOverruns = since.overruns = o;
+}
+
+static std::string reportToJson(const DspReport& report) {
+    auto addStats = [](cJSON* parent, const char* name, const DspStats& s) {
+        cJSON* obj = cJSON_AddObjectToObject(parent, name);
+        cJSON_AddNumberToObject(obj, "P50", s.p50);
+        cJSON_AddNumberToObject(obj, "P99", s.p99);
+        cJSON_AddNumberToObject(obj, "Max", s.max);
+    };
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "BudgetUs", report.budgetUs);
+    cJSON_AddNumberToObject(root, "Callbacks", (double)report.totalCallbacks);
+    cJSON_AddNumberToObject(root, "Overruns", (double)report.totalOverruns);
+    cJSON_AddNumberToObject(root, "WindowCallbacks", (double)report.callbacks);
+    cJSON_AddNumberToObject(root, "WindowOverruns", (double)report.overruns);
+    addStats(root, "LoadPercent", report.load);
+    addStats(root, "TotalUs", report.total);
+    cJSON* stages = cJSON_AddObjectToObject(root, "StagesUs");
+    for (int s = 0; s < (int)DspStage::Count; ++s) addStats(stages, dspStageName((DspStage)s), report.stages[s]);
+    cJSON* governor = cJSON_AddObjectToObject(root, "Governor");
+    cJSON_AddNumberToObject(governor, "Level", report.governor.level);
+    cJSON* engaged = cJSON_AddObjectToObject(governor, "Engaged");
+    cJSON* restored = cJSON_AddObjectToObject(governor, "Restored");
+    for (int a = 0; a < (int)GovernorAction::Count; ++a) {
+        cJSON_AddNumberToObject(engaged, governorActionName((GovernorAction)a), (double)report.governor.engaged[a]);
+        cJSON_AddNumberToObject(restored, governorActionName((GovernorAction)a), (double)report.governor.restored[a]);
+    }
+    cJSON_AddNumberToObject(governor, "VoicesCulled", (double)report.governor.voicesCulled);
+    char* text = cJSON_Print(root);
+    cJSON_Delete(root);
+    std::string json = text ? text : "";
+    cJSON_free(text);
+    return json;
+}
+
+static std::string reportToPrometheus(const DspReport& report) {
+    std::string out;
+    char line[256];
+    auto quantiles = [&](const char* metric, const char* labels, const DspStats& s, double scale) {
+        const char* sep = labels[0] ? "," : "";
+        snprintf(line, sizeof(line), "%s{%s%squantile=\"0.5\"} %g\n", metric, labels, sep, s.p50 * scale);
+        out += line;
+        snprintf(line, sizeof(line), "%s{%s%squantile=\"0.99\"} %g\n", metric, labels, sep, s.p99 * scale);
+        out += line;
+        snprintf(line, sizeof(line), "%s{%s%squantile=\"1\"} %g\n", metric, labels, sep, s.max * scale);
+        out += line;
+    };
+
+    out += "# HELP synth_dsp_stage_seconds Time per audio callback spent in each DSP stage.\n";
+    out += "# TYPE synth_dsp_stage_seconds gauge\n";
+    for (int s = 0; s < (int)DspStage::Count; ++s) {
+        char labels[64];
+        snprintf(labels, sizeof(labels), "stage=\"%s\"", dspStageName((DspStage)s));
+        quantiles("synth_dsp_stage_seconds", labels, report.stages[s], 1e-6);
+    }
+    out += "# HELP synth_dsp_callback_seconds Time per audio callback.\n";
+    out += "# TYPE synth_dsp_callback_seconds gauge\n";
+    quantiles("synth_dsp_callback_seconds", "", report.total, 1e-6);
+    out += "# HELP synth_dsp_load_ratio Callback time as a share of the buffer's duration.\n";
+    out += "# TYPE synth_dsp_load_ratio gauge\n";
+    quantiles("synth_dsp_load_ratio", "", report.load, 1e-2);
+
+    out += "# HELP synth_dsp_budget_seconds Duration of one audio buffer.\n";
+    out += "# TYPE synth_dsp_budget_seconds gauge\n";
+    snprintf(line, sizeof(line), "synth_dsp_budget_seconds %g\n", report.budgetUs * 1e-6);
+    out += line;
+    out += "# HELP synth_dsp_callbacks_total Audio callbacks timed.\n";
+    out += "# TYPE synth_dsp_callbacks_total counter\n";
+    snprintf(line, sizeof(line), "synth_dsp_callbacks_total %llu\n", (unsigned long long)report.totalCallbacks);
+    out += line;
+    out += "# HELP synth_dsp_overruns_total Audio callbacks that took longer than their buffer lasts.\n";
+    out += "# TYPE synth_dsp_overruns_total counter\n";
+    snprintf(line, sizeof(line), "synth_dsp_overruns_total %llu\n", (unsigned long long)report.totalOverruns);
+    out += line;
+
+    const GovernorReport& governor = report.governor;
+    out += "# HELP synth_governor_level Overload governor actions engaged now.\n";
+    out += "# TYPE synth_governor_level gauge\n";
+    snprintf(line, sizeof(line), "synth_governor_level %d\n", governor.level);
+    out += line;
+    out += "# HELP synth_governor_engaged_total Times the overload governor engaged each action.\n";
+    out += "# TYPE synth_governor_engaged_total counter\n";
+    for (int a = 0; a < (int)GovernorAction::Count; ++a) {
+        snprintf(line, sizeof(line), "synth_governor_engaged_total{action=\"%s\"} %llu\n",
+                 governorActionName((GovernorAction)a), (unsigned long long)governor.engaged[a]);
+        out += line;
+    }
+    out += "# HELP synth_governor_restored_total Times the overload governor restored each action.\n";
+    out += "# TYPE synth_governor_restored_total counter\n";
+    for (int a = 0; a < (int)GovernorAction::Count; ++a) {
+        snprintf(line, sizeof(line), "synth_governor_restored_total{action=\"%s\"} %llu\n",
+                 governorActionName((GovernorAction)a), (unsigned long long)governor.restored[a]);
+        out += line;
+    }
+    out += "# HELP synth_governor_voices_culled_total Release tails the overload governor cut short.\n";
+    out += "# TYPE synth_governor_voices_culled_total counter\n";
+    snprintf(line, sizeof(line), "synth_governor_voices_culled_total %llu\n", (unsigned long long)governor.voicesCulled);
+    out += line;
+    return out;
+}
+
+bool DspProfiler::writeReport(const std::string& filename, const DspReport& report) {
+    bool json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+    std::string text = json ? reportToJson(report) : reportToPrometheus(report);
+
+    std::string tmp = filename + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fputs(text.c_str(), file) >= 0;
+    ok = fclose(file) == 0 && ok;
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmp, filename, ec);
+    return ok && !ec;
+}
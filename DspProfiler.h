@@ -0,0 +1,158 @@
+#pragma once
+
+#include "LoadGovernor.h"
+#include "LockFree.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define DSP_PROFILER_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DSP_PROFILER_TSC 1
+#endif
+
+// Built with -DSYNTH_PROFILER=0 (cmake -DSYNTH_PROFILER=OFF) every audio-thread call below compiles
+// to nothing and the reports stay empty.
+#ifndef SYNTH_PROFILER
+#define SYNTH_PROFILER 1
+#endif
+
+// Parts of the audio callback that are timed separately, in the order the render loop runs them
+enum class DspStage {
+    Wait,       // engine lock and buffer allocation
+    Control,    // patch and control updates, MIDI and scheduled events, modulation
+    Voices,
+    Flanger,
+    Delay,
+    Reverb,
+    Compressor,
+    Filter,
+    Master,     // DC filter, soft clip, auto gain, volume and pan
+    Output,     // conversion to 16 bit, scope, recorder and analyzer feeds, handing the block to SDL
+    Count
+};
+
+const char* dspStageName(DspStage stage);
+
+// Percentiles of one measurement over a report window
+struct DspStats {
+    float p50 = 0.0f;
+    float p99 = 0.0f;
+    float max = 0.0f;
+};
+
+struct DspReport {
+    DspStats stages[(int)DspStage::Count]; // microseconds per callback
+    DspStats total;                        // microseconds per callback
+    DspStats load;                         // percent of the buffer's duration
+    float budgetUs = 0.0f;                 // duration of the last buffer
+    uint64_t callbacks = 0;                // in the window
+    uint64_t overruns = 0;                 // callbacks in the window that took longer than their buffer lasts
+    uint64_t totalCallbacks = 0;           // since start
+    uint64_t totalOverruns = 0;
+    GovernorReport governor;               // not filled by DspProfiler::report; see LoadGovernor::report
+};
+
+// Times the audio callback per DSP stage and counts callbacks that overrun their deadline.
+// The audio thread reads the CPU's time stamp counter (SDL's performance counter where there is
+// none) at every stage boundary. Stages of the per-frame render loop are timed on one frame in
+// FRAME_SAMPLING only and scaled up to the block, so the counter reads do not cost as much as the
+// cheap stages they time; the callback total is always measured whole. Once per callback the stage
+// sums go into log-scaled histograms, about 4% wide per bin. It is their only writer, so recording is a
+// relaxed load and store per histogram. Readers keep their own window of the counts they saw last
+// and get percentiles over everything recorded since.
+class DspProfiler {
+public:
+    static constexpr bool ENABLED = SYNTH_PROFILER;
+    static constexpr int FRAME_SAMPLING = 16;    // frames per timed frame in the render loop
+    static constexpr int SUB_BINS = 16;          // bins per octave
+    static constexpr int BINS = 29 * SUB_BINS;   // values up to 2^32
+    static constexpr int HISTOGRAMS = (int)DspStage::Count + 2; // the stages, callback total, load
+
+    // Cumulative counts as a reader saw them at its last report
+    struct Window {
+        uint32_t counts[HISTOGRAMS][BINS] = {};
+        uint64_t callbacks = 0;
+        uint64_t overruns = 0;
+    };
+
+    // Audio thread: first thing in the callback
+    void beginCallback() {
+        if constexpr (!ENABLED) return;
+        callbackStart = lap = ticks();
+        for (uint64_t& t : stageTicks) t = 0;
+    }
+    // Audio thread: charge the time since the previous mark to stage
+    void mark(DspStage stage) {
+        if constexpr (!ENABLED) return;
+        uint64_t now = ticks();
+        stageTicks[(int)stage] += now - lap;
+        lap = now;
+    }
+    // Audio thread, top of each render loop frame: whether markFrame() times this one
+    void beginFrame(int frame) {
+        if constexpr (!ENABLED) return;
+        sampling = frame % FRAME_SAMPLING == 0;
+        if (!sampling) return;
+        ++sampledFrames;
+        lap = ticks();
+    }
+    // Audio thread: like mark(), inside the render loop
+    void markFrame(DspStage stage) {
+        if constexpr (!ENABLED) return;
+        if (!sampling) return;
+        uint64_t now = ticks();
+        frameTicks[(int)stage] += now - lap;
+        lap = now;
+    }
+    // Audio thread, after the render loop: scale the timed frames up to numFrames
+    void endFrames(int numFrames);
+    // Audio thread: last thing in the callback; whatever ran since the last mark counts as output
+    void endCallback(int numFrames, int sampleRate);
+
+    // Audio thread: the last callback's time as a share of its buffer's duration; 0 until calibrated
+    float lastLoad() const { return lastLoadRatio; }
+
+    // Any thread: statistics over the callbacks recorded since this window's previous report
+    void report(DspReport& out, Window& since) const;
+
+    // Write a report as Prometheus text exposition, or as JSON when the name ends in ".json".
+    // The file is replaced atomically, so a collector never sees half of it.
+    static bool writeReport(const std::string& filename, const DspReport& report);
+
+private:
+    static uint64_t ticks() {
+#ifdef DSP_PROFILER_TSC
+        return __rdtsc();
+#else
+        return SDL_GetPerformanceCounter();
+#endif
+    }
+    static int binOf(uint32_t value);
+    static double binLow(int bin);
+    void record(int histogram, uint64_t value) {
+        bump(counts[histogram][binOf((uint32_t)std::min<uint64_t>(value, UINT32_MAX))]);
+    }
+
+    // Audio thread only
+    uint64_t callbackStart = 0;
+    uint64_t lap = 0;
+    uint64_t stageTicks[(int)DspStage::Count] = {};
+    uint64_t frameTicks[(int)DspStage::Count] = {}; // timed frames of the current block
+    int sampledFrames = 0;
+    bool sampling = false;
+    uint64_t calibrationTicks = 0;   // ticks and performance counter read together at the first callback
+    uint64_t calibrationCounter = 0;
+    double nsPerTick = 0.0;          // 0 until calibrated; nothing is recorded before
+    float lastLoadRatio = 0.0f;
+
+    std::atomic<uint32_t> counts[HISTOGRAMS][BINS] = {}; // stages and total in ns, load in ppm
+    std::atomic<uint64_t> callbacks{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<float> budgetUs{0.0f};
+};
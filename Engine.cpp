@@ -0,0 +1,615 @@
+#include "Engine.h"
+#include "Synthesizer.h"
+#include "ScopeCapture.h"
+#include "SpectrumAnalyzer.h"
+#include "SineTable.h"
+#include "Log.h"
+#include "Denormals.h"
+#include "Utils.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+
+// Apply one MIDI message to the synthesizer. Called by the audio thread on the event's frame.
+void handleMidiMessage(Synthesizer* synth, const uint8_t* bytes, int nBytes, int rampFrames) {
+    int status = bytes[0] & 0xF0;
+    int channel = bytes[0] & 0x0F;
+    int midiNote = (nBytes >= 2) ? bytes[1] : 0;
+    int vel = (nBytes >= 3) ? bytes[2] : 0;
+
+    // Per-note expression on MPE member channels
+    if (synth->mpe.handleMessage(bytes, nBytes, synth->voiceAllocator)) return;
+
+    // Learned controller assignments
+    if (synth->midiMapper.handleMessage(bytes, nBytes, *synth, rampFrames)) {
+        synth->controlLink.engineChanged();
+        return;
+    }
+
+    // Pitch Bend
+    if (status == 0xE0) {
+        if (nBytes >= 3) {
+            int lsb = bytes[1];
+            int msb = bytes[2];
+            int value = (msb << 7) | lsb;
+            synth->pitchBend = (value - 8192.0f) / 8192.0f;
+            synth->pitchBendRampFrames = rampFrames;
+        }
+        return;
+    }
+
+    // Control Change (for Mod Wheel)
+    if (status == 0xB0) {
+        if (nBytes >= 3) {
+            int controller = bytes[1];
+            if (controller == 1) { // Modulation Wheel
+                synth->modWheelValue = bytes[2] / 127.0f;
+                synth->modWheelRampFrames = rampFrames;
+            }
+        }
+        return;
+    }
+
+    // Only process Note On (0x90) and Note Off (0x80) from here
+    if (status != 0x90 && status != 0x80) return;
+
+    if (synth->arpEnabled) {
+        if (status == 0x90 && vel > 0) { // Actual Note On for arpeggiator
+            synth->arp.noteOn(midiNote);
+        } else if (status == 0x80 || (status == 0x90 && vel == 0)) { // Note Off (0x80 or 0x90 with vel == 0)
+            synth->arp.noteOff(midiNote, synth->arpHold);
+        }
+    } else { // Arpeggiator is disabled
+        if (status == 0x90 && vel > 0) { // Actual Note On (0x90 with velocity > 0)
+            synth->noteOn(channel, midiNote, vel / 127.0f);
+        } else if (status == 0x80 || (status == 0x90 && vel == 0)) { // Note Off (0x80 or 0x90 with velocity 0)
+            synth->voiceAllocator.noteOff(channel, midiNote);
+        }
+    }
+}
+
+// Move a rendered controller value one frame towards its target, by an equal share of the frames left
+// in its ramp. True when the modulation should be re-applied: at the end and once per sub-block.
+static bool glide(float& rendered, float target, int& rampFrames, int frame) {
+    if (rendered == target) return false;
+    if (rampFrames > 0) rendered += (target - rendered) / rampFrames--;
+    else rendered = target;
+    return rampFrames == 0 || frame % MODULATION_SUB_BLOCK == 0;
+}
+
+// Pitch bend and mod LFO, re-applied whenever a MIDI event or an MPE lane may have changed them
+static void applyPitchModulation(Synthesizer* synth, float lfoValue) {
+    float globalBend = synth->renderedPitchBend * synth->pitchBendRange;
+    const VoiceModLanes& lanes = synth->mpe.lanes;
+    for (size_t v = 0; v < synth->voices.size(); ++v) {
+        float bend = globalBend;
+        if (synth->mpe.enabled && v < VoiceModLanes::MAX_VOICES) bend += lanes.bend[v];
+        synth->voices[v].setPitchBend(bend);
+        synth->voices[v].setLfoMod(lfoValue);
+    }
+}
+
+// Everything on the scheduler's timeline that is due at sample position now
+static void dispatchScheduledEvents(Synthesizer* synth, int64_t now) {
+    ScheduledEvent ev;
+    while (synth->scheduler.pop(now, ev)) {
+        switch (ev.kind) {
+            case ScheduledKind::Midi:
+                handleMidiMessage(synth, ev.bytes, ev.size);
+                break;
+            case ScheduledKind::NoteOff:
+                if (ev.voice < 0 || synth->voiceAllocator.voiceForNote(ev.bytes[0], ev.bytes[1]) == ev.voice) {
+                    synth->voiceAllocator.noteOff(ev.bytes[0], ev.bytes[1]);
+                }
+                break;
+            case ScheduledKind::MelodyStep:
+            case ScheduledKind::MelodyNoteOff:
+                synth->melody.handleEvent(ev, *synth, now);
+                break;
+        }
+    }
+}
+
+// Frames the master bus (compressor, filter, master stage) stays silent before it sleeps, long enough for
+// the compressor's release and the filters' ring-down to finish
+static const int BUS_SLEEP_FRAMES = SAMPLE_RATE;
+
+// Whether a whole block can be skipped as silence: no voice sounding, nothing due before its end, and
+// every enabled effect asleep
+static bool engineAsleep(Synthesizer* synth, int numEvents, int numFrames) {
+    int64_t end = synth->sampleClock + numFrames;
+    if (numEvents > 0 || synth->scheduler.nextTime() < end || synth->arp.nextEvent() < end) return false;
+    if (synth->renderedPitchBend != synth->pitchBend || synth->mpe.enabled) return false;
+    if (!synth->busSilence.asleep) return false;
+    if (synth->flangerEnabled && !synth->flangerSilence.asleep) return false;
+    if (synth->delayEnabled && !synth->delaySilence.asleep) return false;
+    if (synth->reverbEnabled && !synth->reverbSilence.asleep) return false;
+    for (const Voice& voice : synth->voices) {
+        if (voice.isSounding()) return false;
+    }
+    return true;
+}
+
+// One frame of a voice and its unison copies. The voice itself plays in the center; the others are
+// detuned and phase-shifted in steps of the spread and panned half left or right. left and right get
+// the average of all copies, center the undetuned voice alone (for visualization).
+void renderUnison(Voice& voice, int count, int spreadIndex, float& left, float& right, float& center, float copies) {
+    int N = std::clamp(count, 1, 8);
+    int spreadIdx = std::clamp(spreadIndex, 0, 4);
+    const int spreadValues[5] = {0, 3, 10, 25, 50}; // detune in cents
+    int stepCentsLocal = spreadValues[spreadIdx];
+    const float phaseSpreadValues[5] = {0.0f, 0.0001f, 0.00025f, 0.0005f, 0.001f}; // phase offset in seconds
+    float stepPhaseSecLocal = phaseSpreadValues[spreadIdx];
+
+    float voiceSumL = 0.0f;
+    float voiceSumR = 0.0f;
+    float centerL = 0.0f;
+    float centerR = 0.0f;
+    center = 0.0f;
+
+    int mid = (N - 1) / 2;
+    for (int k = 0; k < N; ++k) {
+        int offset = k - mid;
+        float detune = offset * static_cast<float>(stepCentsLocal);
+        if (offset == 0) {
+            float voiceLeft, voiceRight;
+            voice.generateStereoSample(voiceLeft, voiceRight);
+            voiceSumL += voiceLeft;
+            voiceSumR += voiceRight;
+            centerL = voiceLeft;
+            centerR = voiceRight;
+            center = (voiceLeft + voiceRight) * 0.5f;
+        } else {
+            // For unison detuned voices, apply voice-level panning based on offset for stereo spread
+            float voicePan = offset > 0 ? 0.5f : -0.5f; // Positive offset = right, negative = left
+            float phaseOffSec = (offset * stepPhaseSecLocal);
+            float detuneLeft, detuneRight;
+            voice.generateStereoSampleDetuned(detune, phaseOffSec, voicePan, detuneLeft, detuneRight);
+            voiceSumL += detuneLeft;
+            voiceSumR += detuneRight;
+        }
+    }
+    left = voiceSumL / static_cast<float>(N);
+    right = voiceSumR / static_cast<float>(N);
+    if (copies < 1.0f) {
+        left = centerL + copies * (left - centerL);
+        right = centerR + copies * (right - centerR);
+    }
+}
+
+// --- Stereo Flanger ---
+void processFlanger(Synthesizer* synth, float& left, float& right) {
+    if (!synth->flangerEnabled || synth->flangerBufferL.empty()) return;
+    if (synth->flangerSilence.sleeping(left, right)) return;
+    float lfo = fastSin(2.0f * M_PI * synth->flangerPhase);
+    synth->flangerPhase += synth->flangerRate / static_cast<float>(SAMPLE_RATE);
+    if (synth->flangerPhase >= 1.0f) synth->flangerPhase -= 1.0f;
+
+    float modDelaySec = synth->flangerDepth * (0.5f * (lfo + 1.0f));
+    int modDelaySamples = static_cast<int>(modDelaySec * SAMPLE_RATE);
+
+    // Left
+    int readIndexL = synth->flangerIndexL - modDelaySamples;
+    if (readIndexL < 0) readIndexL += (int)synth->flangerBufferL.size();
+    float delayedSampleL = synth->flangerBufferL[readIndexL];
+    float writtenL = left;
+    synth->flangerBufferL[synth->flangerIndexL] = left;
+    synth->flangerIndexL = (synth->flangerIndexL + 1) % (int)synth->flangerBufferL.size();
+    left = (1.0f - synth->flangerMix) * left + synth->flangerMix * delayedSampleL;
+
+    // Right
+    int readIndexR = synth->flangerIndexR - modDelaySamples;
+    if (readIndexR < 0) readIndexR += (int)synth->flangerBufferR.size();
+    float delayedSampleR = synth->flangerBufferR[readIndexR];
+    float writtenR = right;
+    synth->flangerBufferR[synth->flangerIndexR] = right;
+    synth->flangerIndexR = (synth->flangerIndexR + 1) % (int)synth->flangerBufferR.size();
+    right = (1.0f - synth->flangerMix) * right + synth->flangerMix * delayedSampleR;
+    synth->flangerSilence.update(writtenL, writtenR, (int)synth->flangerBufferL.size());
+}
+
+// --- Stereo Delay ---
+void processDelay(Synthesizer* synth, float& left, float& right) {
+    if (!synth->delayEnabled || synth->delayMaxSamples <= 0) return;
+    if (synth->delaySilence.sleeping(left, right)) return;
+    int delaySamples = static_cast<int>(synth->delayTimeSec * SAMPLE_RATE);
+    if (delaySamples >= synth->delayMaxSamples) delaySamples = synth->delayMaxSamples - 1;
+
+    // Left
+    int readIndexL = synth->delayIndexL - delaySamples;
+    if (readIndexL < 0) readIndexL += synth->delayMaxSamples;
+    float delayOutL = synth->delayBufferL[readIndexL];
+    float writtenL = left + delayOutL * synth->delayFeedback;
+    synth->delayBufferL[synth->delayIndexL] = writtenL;
+    left = (1.0f - synth->delayMix) * left + synth->delayMix * delayOutL;
+    synth->delayIndexL = (synth->delayIndexL + 1) % synth->delayMaxSamples;
+
+    // Right
+    int readIndexR = synth->delayIndexR - delaySamples;
+    if (readIndexR < 0) readIndexR += synth->delayMaxSamples;
+    float delayOutR = synth->delayBufferR[readIndexR];
+    float writtenR = right + delayOutR * synth->delayFeedback;
+    synth->delayBufferR[synth->delayIndexR] = writtenR;
+    right = (1.0f - synth->delayMix) * right + synth->delayMix * delayOutR;
+    synth->delayIndexR = (synth->delayIndexR + 1) % synth->delayMaxSamples;
+    synth->delaySilence.update(writtenL, writtenR, synth->delayMaxSamples);
+}
+
+// --- Enhanced Stereo Reverb ---
+void processReverb(Synthesizer* synth, float& left, float& right) {
+    if (!synth->reverbEnabled || synth->reverbMaxSamples <= 0) return;
+    if (synth->reverbSilence.sleeping(left, right)) return;
+    // Pre-delay processing
+    int preDelaySamples = static_cast<int>(synth->reverbDelay * SAMPLE_RATE);
+    int preDelayIdxL = (synth->reverbIndexL - preDelaySamples + synth->reverbMaxSamples) % synth->reverbMaxSamples;
+    int preDelayIdxR = (synth->reverbIndexR - preDelaySamples + synth->reverbMaxSamples) % synth->reverbMaxSamples;
+
+    // Get pre-delayed signals
+    float preDelayedL = synth->reverbBufferL[preDelayIdxL];
+    float preDelayedR = synth->reverbBufferR[preDelayIdxR];
+
+    // Calculate tap delays based on size and diffusion
+    float baseDelay = 0.02f + synth->reverbSize * 0.08f; // 20ms to 100ms
+    float diffusion = 0.3f + synth->reverbDiffuse * 0.4f; // Spread taps
+
+    int taps[6];
+    taps[0] = static_cast<int>((baseDelay * 0.8f) * SAMPLE_RATE);
+    taps[1] = static_cast<int>((baseDelay * 1.2f) * SAMPLE_RATE);
+    taps[2] = static_cast<int>((baseDelay * 1.6f + diffusion * 0.1f) * SAMPLE_RATE);
+    taps[3] = static_cast<int>((baseDelay * 2.2f + diffusion * 0.2f) * SAMPLE_RATE);
+    taps[4] = static_cast<int>((baseDelay * 3.1f + diffusion * 0.3f) * SAMPLE_RATE);
+    taps[5] = static_cast<int>((baseDelay * 4.5f + diffusion * 0.4f) * SAMPLE_RATE);
+
+    // Left channel processing
+    float reverbOutL = 0.0f;
+    for (int i = 0; i < 6; ++i) {
+        int idx = (synth->reverbIndexL - taps[i] + synth->reverbMaxSamples) % synth->reverbMaxSamples;
+        reverbOutL += synth->reverbBufferL[idx] * (1.0f / 6.0f);
+    }
+
+    // Right channel processing
+    float reverbOutR = 0.0f;
+    for (int i = 0; i < 6; ++i) {
+        int idx = (synth->reverbIndexR - taps[i] + synth->reverbMaxSamples) % synth->reverbMaxSamples;
+        reverbOutR += synth->reverbBufferR[idx] * (1.0f / 6.0f);
+    }
+
+    // Apply size/decay
+    reverbOutL *= synth->reverbSize;
+    reverbOutR *= synth->reverbSize;
+
+    // Stereo cross-mixing
+    float crossL = reverbOutR * synth->reverbStereo * 0.3f;
+    float crossR = reverbOutL * synth->reverbStereo * 0.3f;
+    reverbOutL = reverbOutL * (1.0f - synth->reverbStereo * 0.3f) + crossL;
+    reverbOutR = reverbOutR * (1.0f - synth->reverbStereo * 0.3f) + crossR;
+
+    // Apply damping (low-pass filter effect)
+    float dampCoeff = 1.0f - synth->reverbDamp * 0.1f;
+    synth->reverbDampL = synth->reverbDampL * dampCoeff + reverbOutL * (1.0f - dampCoeff);
+    synth->reverbDampR = synth->reverbDampR * dampCoeff + reverbOutR * (1.0f - dampCoeff);
+    reverbOutL = synth->reverbDampL;
+    reverbOutR = synth->reverbDampR;
+
+    // Write back to buffer with pre-delay input
+    float writtenL = preDelayedL + reverbOutL * 0.7f; // Feedback
+    float writtenR = preDelayedR + reverbOutR * 0.7f;
+    synth->reverbBufferL[synth->reverbIndexL] = writtenL;
+    synth->reverbBufferR[synth->reverbIndexR] = writtenR;
+
+    // Mix dry/wet
+    left = synth->reverbDryMix * left + synth->reverbWetMix * reverbOutL;
+    right = synth->reverbDryMix * right + synth->reverbWetMix * reverbOutR;
+
+    // Update indices
+    synth->reverbIndexL = (synth->reverbIndexL + 1) % synth->reverbMaxSamples;
+    synth->reverbIndexR = (synth->reverbIndexR + 1) % synth->reverbMaxSamples;
+    synth->reverbSilence.update(writtenL, writtenR, synth->reverbMaxSamples);
+}
+
+// --- Stereo Bus Compressor ---
+void processCompressor(Synthesizer* synth, float& left, float& right) {
+    if (!synth->compressorEnabled) return;
+    float attackSec = std::max(0.0001f, synth->compressorAttackMs * 0.001f);
+    float releaseSec = std::max(0.0001f, synth->compressorReleaseMs * 0.001f);
+    float attackCoef = std::exp(-1.0f / (attackSec * SAMPLE_RATE));
+    float releaseCoef = std::exp(-1.0f / (releaseSec * SAMPLE_RATE));
+    float makeup = std::pow(10.0f, synth->compressorMakeupDb / 20.0f);
+
+    // Left
+    float absValL = std::fabs(left) + 1e-20f;
+    float inDbL = 20.0f * std::log10(absValL);
+    float desiredGainL = 1.0f;
+    if (inDbL > synth->compressorThresholdDb) {
+        float outDb = synth->compressorThresholdDb + (inDbL - synth->compressorThresholdDb) / synth->compressorRatio;
+        desiredGainL = std::pow(10.0f, (outDb - inDbL) / 20.0f);
+    }
+    float coefL = (desiredGainL < synth->compressorGainL) ? attackCoef : releaseCoef;
+    synth->compressorGainL = coefL * synth->compressorGainL + (1.0f - coefL) * desiredGainL;
+    left *= synth->compressorGainL * makeup;
+
+    // Right
+    float absValR = std::fabs(right) + 1e-20f;
+    float inDbR = 20.0f * std::log10(absValR);
+    float desiredGainR = 1.0f;
+    if (inDbR > synth->compressorThresholdDb) {
+        float outDb = synth->compressorThresholdDb + (inDbR - synth->compressorThresholdDb) / synth->compressorRatio;
+        desiredGainR = std::pow(10.0f, (outDb - inDbR) / 20.0f);
+    }
+    float coefR = (desiredGainR < synth->compressorGainR) ? attackCoef : releaseCoef;
+    synth->compressorGainR = coefR * synth->compressorGainR + (1.0f - coefR) * desiredGainR;
+    right *= synth->compressorGainR * makeup;
+}
+
+// --- Filter ---
+void processFilter(Synthesizer* synth, float& left, float& right) {
+    if (!synth->filterEnabled) return;
+    left = synth->filter.process(left);
+    right = synth->filter.process(right);
+}
+
+void processMaster(Synthesizer* synth, float& left, float& right) {
+    // --- DC Filter ---
+    if (synth->dcFilterEnabled) {
+        // High-pass filter for DC removal: y[n] = alpha * (y[n-1] + x[n] - x[n-1])
+        float yL = synth->dcFilterAlpha * (synth->dcFilterY1L + left - synth->dcFilterX1L);
+        synth->dcFilterX1L = left;
+        synth->dcFilterY1L = yL;
+        left = yL;
+
+        float yR = synth->dcFilterAlpha * (synth->dcFilterY1R + right - synth->dcFilterX1R);
+        synth->dcFilterX1R = right;
+        synth->dcFilterY1R = yR;
+        right = yR;
+    }
+
+    // --- Soft Clipping ---
+    if (synth->softClipEnabled) {
+        left = std::tanh(left * synth->softClipDrive) / synth->softClipDrive;
+        right = std::tanh(right * synth->softClipDrive) / synth->softClipDrive;
+    }
+
+    // --- Auto Gain ---
+    if (synth->autoGainEnabled) {
+        // Compute RMS
+        float rmsL = std::sqrt(left * left);
+        float rmsR = std::sqrt(right * right);
+        synth->autoGainRMSL = synth->autoGainAlpha * synth->autoGainRMSL + (1.0f - synth->autoGainAlpha) * rmsL;
+        synth->autoGainRMSR = synth->autoGainAlpha * synth->autoGainRMSR + (1.0f - synth->autoGainAlpha) * rmsR;
+
+        // Adjust gain if RMS is below target
+        float targetGainL = (synth->autoGainRMSL > 0.0f) ? synth->autoGainTargetRMS / synth->autoGainRMSL : 1.0f;
+        float targetGainR = (synth->autoGainRMSR > 0.0f) ? synth->autoGainTargetRMS / synth->autoGainRMSR : 1.0f;
+        synth->autoGainGainL = synth->autoGainAlpha * synth->autoGainGainL + (1.0f - synth->autoGainAlpha) * targetGainL;
+        synth->autoGainGainR = synth->autoGainAlpha * synth->autoGainGainR + (1.0f - synth->autoGainAlpha) * targetGainR;
+
+        left *= synth->autoGainGainL;
+        right *= synth->autoGainGainR;
+    }
+
+    // Apply master volume
+    left *= synth->masterVolume;
+    right *= synth->masterVolume;
+
+    // Apply panning (linear pan law)
+    float panLeft = 1.0f - std::max(0.0f, synth->pan);  // 1.0 when pan <= 0, decreases to 0 when pan = 1
+    float panRight = 1.0f + std::min(0.0f, synth->pan); // 1.0 when pan >= 0, decreases to 0 when pan = -1
+    left *= panLeft;
+    right *= panRight;
+}
+
+// Render numFrames of interleaved stereo into buffer. Called with g_synthMutex held, by the audio
+// callback and by the offline renderer, so both produce the same samples.
+void renderAudio(Synthesizer* synth, int16_t* buffer, int numFrames) {
+    DenormalGuard denormals; // decaying tails and filter state would otherwise go denormal
+    // Pick up controller mappings edited in the GUI and a preset snapshot published by the loader thread
+    synth->controlLink.update(*synth);
+    if (const Patch* patch = synth->patchExchange.acquire()) {
+        patch->apply(*synth);
+        synth->controlLink.engineChanged();
+    }
+    synth->recorder.beginBlock();
+    int stemCount = synth->recorder.stemCount();
+    bool scopeCapture = synth->scope && synth->scope->beginBlock(numFrames); // off while the scope window is hidden
+    int scopeVoices = std::min((int)synth->voices.size(), ScopeCapture::MAX_VOICES);
+    float voiceNorm = synth->voices.empty() ? 1.0f : 1.0f / sqrtf(synth->voices.size());
+
+    // Update LFO
+    synth->modLfoPhase += synth->modLfoRate / static_cast<float>(SAMPLE_RATE);
+    if (synth->modLfoPhase >= 1.0f) {
+        synth->modLfoPhase -= 1.0f;
+    }
+    float lfoSine = fastSin(2.0f * M_PI * synth->modLfoPhase);
+    float lfoValue = lfoSine * synth->renderedModWheel * 1.0f; // 1 semitone max depth
+
+    // Apply global pitch mods to all voices
+    applyPitchModulation(synth, lfoValue);
+
+    // Shed load if the last callback ran close to its deadline (culled voices are reclaimed right below)
+    synth->governor.update(*synth, synth->profiler.lastLoad(), numFrames, SAMPLE_RATE);
+
+    // Voices whose release has finished become free for the next note-on
+    synth->voiceAllocator.reclaim();
+
+    // MIDI that arrived during the last block's worth of time, placed on its exact frame
+    int numEvents = synth->midiQueue.collect(midiClockNowNs(), numFrames, SAMPLE_RATE);
+    const MidiEvent* events = synth->midiQueue.events();
+    int nextEvent = 0;
+
+    // Events other threads posted since the last block, and the song's events for this block
+    synth->scheduler.collect(synth->sampleClock);
+    synth->songPlayer.feed(synth->scheduler, synth->sampleClock, numFrames);
+
+    // Part levels for this block; single-timbral mode plays every voice at unity through the effects
+    float partGainL[NUM_PARTS], partGainR[NUM_PARTS], partSend[NUM_PARTS];
+    for (int p = 0; p < NUM_PARTS; ++p) {
+        const Part& part = synth->parts[p];
+        if (!synth->multitimbral) {
+            partGainL[p] = partGainR[p] = partSend[p] = 1.0f;
+            continue;
+        }
+        float gain = part.muted ? 0.0f : part.volume;
+        partGainL[p] = gain * (1.0f - std::max(0.0f, part.pan));
+        partGainR[p] = gain * (1.0f + std::min(0.0f, part.pan));
+        partSend[p] = std::clamp(part.fxSend, 0.0f, 1.0f);
+    }
+    int channelPart[16];
+    for (int ch = 0; ch < 16; ++ch) channelPart[ch] = synth->partOf(ch);
+    VoiceModLanes& mpeLanes = synth->mpe.lanes;
+    DspProfiler& profiler = synth->profiler; // loop stages are timed on sampled frames
+
+    // A silent block skips the frame loop, and with it every stage
+    bool asleep = engineAsleep(synth, numEvents, numFrames);
+    if (asleep) {
+        std::fill(buffer, buffer + (size_t)numFrames * 2, (int16_t)0);
+        for (int frame = 0; frame < numFrames; ++frame) {
+            if (int16_t* stemRow = synth->recorder.stemFrame(frame)) std::fill(stemRow, stemRow + stemCount, (int16_t)0);
+            if (!scopeCapture) continue;
+            for (int v = 0; v < scopeVoices; ++v) synth->scope->writeVoice(v, frame, 0.0f);
+            synth->scope->writeMaster(frame, 0.0f, 0.0f);
+        }
+    }
+
+    profiler.mark(DspStage::Control); // block setup
+    for (int frame = 0; frame < numFrames && !asleep; ++frame) {
+        profiler.beginFrame(frame);
+        // Split the block at event boundaries: dispatch everything due on this frame first
+        bool modulationChanged = false;
+        if (nextEvent < numEvents && events[nextEvent].frame <= frame) {
+            do {
+                const MidiEvent& ev = events[nextEvent];
+                // A coalesced controller run glides to its last value over the frames the run covered
+                handleMidiMessage(synth, ev.bytes, ev.size, ev.endFrame - ev.frame);
+                ++nextEvent;
+            } while (nextEvent < numEvents && events[nextEvent].frame <= frame);
+            modulationChanged = true;
+        }
+        if (glide(synth->renderedPitchBend, synth->pitchBend, synth->pitchBendRampFrames, frame)) modulationChanged = true;
+        if (glide(synth->renderedModWheel, synth->modWheelValue, synth->modWheelRampFrames, frame)) {
+            lfoValue = lfoSine * synth->renderedModWheel * 1.0f;
+            modulationChanged = true;
+        }
+        // Mapped parameters step towards the end of their runs once per sub-block
+        if (frame % MODULATION_SUB_BLOCK == 0 && synth->midiMapper.advance(*synth, MODULATION_SUB_BLOCK)) {
+            synth->controlLink.engineChanged();
+        }
+        // MPE lanes glide towards their targets once per sub-block
+        if (synth->mpe.enabled && frame % MODULATION_SUB_BLOCK == 0) {
+            mpeLanes.smooth((int)synth->voices.size(), synth->mpe.pressureDepth);
+            modulationChanged = true;
+        }
+        // Scheduled events and arpeggiator steps land on their exact frame
+        int64_t now = synth->sampleClock + frame;
+        if (now >= synth->scheduler.nextTime()) {
+            dispatchScheduledEvents(synth, now);
+            modulationChanged = true;
+        }
+        if (now >= synth->arp.nextEvent()) {
+            synth->arp.process(*synth, now);
+            modulationChanged = true;
+        }
+        if (modulationChanged) applyPitchModulation(synth, lfoValue);
+        profiler.markFrame(DspStage::Control);
+
+        float mixedSampleL = 0.0f;
+        float mixedSampleR = 0.0f;
+        float dryBusL = 0.0f; // part output that bypasses flanger/delay/reverb
+        float dryBusR = 0.0f;
+
+        // --- Voice Synthesis and Unison ---
+        int16_t* stemRow = synth->recorder.stemFrame(frame); // per-voice recording, when enabled
+        for (size_t v = 0; v < synth->voices.size(); ++v) {
+            bool scopeVoice = scopeCapture && (int)v < scopeVoices;
+            if (!synth->voices[v].isSounding()) {
+                // Idle voices (and so idle parts) cost nothing
+                if (scopeVoice) synth->scope->writeVoice((int)v, frame, 0.0f);
+                if (stemRow && (int)v < stemCount) stemRow[v] = 0;
+                continue;
+            }
+
+            const VoiceParams& voiceParams = synth->voices[v].getParams();
+            int N = (voiceParams.unisonCount > 0) ? voiceParams.unisonCount : synth->unisonCount;
+            float copies = N > 1 ? synth->governor.unisonCopies((int)v) : 1.0f;
+            if (copies == 0.0f) N = 1;
+            int spreadIdx = (voiceParams.unisonSpreadIndex >= 0) ? voiceParams.unisonSpreadIndex : synth->unisonSpreadIndex;
+            float voiceSumL, voiceSumR, centerSample;
+            renderUnison(synth->voices[v], N, spreadIdx, voiceSumL, voiceSumR, centerSample, copies);
+
+            // MPE slide drives the voice's tone filter, pressure its level
+            if (synth->mpe.enabled && v < VoiceModLanes::MAX_VOICES) {
+                mpeLanes.toneL[v] += mpeLanes.toneCoeff[v] * (voiceSumL - mpeLanes.toneL[v]);
+                mpeLanes.toneR[v] += mpeLanes.toneCoeff[v] * (voiceSumR - mpeLanes.toneR[v]);
+                voiceSumL = mpeLanes.toneL[v] * mpeLanes.gain[v];
+                voiceSumR = mpeLanes.toneR[v] * mpeLanes.gain[v];
+            }
+
+            int part = v < VoiceAllocator::MAX_VOICES ? channelPart[synth->voiceAllocator.channelOf((int)v)] : 0;
+            float outL = voiceSumL * voiceParams.mixLevel * partGainL[part];
+            float outR = voiceSumR * voiceParams.mixLevel * partGainR[part];
+            mixedSampleL += outL * partSend[part];
+            mixedSampleR += outR * partSend[part];
+            dryBusL += outL * (1.0f - partSend[part]);
+            dryBusR += outR * (1.0f - partSend[part]);
+            if (stemRow && (int)v < stemCount) {
+                stemRow[v] = static_cast<int16_t>(std::clamp(0.5f * (outL + outR) * voiceNorm, -1.0f, 1.0f) * 32767);
+            }
+            if (scopeVoice) synth->scope->writeVoice((int)v, frame, centerSample);
+        }
+
+        mixedSampleL *= voiceNorm;
+        mixedSampleR *= voiceNorm;
+        dryBusL *= voiceNorm;
+        dryBusR *= voiceNorm;
+        profiler.markFrame(DspStage::Voices);
+
+        // --- Master bus effects ---
+        processFlanger(synth, mixedSampleL, mixedSampleR);
+        profiler.markFrame(DspStage::Flanger);
+        processDelay(synth, mixedSampleL, mixedSampleR);
+        profiler.markFrame(DspStage::Delay);
+        processReverb(synth, mixedSampleL, mixedSampleR);
+        profiler.markFrame(DspStage::Reverb);
+
+        float processedL = mixedSampleL + dryBusL;
+        float processedR = mixedSampleR + dryBusR;
+        if (!synth->busSilence.sleeping(processedL, processedR)) {
+            processCompressor(synth, processedL, processedR);
+            profiler.markFrame(DspStage::Compressor);
+            processFilter(synth, processedL, processedR);
+            profiler.markFrame(DspStage::Filter);
+            processMaster(synth, processedL, processedR);
+            profiler.markFrame(DspStage::Master);
+            synth->busSilence.update(processedL, processedR, BUS_SLEEP_FRAMES);
+        }
+
+        // Clamp final samples
+        float finalSampleL = std::clamp(processedL, -1.0f, 1.0f);
+        float finalSampleR = std::clamp(processedR, -1.0f, 1.0f);
+
+        if (scopeCapture) synth->scope->writeMaster(frame, finalSampleL, finalSampleR);
+
+        Sint16 outSampleL = static_cast<Sint16>(finalSampleL * 32767);
+        Sint16 outSampleR = static_cast<Sint16>(finalSampleR * 32767);
+        buffer[frame * 2] = outSampleL;     // left
+        buffer[frame * 2 + 1] = outSampleR; // right
+        profiler.markFrame(DspStage::Output);
+    }
+    profiler.endFrames(numFrames);
+    if (scopeCapture) synth->scope->endBlock();
+    synth->recorder.capture(buffer, numFrames);
+    if (synth->spectrum) synth->spectrum->push(buffer, numFrames);
+    synth->controlLink.measure(*synth, buffer, numFrames, SAMPLE_RATE);
+    synth->sampleClock += numFrames;
+}
+
+bool renderSong(Synthesizer* synth, std::shared_ptr<const MidiFile> song, int64_t tailFrames,
+                const std::function<bool(const int16_t* block, int numFrames)>& sink) {
+    int16_t buffer[OFFLINE_BLOCK_FRAMES * 2];
+    int64_t end = synth->sampleClock + song->lengthFrames + tailFrames;
+    synth->songPlayer.play(std::move(song), synth->sampleClock);
+    while (synth->sampleClock < end) {
+        renderAudio(synth, buffer, OFFLINE_BLOCK_FRAMES);
+        if (!sink(buffer, OFFLINE_BLOCK_FRAMES)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+struct Synthesizer;
+class Voice;
+class MidiFile;
+
+// The audio engine's render path, shared by the audio callback, the offline renderer and the
+// benchmarks. Everything here runs with g_synthMutex held (or on a synthesizer no other thread sees).
+
+// Render numFrames of interleaved stereo into buffer. A block in which no voice sounds, nothing is due
+// and every effect sleeps is written as silence without running the stages.
+void renderAudio(Synthesizer* synth, int16_t* buffer, int numFrames);
+
+// Apply one MIDI message to the synthesizer. rampFrames > 0: the message ends a coalesced controller
+// run (see MidiQueue) that covered that many frames, and pitch bend, mod wheel and mapped controllers
+// glide to its value over them instead of jumping.
+void handleMidiMessage(Synthesizer* synth, const uint8_t* bytes, int nBytes, int rampFrames = 0);
+
+// Offline render: play song from the synthesizer's current state in OFFLINE_BLOCK_FRAMES blocks on the
+// sample clock, until tailFrames after its end, handing each block to sink. Stops early, returning
+// false, if sink does. Only the sample clock drives it, so a new synthesizer with the same patch and
+// seed renders the same samples every time.
+const int OFFLINE_BLOCK_FRAMES = 512;
+bool renderSong(Synthesizer* synth, std::shared_ptr<const MidiFile> song, int64_t tailFrames,
+                const std::function<bool(const int16_t* block, int numFrames)>& sink);
+
+// One frame of a voice with count unison copies (1-8) spread by spreadIndex (0-4, the unison spread
+// setting). left and right get the mix, center the voice without its copies. copies (0-1) crossfades
+// the mix towards the voice alone, to fade the copies out.
+void renderUnison(Voice& voice, int count, int spreadIndex, float& left, float& right, float& center, float copies = 1.0f);
+
+// Effect stages of the master bus, one stereo frame at a time, in the order renderAudio runs them.
+// Each is a no-op while its effect is disabled; flanger, delay and reverb also sleep while their input
+// and tail are silent (see SilenceDetector).
+void processFlanger(Synthesizer* synth, float& left, float& right);
+void processDelay(Synthesizer* synth, float& left, float& right);
+void processReverb(Synthesizer* synth, float& left, float& right);
+void processCompressor(Synthesizer* synth, float& left, float& right);
+void processFilter(Synthesizer* synth, float& left, float& right);
+// DC filter, soft clip, auto gain, master volume and pan
+void processMaster(Synthesizer* synth, float& left, float& right);
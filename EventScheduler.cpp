@@ -0,0 +1,42 @@
+#include "EventScheduler.h"
+#include <algorithm>
+
+namespace {
+
+// Heap order: std::push_heap keeps the "largest" on top, so the later event compares as smaller
+bool firesLater(const ScheduledEvent& a, const ScheduledEvent& b) {
+    if (a.time != b.time) return a.time > b.time;
+    return (int32_t)(a.order - b.order) > 0;
+}
+
+} // namespace
+
+bool EventScheduler::post(const ScheduledEvent& event) {
+    if (ring.push(event)) return true;
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void EventScheduler::collect(int64_t blockStart) {
+    clock.store(blockStart, std::memory_order_relaxed);
+    ScheduledEvent event;
+    while (ring.pop(event)) schedule(event);
+}
+
+bool EventScheduler::schedule(const ScheduledEvent& event) {
+    if (count == CAPACITY) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    heap[count] = event;
+    heap[count].order = nextOrder++;
+    std::push_heap(heap, heap + ++count, firesLater);
+    return true;
+}
+
+bool EventScheduler::pop(int64_t now, ScheduledEvent& event) {
+    if (count == 0 || heap[0].time > now) return false;
+    std::pop_heap(heap, heap + count, firesLater);
+    event = heap[--count];
+    return true;
+}
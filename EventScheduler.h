@@ -0,0 +1,55 @@
+#pragma once
+
+#include "LockFree.h"
+#include <atomic>
+#include <cstdint>
+
+enum class ScheduledKind : uint8_t {
+    Midi,          // bytes/size: a channel message, played as if it came from a MIDI input
+    NoteOff,       // bytes[0] channel, bytes[1] note; only releases the note if voice still plays it (-1: always)
+    MelodyStep,    // next chord of the startup melody
+    MelodyNoteOff, // a melody note ending; dropped if the melody was stopped since
+};
+
+struct ScheduledEvent {
+    int64_t time = 0;    // sample clock position; anything earlier than the current frame fires right away
+    uint32_t order = 0;  // set by the scheduler so events with the same time fire in arrival order
+    ScheduledKind kind = ScheduledKind::Midi;
+    uint8_t bytes[3] = {0, 0, 0};
+    uint8_t size = 0;
+    int16_t voice = -1;
+    uint32_t generation = 0; // melody run the event belongs to
+};
+
+// Engine-side event timeline on the 64-bit sample clock (Synthesizer::sampleClock).
+// Any thread may post() without locking; the audio thread moves posted events into a binary heap
+// once per block and pops them on the exact frame they are due. Code already running on the audio
+// thread (an event scheduling its follow-up) uses schedule() to insert straight into the heap.
+// Nothing allocates: the heap is a fixed array, and events that do not fit are counted and dropped.
+class EventScheduler {
+public:
+    static constexpr int CAPACITY = 1024;
+    static constexpr int64_t IDLE = INT64_MAX;
+
+    // Any thread
+    bool post(const ScheduledEvent& event);
+    // Sample clock at the start of the block being rendered, for computing post() times
+    int64_t now() const { return clock.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Audio thread: start of a block at sample position blockStart
+    void collect(int64_t blockStart);
+    // Audio thread
+    bool schedule(const ScheduledEvent& event);
+    int64_t nextTime() const { return count > 0 ? heap[0].time : IDLE; }
+    // Earliest event due at or before now, if any
+    bool pop(int64_t now, ScheduledEvent& event);
+
+private:
+    MpscRing<ScheduledEvent, 1024> ring;
+    ScheduledEvent heap[CAPACITY];
+    int count = 0;
+    uint32_t nextOrder = 0;
+    std::atomic<int64_t> clock{0};
+    std::atomic<uint64_t> dropped{0};
+};
@@ -0,0 +1,48 @@
+#include "Fft.h"
+#include <cmath>
+#include <utility>
+
+Fft::Fft(int size) : n(size), twRe(size), twIm(size) {
+    int bits = 0;
+    while ((1 << bits) < n) ++bits;
+    for (int i = 0; i < n; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) r |= ((i >> b) & 1) << (bits - 1 - b);
+        if (i < r) {
+            swaps.push_back(i);
+            swaps.push_back(r);
+        }
+    }
+    for (int half = 1; half < n; half <<= 1) {
+        for (int k = 0; k < half; ++k) {
+            double angle = -M_PI * k / half;
+            twRe[half + k] = (float)std::cos(angle);
+            twIm[half + k] = (float)std::sin(angle);
+        }
+    }
+}
+
+void Fft::forward(float* re, float* im) const {
+    for (size_t s = 0; s < swaps.size(); s += 2) {
+        std::swap(re[swaps[s]], re[swaps[s + 1]]);
+        std::swap(im[swaps[s]], im[swaps[s + 1]]);
+    }
+    for (int half = 1; half < n; half <<= 1) {
+        const float* __restrict wRe = twRe.data() + half;
+        const float* __restrict wIm = twIm.data() + half;
+        for (int block = 0; block < n; block += 2 * half) {
+            float* __restrict aRe = re + block;
+            float* __restrict aIm = im + block;
+            float* __restrict bRe = re + block + half;
+            float* __restrict bIm = im + block + half;
+            for (int k = 0; k < half; ++k) {
+                float tRe = bRe[k] * wRe[k] - bIm[k] * wIm[k];
+                float tIm = bRe[k] * wIm[k] + bIm[k] * wRe[k];
+                bRe[k] = aRe[k] - tRe;
+                bIm[k] = aIm[k] - tIm;
+                aRe[k] += tRe;
+                aIm[k] += tIm;
+            }
+        }
+    }
+}
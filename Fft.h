@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+// In-place complex FFT of a fixed power-of-two size on split real/imaginary arrays.
+// The bit-reversal permutation and every stage's twiddles are computed once in the constructor,
+// and each stage reads its twiddles contiguously, so the butterfly loops vectorize.
+class Fft {
+public:
+    explicit Fft(int size);
+
+    int size() const { return n; }
+    void forward(float* re, float* im) const;
+
+private:
+    int n;
+    std::vector<int> swaps;    // index pairs exchanged by the bit-reversal permutation
+    std::vector<float> twRe;   // stage with half-length h uses entries [h, 2h): e^(-i*pi*k/h)
+    std::vector<float> twIm;
+};
@@ -1,6 +1,7 @@
 #include "Filter.h"
+#include <algorithm>
 
-Filter::Filter() : cutoff(1000.0f), resonance(0.707f), drive(1.0f), inertial(0.0f), oversampling(0), sampleRate(48000.0f), smoothedCutoff(1000.0f), smoothedResonance(0.707f), b0(1.0f), b1(0.0f), b2(0.0f), a1(0.0f), a2(0.0f), x1(0.0f), x2(0.0f), y1(0.0f), y2(0.0f) {
+Filter::Filter() : cutoff(1000.0f), resonance(0.707f), drive(1.0f), inertial(0.0f), oversampling(0), sampleRate(48000.0f), smoothedCutoff(1000.0f), smoothedResonance(0.707f), lastCutoff(-1.0f), lastResonance(-1.0f), b0(1.0f), b1(0.0f), b2(0.0f), a1(0.0f), a2(0.0f), x1(0.0f), x2(0.0f), y1(0.0f), y2(0.0f) {
     updateCoefficients();
 }
 
@@ -24,6 +25,10 @@ void Filter::setOversampling(int os) {
     oversampling = os;
 }
 
+void Filter::bypassOversampling(bool bypass) {
+    oversamplingBypassed = bypass;
+}
+
 void Filter::setSampleRate(float sr) {
     sampleRate = sr;
     updateCoefficients();
@@ -36,8 +41,6 @@ float Filter::process(float input) {
     smoothedResonance = alpha * smoothedResonance + (1.0f - alpha) * resonance;
 
     // Update coefficients if needed (only when parameters change significantly)
-    static float lastCutoff = -1.0f;
-    static float lastResonance = -1.0f;
     if (fabs(smoothedCutoff - lastCutoff) > 1.0f || fabs(smoothedResonance - lastResonance) > 0.01f) {
         lastCutoff = smoothedCutoff;
         lastResonance = smoothedResonance;
@@ -56,31 +59,25 @@ float Filter::process(float input) {
     float output = input;
 
     if (oversampling > 0) {
-        // Upsample
-        int factor = oversampling;
-        upsampled.resize(factor);
-        upsampled[0] = input;
-        for (int i = 1; i < factor; ++i) {
-            upsampled[i] = 0.0f; // Zero stuffing or linear interp, simple zero for now
+        float target = oversamplingBypassed ? 1.0f : 0.0f;
+        if (bypassMix != target) {
+            // A path fading in starts from rest rather than from where it stopped
+            if (bypassMix == 0.0f) bx1 = bx2 = by1 = by2 = 0.0f;
+            if (bypassMix == 1.0f) x1 = x2 = y1 = y2 = 0.0f;
+            float step = 1.0f / (BYPASS_FADE_SECONDS * sampleRate);
+            bypassMix = target > bypassMix ? std::min(target, bypassMix + step) : std::max(target, bypassMix - step);
         }
-
-        // Filter at high rate
-        filtered.resize(factor);
-        for (int i = 0; i < factor; ++i) {
-            float highInput = upsampled[i];
-            filtered[i] = b0 * highInput + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
-            x2 = x1;
-            x1 = highInput;
-            y2 = y1;
-            y1 = filtered[i];
+        float oversampled = bypassMix < 1.0f ? processOversampled(input) : 0.0f;
+        float bypassed = 0.0f;
+        if (bypassMix > 0.0f) {
+            bypassed = b0 * input + b1 * bx1 + b2 * bx2 - a1 * by1 - a2 * by2;
+            bx2 = bx1;
+            bx1 = input;
+            by2 = by1;
+            by1 = bypassed;
+            bypassed /= oversampling; // the zero-stuffed path keeps 1/factor of the level
         }
-
-        // Downsample by averaging
-        output = 0.0f;
-        for (int i = 0; i < factor; ++i) {
-            output += filtered[i];
-        }
-        output /= factor;
+        output = oversampled + bypassMix * (bypassed - oversampled);
     } else {
         // No oversampling
         output = b0 * input + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
@@ -93,6 +90,34 @@ float Filter::process(float input) {
     return output;
 }
 
+float Filter::processOversampled(float input) {
+    // Upsample
+    int factor = oversampling;
+    upsampled.resize(factor);
+    upsampled[0] = input;
+    for (int i = 1; i < factor; ++i) {
+        upsampled[i] = 0.0f; // Zero stuffing or linear interp, simple zero for now
+    }
+
+    // Filter at high rate
+    filtered.resize(factor);
+    for (int i = 0; i < factor; ++i) {
+        float highInput = upsampled[i];
+        filtered[i] = b0 * highInput + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1;
+        x1 = highInput;
+        y2 = y1;
+        y1 = filtered[i];
+    }
+
+    // Downsample by averaging
+    float output = 0.0f;
+    for (int i = 0; i < factor; ++i) {
+        output += filtered[i];
+    }
+    return output / factor;
+}
+
 float Filter::getCutoff() const {
     return cutoff;
 }
@@ -5,6 +5,8 @@
 
 class Filter {
 public:
+    static constexpr float BYPASS_FADE_SECONDS = 0.005f;
+
     Filter();
 
     void setCutoff(float cutoffHz);
@@ -12,6 +14,9 @@ public:
     void setDrive(float drive); // Input gain, causes saturation
     void setInertial(float inertial); // Smoothing factor for parameter changes (0-1)
     void setOversampling(int oversampling); // 0, 2, 4, 8 times sample rate
+    // Run at the sample rate, keeping the setting (load governor). The two paths crossfade over
+    // BYPASS_FADE_SECONDS, the bypass scaled to the oversampled path's level.
+    void bypassOversampling(bool bypass);
     void setSampleRate(float sampleRate);
 
     float process(float input);
@@ -24,17 +29,22 @@ public:
 
 private:
     void updateCoefficients();
+    float processOversampled(float input);
 
     float cutoff;
     float resonance;
     float drive;
     float inertial;
     int oversampling;
+    bool oversamplingBypassed = false;
+    float bypassMix = 0.0f; // 0: oversampled path, 1: bypass, in between while they crossfade
     float sampleRate;
 
     // Smoothing state
     float smoothedCutoff;
     float smoothedResonance;
+    float lastCutoff;    // smoothed values the coefficients were last computed for
+    float lastResonance;
 
     // Filter coefficients
     float b0, b1, b2, a1, a2;
@@ -43,6 +53,10 @@ private:
     float x1, x2; // Previous inputs
     float y1, y2; // Previous outputs
 
+    // State of the bypass, apart from the oversampled path's so either can fade in from rest
+    float bx1 = 0.0f, bx2 = 0.0f;
+    float by1 = 0.0f, by2 = 0.0f;
+
     // Oversampling buffers
     std::vector<float> upsampled;
     std::vector<float> filtered;
@@ -0,0 +1,322 @@
+// sdl3-synth-golden: renders test cases offline and compares them with stored golden renders, so a DSP
+// change can be shown to leave the output alone (or to change it only as much as intended).
+//
+//   sdl3-synth-golden [--update] [--tolerance lsb] [--spectral db] case.json|directory ...
+//
+// A case is a JSON file; every key is optional:
+//   {
+//     "Preset": "warm-pad.json",   preset file, relative to the case
+//     "Patch": { ... },            preset keys applied on top of it
+//     "Seed": 0,                   seed of the noise oscillators and the random arpeggio
+//     "Song": "riff.mid",          MIDI file to play, relative to the case
+//     "Notes": [{"Time": 0.0, "Note": 60, "Velocity": 100, "Length": 0.5, "Channel": 0}],
+//     "Tail": 2.0,                 seconds rendered after the last event
+//     "Compare": "Exact",          or "Tolerance" (MaxDiff) or "Spectral" (MaxSpectralDb)
+//     "MaxDiff": 2,                largest sample difference allowed, in 16-bit steps
+//     "MaxSpectralDb": -60         largest spectral difference allowed, relative to the golden render
+//   }
+// The golden render is <case>.wav next to the case file; --update writes it. When a case fails, its
+// render is saved as <case>.actual.wav for listening. --tolerance and --spectral override the
+// comparison of every case. The exit code is 0 only if all cases passed.
+
+#include "Engine.h"
+#include "Synthesizer.h"
+#include "Patch.h"
+#include "Preset.h"
+#include "MidiFile.h"
+#include "WavWriter.h"
+#include "Fft.h"
+#include "SineTable.h"
+#include "Utils.h"
+#include <SDL3/SDL.h>
+#include <cJSON.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Preset.cpp's live load and save work on the application's engine and window. The runner only
+// reads presets into engines of its own, so these stay idle.
+Synthesizer g_synth;
+std::mutex g_synthMutex;
+SDL_Window* g_window = nullptr;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum class Compare { Exact, Tolerance, Spectral };
+
+struct Case {
+    Patch patch;
+    uint32_t seed = 0;
+    std::shared_ptr<MidiFile> song = std::make_shared<MidiFile>();
+    double tailSeconds = 2.0;
+    Compare compare = Compare::Exact;
+    int maxDiff = 0;
+    double maxSpectralDb = -60.0;
+};
+
+struct Options {
+    bool update = false;
+    int tolerance = -1;       // --tolerance: compare every case this way
+    double spectralDb = 0.0;  // --spectral, when overrideSpectral
+    bool overrideSpectral = false;
+};
+
+struct Difference {
+    bool sameLength = true;
+    int maxDiff = 0;          // 16-bit steps
+    double rmsDb = -INFINITY; // of the difference, dBFS
+    double spectralDb = -INFINITY;
+};
+
+const int SPECTRUM_SIZE = 2048;
+
+std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+double numberOr(cJSON* object, const char* key, double fallback) {
+    cJSON* item = cJSON_GetObjectItem(object, key);
+    return item && cJSON_IsNumber(item) ? item->valuedouble : fallback;
+}
+
+bool loadCase(const fs::path& path, Case& c, std::string& error) {
+    cJSON* root = cJSON_Parse(readFile(path).c_str());
+    if (!root) {
+        error = "cannot parse " + path.string();
+        return false;
+    }
+    // Everything not set by the case keeps the engine's defaults
+    auto defaults = std::make_unique<Synthesizer>();
+    c.patch.capture(*defaults);
+    fs::path dir = path.parent_path();
+    bool ok = true;
+
+    cJSON* item = cJSON_GetObjectItem(root, "Preset");
+    if (item && cJSON_IsString(item) && !Preset::read((dir / item->valuestring).string(), c.patch)) {
+        error = std::string("cannot read preset ") + item->valuestring;
+        ok = false;
+    }
+    item = cJSON_GetObjectItem(root, "Patch");
+    if (item && cJSON_IsObject(item)) Preset::fromJson(item, c.patch);
+
+    c.seed = (uint32_t)numberOr(root, "Seed", 0);
+    c.tailSeconds = numberOr(root, "Tail", 2.0);
+    item = cJSON_GetObjectItem(root, "Compare");
+    if (item && cJSON_IsString(item)) {
+        if (strcmp(item->valuestring, "Tolerance") == 0) c.compare = Compare::Tolerance;
+        else if (strcmp(item->valuestring, "Spectral") == 0) c.compare = Compare::Spectral;
+    }
+    c.maxDiff = (int)numberOr(root, "MaxDiff", 0);
+    c.maxSpectralDb = numberOr(root, "MaxSpectralDb", -60.0);
+
+    item = cJSON_GetObjectItem(root, "Song");
+    if (ok && item && cJSON_IsString(item) && !c.song->load((dir / item->valuestring).string(), SAMPLE_RATE, error)) ok = false;
+
+    // The note script joins the song's events on the same timeline
+    cJSON* notes = cJSON_GetObjectItem(root, "Notes");
+    cJSON* note = nullptr;
+    if (notes && cJSON_IsArray(notes)) {
+        cJSON_ArrayForEach(note, notes) {
+            int channel = std::clamp((int)numberOr(note, "Channel", 0), 0, 15);
+            int key = std::clamp((int)numberOr(note, "Note", 60), 0, 127);
+            int velocity = std::clamp((int)numberOr(note, "Velocity", 100), 1, 127);
+            int64_t on = (int64_t)std::llround(numberOr(note, "Time", 0.0) * SAMPLE_RATE);
+            int64_t off = on + (int64_t)std::llround(numberOr(note, "Length", 0.5) * SAMPLE_RATE);
+            c.song->events.push_back({on, {(uint8_t)(0x90 | channel), (uint8_t)key, (uint8_t)velocity}, 3});
+            c.song->events.push_back({off, {(uint8_t)(0x80 | channel), (uint8_t)key, 0}, 3});
+            c.song->lengthFrames = std::max(c.song->lengthFrames, off);
+        }
+    }
+    std::stable_sort(c.song->events.begin(), c.song->events.end(),
+                     [](const SongEvent& a, const SongEvent& b) { return a.frame < b.frame; });
+    cJSON_Delete(root);
+    return ok;
+}
+
+std::vector<int16_t> render(const Case& c) {
+    auto synth = std::make_unique<Synthesizer>();
+    c.patch.apply(*synth);
+    synth->seedRandom(c.seed);
+    std::vector<int16_t> samples;
+    renderSong(synth.get(), c.song, (int64_t)(c.tailSeconds * SAMPLE_RATE), [&](const int16_t* block, int numFrames) {
+        samples.insert(samples.end(), block, block + numFrames * 2);
+        return true;
+    });
+    return samples;
+}
+
+bool writeWav(const fs::path& path, const std::vector<int16_t>& samples) {
+    WavWriter wav;
+    if (!wav.open(path.string(), SAMPLE_RATE, 2)) return false;
+    bool ok = wav.write(samples.data(), samples.size() / 2);
+    return wav.close() && ok;
+}
+
+// 16-bit stereo PCM at SAMPLE_RATE, as WavWriter writes it
+bool readWav(const fs::path& path, std::vector<int16_t>& samples) {
+    std::string data = readFile(path);
+    auto u16 = [&](size_t at) { return (uint32_t)(uint8_t)data[at] | (uint32_t)(uint8_t)data[at + 1] << 8; };
+    auto u32 = [&](size_t at) { return u16(at) | u16(at + 2) << 16; };
+    if (data.size() < 12 || data.compare(0, 4, "RIFF") != 0 || data.compare(8, 4, "WAVE") != 0) return false;
+    bool formatOk = false;
+    for (size_t at = 12; at + 8 <= data.size();) {
+        uint32_t size = u32(at + 4);
+        if (at + 8 + size > data.size()) return false;
+        if (data.compare(at, 4, "fmt ") == 0 && size >= 16) {
+            formatOk = u16(at + 8) == 1 && u16(at + 10) == 2 && u32(at + 12) == (uint32_t)SAMPLE_RATE && u16(at + 22) == 16;
+        } else if (data.compare(at, 4, "data") == 0) {
+            if (!formatOk) return false;
+            samples.resize(size / 2);
+            for (size_t i = 0; i < samples.size(); ++i) samples[i] = (int16_t)u16(at + 8 + 2 * i);
+            return true;
+        }
+        at += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+// Magnitude spectra of the mono mix, Hann windowed, half-overlapping
+std::vector<float> spectra(const std::vector<int16_t>& samples, const Fft& fft) {
+    const int n = SPECTRUM_SIZE;
+    size_t frames = samples.size() / 2;
+    std::vector<float> out, re(n), im(n);
+    for (size_t start = 0; start < frames; start += n / 2) {
+        for (int i = 0; i < n; ++i) {
+            float window = 0.5f - 0.5f * std::cos(2.0f * (float)M_PI * i / n);
+            size_t f = start + i;
+            re[i] = f < frames ? window * (samples[2 * f] + samples[2 * f + 1]) * (0.5f / 32768.0f) : 0.0f;
+            im[i] = 0.0f;
+        }
+        fft.forward(re.data(), im.data());
+        for (int k = 0; k <= n / 2; ++k) out.push_back(std::sqrt(re[k] * re[k] + im[k] * im[k]));
+    }
+    return out;
+}
+
+Difference compare(const std::vector<int16_t>& golden, const std::vector<int16_t>& actual, const Fft& fft) {
+    Difference d;
+    d.sameLength = golden.size() == actual.size();
+    size_t n = std::min(golden.size(), actual.size());
+    double sumSquares = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        int diff = std::abs(golden[i] - actual[i]);
+        d.maxDiff = std::max(d.maxDiff, diff);
+        sumSquares += (double)diff * diff;
+    }
+    if (sumSquares > 0.0) d.rmsDb = 10.0 * std::log10(sumSquares / std::max<size_t>(n, 1) / (32768.0 * 32768.0));
+
+    // Energy of the difference between magnitude spectra relative to the golden's energy: blind to
+    // phase, so it tolerates changes that only shift or reorder the waveform
+    std::vector<float> g = spectra(golden, fft), a = spectra(actual, fft);
+    double diffEnergy = 0.0, energy = 1e-20;
+    for (size_t i = 0; i < std::max(g.size(), a.size()); ++i) {
+        double gm = i < g.size() ? g[i] : 0.0, am = i < a.size() ? a[i] : 0.0;
+        diffEnergy += (am - gm) * (am - gm);
+        energy += gm * gm;
+    }
+    if (diffEnergy > 0.0) d.spectralDb = 10.0 * std::log10(diffEnergy / energy);
+    return d;
+}
+
+std::vector<fs::path> collectCases(int argc, char* argv[], Options& options) {
+    std::vector<fs::path> cases;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--update") == 0) {
+            options.update = true;
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            options.tolerance = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--spectral") == 0 && i + 1 < argc) {
+            options.overrideSpectral = true;
+            options.spectralDb = atof(argv[++i]);
+        } else if (fs::is_directory(argv[i])) {
+            std::vector<fs::path> found;
+            for (const fs::directory_entry& entry : fs::directory_iterator(argv[i])) {
+                if (entry.path().extension() == ".json") found.push_back(entry.path());
+            }
+            std::sort(found.begin(), found.end());
+            cases.insert(cases.end(), found.begin(), found.end());
+        } else {
+            cases.push_back(argv[i]);
+        }
+    }
+    return cases;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    std::vector<fs::path> cases = collectCases(argc, argv, options);
+    if (cases.empty()) {
+        SDL_Log("Usage: %s [--update] [--tolerance lsb] [--spectral db] case.json|directory ...", argv[0]);
+        return 1;
+    }
+    initSineTable();
+    Fft fft(SPECTRUM_SIZE);
+
+    int failed = 0;
+    for (const fs::path& path : cases) {
+        std::string name = path.stem().string();
+        fs::path goldenPath = fs::path(path).replace_extension(".wav");
+        fs::path actualPath = fs::path(path).replace_extension(".actual.wav");
+        Case c;
+        std::string error;
+        if (!loadCase(path, c, error)) {
+            SDL_Log("ERROR %s: %s", name.c_str(), error.c_str());
+            ++failed;
+            continue;
+        }
+        if (options.tolerance >= 0) {
+            c.compare = Compare::Tolerance;
+            c.maxDiff = options.tolerance;
+        } else if (options.overrideSpectral) {
+            c.compare = Compare::Spectral;
+            c.maxSpectralDb = options.spectralDb;
+        }
+        std::vector<int16_t> actual = render(c);
+
+        if (options.update) {
+            bool ok = writeWav(goldenPath, actual);
+            SDL_Log("%s %s (%.2f s)", ok ? "WROTE" : "ERROR", goldenPath.string().c_str(), actual.size() / 2.0 / SAMPLE_RATE);
+            if (!ok) ++failed;
+            continue;
+        }
+        std::vector<int16_t> golden;
+        if (!readWav(goldenPath, golden)) {
+            SDL_Log("ERROR %s: no golden render %s (run with --update)", name.c_str(), goldenPath.string().c_str());
+            ++failed;
+            continue;
+        }
+
+        Difference d = compare(golden, actual, fft);
+        bool pass = d.sameLength;
+        if (c.compare == Compare::Exact) pass = pass && d.maxDiff == 0;
+        else if (c.compare == Compare::Tolerance) pass = pass && d.maxDiff <= c.maxDiff;
+        else pass = pass && d.spectralDb <= c.maxSpectralDb;
+
+        char details[160];
+        snprintf(details, sizeof(details), "max diff %d, rms %.1f dBFS, spectral %.1f dB%s", d.maxDiff, d.rmsDb,
+                 d.spectralDb, d.sameLength ? "" : ", length differs");
+        SDL_Log("%s %s: %s", pass ? "PASS" : "FAIL", name.c_str(), d.maxDiff == 0 && d.sameLength ? "identical" : details);
+        if (pass) {
+            std::error_code ec;
+            fs::remove(actualPath, ec); // left over from an earlier failure
+        } else {
+            ++failed;
+            writeWav(actualPath, actual);
+        }
+    }
+    SDL_Log("%d of %d cases passed", (int)cases.size() - failed, (int)cases.size());
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+#include "LoadGovernor.h"
+#include "LockFree.h"
+#include "Synthesizer.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const char* ACTION_NAMES[(int)GovernorAction::Count] = {"cull_tails", "quiet_unison", "oversampling", "all_unison"};
+
+} // namespace
+
+const char* governorActionName(GovernorAction action) {
+    return ACTION_NAMES[(int)action];
+}
+
+void LoadGovernor::update(Synthesizer& synth, float load, int numFrames, int sampleRate) {
+    if (cooldown > 0) --cooldown;
+    fadeStep = 1.0f / (UNISON_FADE_SECONDS * sampleRate);
+    if (!enabled.load(std::memory_order_relaxed)) {
+        while (level > 0) restore(synth, load);
+    } else if (load > highLoad.load(std::memory_order_relaxed)) {
+        quietFrames = 0;
+        if (cooldown == 0 && level < (int)GovernorAction::Count) {
+            engage(synth, load);
+            cooldown = COOLDOWN_CALLBACKS;
+        }
+    } else if (load < lowLoad.load(std::memory_order_relaxed) && level > 0) {
+        quietFrames += numFrames;
+        if (quietFrames >= (int64_t)(RESTORE_SECONDS * sampleRate)) {
+            restore(synth, load);
+            quietFrames = 0;
+        }
+    } else {
+        quietFrames = 0;
+    }
+
+    int numVoices = std::min((int)synth.voices.size(), MAX_VOICES);
+    // Voices get their copies back with their next note
+    for (int v = 0; v < numVoices; ++v) {
+        if (capped[v] && !synth.voices[v].isSounding()) {
+            capped[v] = false;
+            copiesFade[v] = 0.0f;
+        }
+    }
+    if (level == 0) return;
+
+    if (engaged(GovernorAction::CullTails)) {
+        float threshold = std::pow(10.0f, cullDb.load(std::memory_order_relaxed) / 20.0f);
+        uint64_t culled = 0;
+        for (Voice& voice : synth.voices) {
+            // The allocator reclaims it once the fade has ended
+            if (voice.isReleasing() && voice.getLevel() < threshold && voice.fadeOut(CULL_FADE_SECONDS)) ++culled;
+        }
+        if (culled) bump(culledCount, culled);
+    }
+
+    if (engaged(GovernorAction::AllUnison)) {
+        for (int v = 0; v < numVoices; ++v) {
+            if (synth.voices[v].isSounding()) capped[v] = true;
+        }
+    } else if (engaged(GovernorAction::QuietUnison)) {
+        // Everything below the median level
+        float levels[MAX_VOICES];
+        int sounding = 0;
+        for (int v = 0; v < numVoices; ++v) {
+            if (synth.voices[v].isSounding()) levels[sounding++] = synth.voices[v].getLevel();
+        }
+        if (sounding > 1) {
+            std::nth_element(levels, levels + sounding / 2, levels + sounding);
+            float median = levels[sounding / 2];
+            for (int v = 0; v < numVoices; ++v) {
+                if (synth.voices[v].isSounding() && synth.voices[v].getLevel() < median) capped[v] = true;
+            }
+        }
+    }
+}
+
+void LoadGovernor::engage(Synthesizer& synth, float load) {
+    GovernorAction action = (GovernorAction)level++;
+    // Without oversampling there is nothing to bypass, so the next step is taken instead
+    oversamplingSkipped = action == GovernorAction::Oversampling && (!synth.filterEnabled || synth.filter.getOversampling() == 0);
+    if (oversamplingSkipped) action = (GovernorAction)level++;
+    publishedSkipped.store(oversamplingSkipped, std::memory_order_relaxed);
+    if (action == GovernorAction::Oversampling) synth.filter.bypassOversampling(true);
+    bump(engagedCount[(int)action]);
+    publishedLevel.store(level, std::memory_order_relaxed);
+    LOG_WARN("DSP load %.0f%%: governor engaged %s", load * 100.0f, governorActionName(action));
+}
+
+void LoadGovernor::restore(Synthesizer& synth, float load) {
+    GovernorAction action = (GovernorAction)--level;
+    if (level - 1 == (int)GovernorAction::Oversampling && oversamplingSkipped) {
+        --level; // it was passed over on the way up
+        oversamplingSkipped = false;
+        publishedSkipped.store(false, std::memory_order_relaxed);
+    }
+    if (action == GovernorAction::Oversampling) synth.filter.bypassOversampling(false);
+    bump(restoredCount[(int)action]);
+    publishedLevel.store(level, std::memory_order_relaxed);
+    LOG_INFO("DSP load %.0f%%: governor restored %s", load * 100.0f, governorActionName(action));
+}
+
+void LoadGovernor::report(GovernorReport& out) const {
+    out.level = publishedLevel.load(std::memory_order_relaxed);
+    out.oversamplingSkipped = publishedSkipped.load(std::memory_order_relaxed);
+    for (int a = 0; a < (int)GovernorAction::Count; ++a) {
+        out.engaged[a] = engagedCount[a].load(std::memory_order_relaxed);
+        out.restored[a] = restoredCount[a].load(std::memory_order_relaxed);
+    }
+    out.voicesCulled = culledCount.load(std::memory_order_relaxed);
+}
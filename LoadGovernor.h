@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+struct Synthesizer;
+
+// The governor's ladder, least audible first. Each step is engaged on top of the ones before it.
+enum class GovernorAction {
+    CullTails,    // released voices below the audibility threshold fade out within a few ms
+    QuietUnison,  // the quieter half of the sounding voices play without unison copies
+    Oversampling, // the master filter runs without oversampling (skipped when it has none)
+    AllUnison,    // no voice plays unison copies
+    Count
+};
+
+const char* governorActionName(GovernorAction action);
+
+struct GovernorReport {
+    int level = 0;                                        // steps up the ladder now
+    bool oversamplingSkipped = false;                     // one of them passed over Oversampling
+    uint64_t engaged[(int)GovernorAction::Count] = {};    // times each action was engaged, since start
+    uint64_t restored[(int)GovernorAction::Count] = {};
+    uint64_t voicesCulled = 0;
+};
+
+// Keeps the audio callback inside its deadline when the DSP load spikes, by giving up what is least
+// audible first instead of letting the device drop out.
+// It reads the profiler's load of the previous callback before every block. Above highLoad it engages
+// the next action of the ladder, at most one per COOLDOWN_CALLBACKS so the last one shows in the load
+// first; once the load has stayed below lowLoad for RESTORE_SECONDS it restores the last action.
+// A voice that loses its unison copies fades them out over UNISON_FADE_SECONDS and keeps them off until
+// its note ends, so nothing switches abruptly in mid-note. Without the profiler (SYNTH_PROFILER=OFF) there is no load figure and it never engages.
+// The settings are atomics the GUI writes; everything else belongs to the audio thread, except the
+// counters in report().
+class LoadGovernor {
+public:
+    static constexpr int MAX_VOICES = 128;
+    static constexpr int COOLDOWN_CALLBACKS = 2;
+    static constexpr float RESTORE_SECONDS = 2.0f;
+    static constexpr float UNISON_FADE_SECONDS = 0.005f;
+    static constexpr float CULL_FADE_SECONDS = 0.005f;
+
+    std::atomic<bool> enabled{true};
+    std::atomic<float> highLoad{0.85f}; // shares of the buffer's duration
+    std::atomic<float> lowLoad{0.5f};
+    std::atomic<float> cullDb{-50.0f};  // release tails quieter than this (0 dB = full velocity) may be cut
+
+    // Audio thread, before a block: react to the last callback's load and apply the engaged actions
+    void update(Synthesizer& synth, float load, int numFrames, int sampleRate);
+    // Audio thread, once per frame for each sounding voice: level of its unison copies, from 1 (all of
+    // them) down to 0 (the voice alone) while they fade out
+    float unisonCopies(int voice) {
+        if (voice >= MAX_VOICES || !capped[voice]) return 1.0f;
+        copiesFade[voice] = std::min(1.0f, copiesFade[voice] + fadeStep);
+        return 1.0f - copiesFade[voice];
+    }
+
+    // Any thread
+    void report(GovernorReport& out) const;
+
+private:
+    void engage(Synthesizer& synth, float load);
+    void restore(Synthesizer& synth, float load);
+    bool engaged(GovernorAction action) const { return level > (int)action; }
+
+    // Audio thread
+    int level = 0;
+    int cooldown = 0;
+    int64_t quietFrames = 0; // below lowLoad since the last change
+    bool oversamplingSkipped = false; // engaged with nothing to bypass
+    bool capped[MAX_VOICES] = {};
+    float copiesFade[MAX_VOICES] = {}; // 0 until capped, then up to 1 when the copies are gone
+    float fadeStep = 0.0f;             // per frame
+
+    std::atomic<int> publishedLevel{0};
+    std::atomic<bool> publishedSkipped{false};
+    std::atomic<uint64_t> engagedCount[(int)GovernorAction::Count] = {};
+    std::atomic<uint64_t> restoredCount[(int)GovernorAction::Count] = {};
+    std::atomic<uint64_t> culledCount{0};
+};
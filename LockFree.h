@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// Add to a counter that only one thread writes and others just read. With a single writer a relaxed
+// load and store is enough, and it avoids the locked read-modify-write of fetch_add on the audio thread.
+template <typename T>
+inline void bump(std::atomic<T>& counter, std::type_identity_t<T> n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Bounded single-producer/single-consumer ring buffer.
+// push() and pop() never allocate, lock or block, so either end may live on the audio thread.
+// N must be a power of two.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) return false; // full
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false; // empty
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    bool full() const { return size() >= N; }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return N; }
+
+private:
+    alignas(64) std::atomic<size_t> head{0}; // written by the producer
+    alignas(64) std::atomic<size_t> tail{0}; // written by the consumer
+    T items[N];
+};
+
+// Bounded multi-producer/single-consumer ring buffer (Vyukov's sequence-numbered slots).
+// Producers claim a slot with one compare-exchange and never block each other for longer than
+// that; a full ring makes push() fail instead of waiting. N must be a power of two.
+template <typename T, size_t N>
+class MpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscRing size must be a power of two");
+
+public:
+    MpscRing() {
+        for (size_t i = 0; i < N; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const T& item) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & (N - 1)];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.item = item;
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Single consumer only
+    bool pop(T& item) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Slot& slot = slots[pos & (N - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1) return false; // empty or still being written
+        item = slot.item;
+        slot.seq.store(pos + N, std::memory_order_release);
+        tail.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq;
+        T item;
+    };
+    alignas(64) std::atomic<size_t> head{0}; // next slot to claim, shared by producers
+    alignas(64) std::atomic<size_t> tail{0}; // consumer only
+    Slot slots[N];
+};
+
+// Single-producer/single-consumer ring for bulk sample transfer, sized at runtime.
+// write() copies a whole block or nothing, so interleaved frames stay intact as long as the capacity
+// and every write are whole frames. allocate() must not run while either end is in use.
+template <typename T>
+class SpscBulkRing {
+public:
+    void allocate(size_t capacity) {
+        buffer.assign(capacity, T());
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    bool write(const T* data, size_t n) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (buffer.size() - (h - tail.load(std::memory_order_acquire)) < n) return false; // not enough room
+        size_t i = h % buffer.size();
+        size_t first = std::min(n, buffer.size() - i);
+        std::copy(data, data + first, buffer.data() + i);
+        std::copy(data + first, data + n, buffer.data());
+        head.store(h + n, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: readable items up to the end of the buffer, then consume() the ones used
+    size_t peek(const T*& data) const {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t available = head.load(std::memory_order_acquire) - t;
+        if (available == 0) return 0;
+        size_t i = t % buffer.size();
+        data = buffer.data() + i;
+        return std::min(available, buffer.size() - i);
+    }
+
+    void consume(size_t n) {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    size_t capacity() const { return buffer.size(); }
+
+private:
+    alignas(64) std::atomic<size_t> head{0}; // written by the producer
+    alignas(64) std::atomic<size_t> tail{0}; // written by the consumer
+    std::vector<T> buffer;
+};
+
+// Hands immutable snapshots to the audio thread, RCU style.
+// Any non-realtime thread may publish(); only the audio thread calls acquire(), which takes the
+// newest snapshot with a single atomic exchange. Snapshots the audio thread is done with are queued
+// back and freed by collect() on the GUI thread, so the audio thread never deletes anything.
+template <typename T>
+class SnapshotExchange {
+public:
+    SnapshotExchange() = default;
+    SnapshotExchange(const SnapshotExchange&) = delete;
+    SnapshotExchange& operator=(const SnapshotExchange&) = delete;
+
+    ~SnapshotExchange() {
+        collect();
+        delete pending.exchange(nullptr);
+        delete current;
+        delete previous;
+    }
+
+    // Takes ownership of snapshot. An older one the audio thread has not picked up yet is dropped.
+    void publish(T* snapshot) {
+        // Whatever was still pending never reached the audio thread, so it can be freed right here
+        delete pending.exchange(snapshot, std::memory_order_acq_rel);
+    }
+
+    // Audio thread: newest published snapshot, or nullptr if nothing new arrived.
+    // The returned snapshot stays valid until the second successful acquire() after it, so the
+    // previous one can still be compared against.
+    const T* acquire() {
+        // Leave the snapshot pending if there is no room to retire the oldest one
+        if (!pending.load(std::memory_order_relaxed) || retired.full()) return nullptr;
+        T* next = pending.exchange(nullptr, std::memory_order_acq_rel);
+        if (!next) return nullptr;
+        if (previous) retired.push(previous);
+        previous = current;
+        current = next;
+        return next;
+    }
+
+    // GUI thread: free retired snapshots
+    void collect() {
+        T* old = nullptr;
+        while (retired.pop(old)) delete old;
+    }
+
+private:
+    std::atomic<T*> pending{nullptr};
+    T* current = nullptr; // owned by the audio thread
+    T* previous = nullptr;
+    SpscRing<T*, 16> retired;
+};
+
+// Latest-value handoff from one producer to one consumer; neither side ever waits or allocates.
+// The producer fills its private slot and swaps it into the middle; the consumer swaps the middle out
+// when it holds something newer. Every publish() must follow a complete rewrite of back().
+template <typename T>
+class TripleBuffer {
+public:
+    // Producer
+    T& back() { return slots[backIndex]; }
+    void publish() { backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+    // Consumer: true if a newer value arrived since the last call; front() is then that value
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;
+
+    T slots[3];
+    int backIndex = 0;  // producer only
+    int frontIndex = 1; // consumer only
+    alignas(64) std::atomic<int> middle{2};
+};
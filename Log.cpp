@@ -0,0 +1,107 @@
+#include "Log.h"
+#include "LockFree.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <thread>
+#include <SDL3/SDL.h>
+
+namespace {
+
+const int LOG_TEXT_SIZE = 240;
+const uint32_t RATE_LIMIT_PER_SECOND = 200; // per level
+const uint64_t RATE_WINDOW_NS = 1000000000ull;
+const int DRAIN_INTERVAL_MS = 10;
+
+struct LogRecord {
+    uint64_t timeNs;
+    LogLevel level;
+    char text[LOG_TEXT_SIZE];
+};
+
+struct RateWindow {
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> suppressed{0};
+};
+
+const char* LEVEL_NAMES[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+MpscRing<LogRecord, 1024> g_logRing;
+RateWindow g_rateWindows[4];
+std::atomic<uint32_t> g_logDropped{0};
+std::atomic<LogLevel> g_logLevel{LogLevel::Debug};
+std::atomic<bool> g_logShouldExit{false};
+std::thread g_logThread;
+
+bool allow(RateWindow& window, uint64_t now) {
+    uint64_t start = window.start.load(std::memory_order_relaxed);
+    if (now - start >= RATE_WINDOW_NS && window.start.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        window.count.store(0, std::memory_order_relaxed);
+    }
+    if (window.count.fetch_add(1, std::memory_order_relaxed) < RATE_LIMIT_PER_SECOND) return true;
+    window.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void drainerThread() {
+    while (!g_logShouldExit.load(std::memory_order_relaxed)) {
+        Log::drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_INTERVAL_MS));
+    }
+}
+
+} // namespace
+
+void Log::start() {
+#ifndef __EMSCRIPTEN__
+    if (g_logThread.joinable()) return;
+    g_logShouldExit = false;
+    g_logThread = std::thread(drainerThread);
+#endif
+}
+
+void Log::stop() {
+    if (g_logThread.joinable()) {
+        g_logShouldExit = true;
+        g_logThread.join();
+    }
+    drain();
+}
+
+void Log::drain() {
+    LogRecord record;
+    while (g_logRing.pop(record)) {
+        SDL_Log("[%9.3f] %-5s %s", record.timeNs / 1e9, LEVEL_NAMES[(int)record.level], record.text);
+    }
+    for (int i = 0; i < 4; ++i) {
+        uint32_t suppressed = g_rateWindows[i].suppressed.exchange(0, std::memory_order_relaxed);
+        if (suppressed) SDL_Log("%s: %u messages suppressed by rate limit", LEVEL_NAMES[i], suppressed);
+    }
+    uint32_t dropped = g_logDropped.exchange(0, std::memory_order_relaxed);
+    if (dropped) SDL_Log("Log ring full, %u messages dropped", dropped);
+}
+
+void Log::setLevel(LogLevel level) {
+    g_logLevel.store(level, std::memory_order_relaxed);
+}
+
+LogLevel Log::level() {
+    return g_logLevel.load(std::memory_order_relaxed);
+}
+
+void Log::write(LogLevel level, const char* fmt, ...) {
+    if (!enabled(level)) return;
+    LogRecord record;
+    record.timeNs = SDL_GetTicksNS();
+    record.level = level;
+    if (!allow(g_rateWindows[(int)level], record.timeNs)) return;
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(record.text, sizeof(record.text), fmt, args);
+    va_end(args);
+
+    if (!g_logRing.push(record)) g_logDropped.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error };
+
+// Real-time safe logging.
+// write() formats into a fixed-size record on the caller's stack and pushes it into a lock-free ring;
+// it never allocates, locks or touches the console, so it may be called from the audio callback,
+// MIDI callbacks and the arpeggiator. A drainer thread prints the records with SDL_Log.
+// Each level is rate limited; records over the limit or that find the ring full are counted and
+// reported by the drainer instead of being printed.
+class Log {
+public:
+    static void start();  // launch the drainer thread
+    static void stop();   // stop the drainer and print what is left
+    static void drain();  // print pending records (for hosts without the drainer thread)
+
+    static void setLevel(LogLevel level);
+    static LogLevel level();
+    static bool enabled(LogLevel level) { return level >= Log::level(); }
+
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    static void write(LogLevel level, const char* fmt, ...);
+};
+
+#define LOG_DEBUG(...) do { if (Log::enabled(LogLevel::Debug)) Log::write(LogLevel::Debug, __VA_ARGS__); } while (0)
+#define LOG_INFO(...) Log::write(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) Log::write(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) Log::write(LogLevel::Error, __VA_ARGS__)
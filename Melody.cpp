@@ -1,11 +1,8 @@
 #include "Melody.h"
 #include "Synthesizer.h"
-#include "Voice.h"
-#include <algorithm>
-#include <atomic>
-#include <iostream>
-
-
+#include "EventScheduler.h"
+#include "Utils.h"
+#include <cmath>
 
 Melody::Melody() {
     // Initialize Mozart-inspired melody with variations
@@ -101,116 +98,68 @@ Melody::Melody() {
     };
 }
 
-void Melody::startMelody() {
+void Melody::startMelody(EventScheduler& scheduler) {
     melodyPlaying = true;
-    currentMelodyEventIndex = 0;
-    nextMelodyEventTime = 0; // Will be set immediately
-    melodyLoopCount = 0;
+    resetMelody();
+    ++generation;
+
+    // First chord as soon as the audio thread picks it up
+    ScheduledEvent step;
+    step.time = 0;
+    step.kind = ScheduledKind::MelodyStep;
+    step.generation = generation;
+    scheduler.post(step);
 }
 
 void Melody::stopMelody() {
     melodyPlaying = false;
-    currentMelodyEventIndex = 0;
-    melodyLoopCount = 0;
-    playingScheduledNotes.clear();
+    resetMelody();
+    ++generation; // pending steps and note offs of this run are dropped when they come due
 }
 
 void Melody::resetMelody() {
     currentMelodyEventIndex = 0;
     melodyLoopCount = 0;
-    nextMelodyEventTime = 0;
 }
 
-void Melody::updateMelodyPlayback(uint64_t currentTime, float perfFreq, Synthesizer& synth, std::atomic<int>& roundRobinIndex) {
-    if (!melodyPlaying) {
+void Melody::handleEvent(const ScheduledEvent& event, Synthesizer& synth, int64_t now) {
+    if (event.generation != generation) return;
+
+    if (event.kind == ScheduledKind::MelodyNoteOff) {
+        // Release the note unless its voice has since been taken over by another note
+        int note = event.bytes[1];
+        if (synth.voiceAllocator.voiceForNote(0, note) == event.voice) {
+            synth.voiceAllocator.noteOff(0, note);
+        }
         return;
     }
 
-    // Handle scheduled note-offs
-    processScheduledNoteOffs(currentTime, synth);
-
-    // Schedule next melody event
-    if (currentMelodyEventIndex < startupMelody.size()) {
-        if (currentTime >= nextMelodyEventTime) {
-            uint64_t timeOfThisEvent = currentTime;
-
-            const MelodyEvent& event = startupMelody[currentMelodyEventIndex];
-
-            // Play notes in the current event
-
-            for (int midiNote : event.midiNotes) {
-                float velocity = 0.8f; // Fixed velocity for melody
-
-                // Allocate a voice using simple round-robin for each note in the chord.
-                // This ensures each note of a chord gets a distinct voice.
-                int nVoices = (int)synth.voices.size();
-                int voiceIndex = roundRobinIndex.fetch_add(1) % nVoices;
-
-                // Before assigning a new note, check if the chosen voice was previously playing any other note
-                // and remove that mapping from noteToVoice.
-                // This is crucial for correct cleanup when a voice is stolen.
-                int oldMidiNoteOnStolenVoice = synth.voices[voiceIndex].getMidiNote();
-                if (oldMidiNoteOnStolenVoice != -1) { // -1 means voice was truly inactive or never played
-                    auto it = synth.noteToVoice.find(oldMidiNoteOnStolenVoice);
-                    if (it != synth.noteToVoice.end() && it->second == voiceIndex) {
-                        synth.noteToVoice.erase(it);
-                    }
-                }
-
-                // Ensure any note currently on this voice is explicitly turned off.
-                if (synth.voices[voiceIndex].getMidiNote() != -1) {
-                    synth.voices[voiceIndex].noteOff(); // Initiate release for the stolen voice's previous note
-                }
-
-                synth.noteToVoice[midiNote] = voiceIndex;
-                synth.voices[voiceIndex].noteOn(midiNote, velocity);
-
-                // Schedule note off
-                uint64_t noteOffTime = currentTime + (uint64_t)(event.durationSeconds * perfFreq);
-                scheduleNoteOff(midiNote, velocity, noteOffTime, voiceIndex);
-            }
-
-            // Schedule the next event time based on timeOfThisEvent
-            nextMelodyEventTime = timeOfThisEvent + (uint64_t)((event.durationSeconds + event.delayToNextSeconds) * perfFreq);
-            currentMelodyEventIndex++;
-        }
-    } else { // Melody finished one pass, check for looping
-        melodyLoopCount++;
-        if (melodyLoopCount < melodyMaxLoops) {
-            resetMelody(); // Restart melody
-            nextMelodyEventTime = currentTime; // Play immediately
-            // Do not clear playingScheduledNotes here, let them decay naturally based on their noteOffTime
-        } else {
-            // Melody finished all loops, ensure all playing notes are off
-            if (!playingScheduledNotes.empty()) {
-                for (const auto& sn : playingScheduledNotes) {
-                    if (sn.voiceIndex >= 0 && sn.voiceIndex < (int)synth.voices.size()) {
-                        synth.voices[sn.voiceIndex].noteOff();
-                    }
-                }
-                playingScheduledNotes.clear();
-            }
-            melodyPlaying = false; // Stop melody playback
+    if (!melodyPlaying) return;
+    if (currentMelodyEventIndex >= (int)startupMelody.size()) { // Melody finished one pass, check for looping
+        if (++melodyLoopCount >= melodyMaxLoops) {
+            // The last note offs were scheduled before this step, so nothing is left sounding
+            melodyPlaying = false;
             resetMelody(); // Reset for potential replay
+            return;
         }
+        currentMelodyEventIndex = 0;
     }
-}
 
-void Melody::scheduleNoteOff(int midiNote, float velocity, uint64_t noteOffTime, int voiceIndex) {
-    playingScheduledNotes.push_back({midiNote, velocity, noteOffTime, voiceIndex});
-}
+    const MelodyEvent& step = startupMelody[currentMelodyEventIndex++];
+    ScheduledEvent noteOff;
+    noteOff.time = now + std::llround(step.durationSeconds * SAMPLE_RATE);
+    noteOff.kind = ScheduledKind::MelodyNoteOff;
+    noteOff.generation = generation;
+    for (int midiNote : step.midiNotes) {
+        // Free voices are used before anything sounding is stolen
+        int voiceIndex = synth.noteOn(0, midiNote, 0.8f); // Fixed velocity for melody
+        if (voiceIndex < 0) continue;
+        noteOff.bytes[1] = (uint8_t)midiNote;
+        noteOff.voice = (int16_t)voiceIndex;
+        synth.scheduler.schedule(noteOff);
+    }
 
-void Melody::processScheduledNoteOffs(uint64_t currentTime, Synthesizer& synth) {
-    playingScheduledNotes.erase(
-        std::remove_if(playingScheduledNotes.begin(), playingScheduledNotes.end(),
-            [&](const ScheduledNote& sn) {
-                if (currentTime >= sn.noteOffTime) {
-                    if (sn.voiceIndex >= 0 && sn.voiceIndex < (int)synth.voices.size()) {
-                        synth.voices[sn.voiceIndex].noteOff();
-                    }
-                    return true; // Remove from scheduled notes
-                }
-                return false;
-            }),
-        playingScheduledNotes.end());
-}
\ No newline at end of file
+    ScheduledEvent next = event;
+    next.time = now + std::llround((step.durationSeconds + step.delayToNextSeconds) * SAMPLE_RATE);
+    synth.scheduler.schedule(next);
+}
@@ -4,26 +4,10 @@
 #include <cstdint>
 #include <atomic>
 
-// Forward declaration for Synthesizer (avoid circular include)
+// Forward declarations (avoid circular include)
 struct Synthesizer;
-
-// Melody-related structs
-struct NoteOnEvent {
-    int midiNote;
-    float velocity;
-    int voiceIndex; // Which voice is playing this note
-};
-
-struct ScheduledNote {
-    int midiNote;
-    float velocity;
-    uint64_t noteOffTime; // SDL_GetPerformanceCounter() value
-    int voiceIndex; // The voice that played this note
-
-    // Explicit constructor
-    ScheduledNote(int note, float vel, uint64_t offTime, int vIdx)
-        : midiNote(note), velocity(vel), noteOffTime(offTime), voiceIndex(vIdx) {}
-};
+struct ScheduledEvent;
+class EventScheduler;
 
 struct MelodyEvent {
     std::vector<int> midiNotes; // MIDI notes to play
@@ -40,24 +24,21 @@ public:
     // Melody data
     std::vector<MelodyEvent> startupMelody;
 
-    // Playback state
+    // Playback state. The melody runs on the audio thread's sample clock: each step is a
+    // scheduler event that plays its chord and schedules the note offs and the following step.
     int currentMelodyEventIndex = 0;
-    uint64_t nextMelodyEventTime = 0; // SDL_GetPerformanceCounter() value
     bool melodyPlaying = false;
     int melodyLoopCount = 0; // Current loop iteration
     const int melodyMaxLoops = 2; // Maximum number of loops (reduced since melody is much longer)
-
-    // Scheduled notes
-    std::vector<ScheduledNote> playingScheduledNotes;
+    uint32_t generation = 0; // bumped on start/stop so events of an earlier run are ignored
 
     // Methods
-    void startMelody();
+    void startMelody(EventScheduler& scheduler);
     void stopMelody();
-    void updateMelodyPlayback(uint64_t currentTime, float perfFreq, Synthesizer& synth, std::atomic<int>& roundRobinIndex);
-    void scheduleNoteOff(int midiNote, float velocity, uint64_t noteOffTime, int voiceIndex);
-    void processScheduledNoteOffs(uint64_t currentTime, Synthesizer& synth);
+    // Audio thread: a MelodyStep or MelodyNoteOff event fell due at sample position now
+    void handleEvent(const ScheduledEvent& event, Synthesizer& synth, int64_t now);
 
 private:
     // Helper methods
     void resetMelody();
-};
\ No newline at end of file
+};
@@ -0,0 +1,189 @@
+#include "MidiFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const uint32_t DEFAULT_TEMPO = 500000; // microseconds per quarter note, 120 BPM
+
+// Bounds-checked big-endian reader; a read past the end clears ok and returns zeros
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint8_t byte() {
+        if (p >= end) { ok = false; return 0; }
+        return *p++;
+    }
+    uint32_t bigEndian(int n) {
+        uint32_t value = 0;
+        for (int i = 0; i < n; ++i) value = (value << 8) | byte();
+        return value;
+    }
+    uint32_t varLength() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint8_t b = byte();
+            value = (value << 7) | (b & 0x7F);
+            if (!(b & 0x80)) return value;
+        }
+        ok = false;
+        return value;
+    }
+    void skip(size_t n) {
+        if ((size_t)(end - p) < n) { ok = false; p = end; } else p += n;
+    }
+};
+
+struct TickEvent {
+    uint64_t tick;
+    uint8_t bytes[3];
+    uint8_t size;
+};
+
+struct TempoChange {
+    uint64_t tick;
+    uint32_t usPerQuarter;
+};
+
+// Decode one MTrk chunk, appending its channel messages and tempo changes. Returns the end of track tick.
+uint64_t readTrack(Reader r, std::vector<TickEvent>& events, std::vector<TempoChange>& tempos, bool& ok) {
+    uint64_t tick = 0;
+    uint8_t runningStatus = 0;
+    while (r.ok && r.p < r.end) {
+        tick += r.varLength();
+        uint8_t b = r.byte();
+        if (b == 0xFF) { // meta event
+            uint8_t type = r.byte();
+            uint32_t length = r.varLength();
+            if (type == 0x51 && length == 3) {
+                tempos.push_back({tick, r.bigEndian(3)});
+            } else {
+                r.skip(length);
+            }
+            if (type == 0x2F) break; // end of track
+        } else if (b == 0xF0 || b == 0xF7) { // sysex
+            r.skip(r.varLength()); // running status is kept across sysex and meta events, as most readers do
+        } else {
+            uint8_t status = b;
+            uint8_t first;
+            if (b > 0xF0) {
+                ok = false; // system messages do not belong in a file
+                break;
+            } else if (b & 0x80) {
+                runningStatus = b;
+                first = r.byte();
+            } else if (runningStatus) {
+                status = runningStatus;
+                first = b;
+            } else {
+                ok = false; // data byte without a status
+                break;
+            }
+            TickEvent ev{tick, {status, first, 0}, 2};
+            int type = status & 0xF0;
+            if (type != 0xC0 && type != 0xD0) {
+                ev.bytes[2] = r.byte();
+                ev.size = 3;
+            }
+            events.push_back(ev);
+        }
+    }
+    ok = ok && r.ok;
+    return tick;
+}
+
+} // namespace
+
+bool MidiFile::load(const std::string& filename, int sampleRate, std::string& error) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        error = "Cannot open " + filename;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return parse(data.data(), data.size(), sampleRate, error);
+}
+
+bool MidiFile::parse(const uint8_t* data, size_t size, int sampleRate, std::string& error) {
+    events.clear();
+    lengthFrames = 0;
+
+    Reader r{data, data + size};
+    if (size < 14 || std::memcmp(data, "MThd", 4) != 0) {
+        error = "Not a standard MIDI file";
+        return false;
+    }
+    r.skip(4);
+    uint32_t headerLength = r.bigEndian(4);
+    format = (int)r.bigEndian(2);
+    numTracks = (int)r.bigEndian(2);
+    uint16_t division = (uint16_t)r.bigEndian(2);
+    r.skip(headerLength > 6 ? headerLength - 6 : 0);
+    if (format > 1) {
+        error = "MIDI file format " + std::to_string(format) + " is not supported";
+        return false;
+    }
+    if (division == 0) {
+        error = "Invalid MIDI file time division";
+        return false;
+    }
+
+    // Tracks are appended in file order, so a stable sort by tick keeps simultaneous events in track order
+    std::vector<TickEvent> tickEvents;
+    std::vector<TempoChange> tempos;
+    tickEvents.reserve(size / 3);
+    uint64_t endTick = 0;
+    bool ok = true;
+    for (int track = 0; track < numTracks && r.ok && r.p + 8 <= r.end; ) {
+        bool isTrack = std::memcmp(r.p, "MTrk", 4) == 0;
+        r.skip(4);
+        uint32_t length = r.bigEndian(4);
+        size_t available = std::min<size_t>(length, r.end - r.p);
+        if (isTrack) {
+            endTick = std::max(endTick, readTrack(Reader{r.p, r.p + available}, tickEvents, tempos, ok));
+            ++track;
+        }
+        r.skip(available);
+    }
+    if (!ok) {
+        error = "Corrupt MIDI track data";
+        return false;
+    }
+    std::stable_sort(tickEvents.begin(), tickEvents.end(), [](const TickEvent& a, const TickEvent& b) { return a.tick < b.tick; });
+    std::stable_sort(tempos.begin(), tempos.end(), [](const TempoChange& a, const TempoChange& b) { return a.tick < b.tick; });
+
+    // Ticks to samples. Metrical time follows the tempo map piece by piece; SMPTE time ignores it.
+    double usPerTick;
+    bool smpte = division & 0x8000;
+    if (smpte) {
+        int framesPerSecond = -(int8_t)(division >> 8);
+        usPerTick = 1e6 / (std::max(1, framesPerSecond) * std::max(1, division & 0xFF));
+    } else {
+        usPerTick = DEFAULT_TEMPO / (double)division;
+    }
+    uint64_t segmentTick = 0;
+    double segmentUs = 0.0;
+    size_t nextTempo = 0;
+    auto toFrame = [&](uint64_t tick) {
+        while (!smpte && nextTempo < tempos.size() && tempos[nextTempo].tick <= tick) {
+            segmentUs += (tempos[nextTempo].tick - segmentTick) * usPerTick;
+            segmentTick = tempos[nextTempo].tick;
+            usPerTick = tempos[nextTempo].usPerQuarter / (double)division;
+            ++nextTempo;
+        }
+        return (int64_t)std::llround((segmentUs + (tick - segmentTick) * usPerTick) * sampleRate / 1e6);
+    };
+
+    events.resize(tickEvents.size());
+    for (size_t i = 0; i < tickEvents.size(); ++i) {
+        const TickEvent& t = tickEvents[i];
+        events[i] = SongEvent{toFrame(t.tick), {t.bytes[0], t.bytes[1], t.bytes[2]}, t.size};
+    }
+    lengthFrames = toFrame(endTick);
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A channel message of a song, placed on the sample timeline
+struct SongEvent {
+    int64_t frame; // sample position from the start of the song
+    uint8_t bytes[3];
+    uint8_t size;
+};
+
+// Standard MIDI File (format 0 or 1) decoded for playback.
+// All tracks are merged into one time-sorted array of channel messages, and the tempo map is applied
+// while decoding, so playback only compares sample positions. Meta events other than tempo and end of
+// track, sysex and format 2 files are not supported.
+class MidiFile {
+public:
+    bool load(const std::string& filename, int sampleRate, std::string& error);
+    bool parse(const uint8_t* data, size_t size, int sampleRate, std::string& error);
+
+    std::vector<SongEvent> events;
+    int64_t lengthFrames = 0; // up to the last end of track
+    int format = 0;
+    int numTracks = 0;
+};
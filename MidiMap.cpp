@@ -0,0 +1,187 @@
+#include "MidiMap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+float MidiMapping::map(float x) const {
+    x = std::clamp(x, 0.0f, 1.0f);
+    switch (curve) {
+        case MidiCurve::Exponential:
+            // Equal ratios per step where the range allows it, otherwise a squared taper
+            if (minValue > 0.0f && maxValue > 0.0f) return minValue * std::pow(maxValue / minValue, x);
+            return minValue + (maxValue - minValue) * x * x;
+        case MidiCurve::Inverted:
+            return maxValue + (minValue - maxValue) * x;
+        default:
+            return minValue + (maxValue - minValue) * x;
+    }
+}
+
+MidiMap::MidiMap() {
+    rebuild();
+}
+
+void MidiMap::set(const MidiMapping& mapping) {
+    int keep = 0;
+    for (int i = 0; i < count; ++i) {
+        const MidiMapping& m = mappings[i];
+        bool sameController = m.channel == mapping.channel && m.number == mapping.number
+            && (m.source == MidiSource::NRPN) == (mapping.source == MidiSource::NRPN);
+        if (m.param != mapping.param && !sameController) mappings[keep++] = m;
+    }
+    count = keep;
+    if (count < MAX_MAPPINGS) mappings[count++] = mapping;
+    rebuild();
+}
+
+void MidiMap::remove(ParamId param) {
+    count = (int)(std::remove_if(mappings, mappings + count, [param](const MidiMapping& m) { return m.param == param; }) - mappings);
+    rebuild();
+}
+
+void MidiMap::clear() {
+    count = 0;
+    rebuild();
+}
+
+const MidiMapping* MidiMap::findCc(int channel, int controller) const {
+    int i = ccSlot[channel & 15][controller & 127];
+    return i < 0 ? nullptr : &mappings[i];
+}
+
+const MidiMapping* MidiMap::findNrpn(int channel, int number) const {
+    for (int i = 0; i < count; ++i) {
+        const MidiMapping& m = mappings[i];
+        if (m.source == MidiSource::NRPN && m.channel == channel && m.number == number) return &m;
+    }
+    return nullptr;
+}
+
+const MidiMapping* MidiMap::findParam(ParamId param) const {
+    for (int i = 0; i < count; ++i) {
+        if (mappings[i].param == param) return &mappings[i];
+    }
+    return nullptr;
+}
+
+bool MidiMap::operator==(const MidiMap& other) const {
+    return count == other.count && std::equal(mappings, mappings + count, other.mappings); // ccSlot follows from mappings
+}
+
+void MidiMap::rebuild() {
+    std::memset(ccSlot, -1, sizeof(ccSlot));
+    for (int i = 0; i < count; ++i) {
+        const MidiMapping& m = mappings[i];
+        if (m.source == MidiSource::NRPN || m.number > 127) continue;
+        ccSlot[m.channel & 15][m.number] = (int16_t)i;
+        // The LSB controller of a 14-bit pair leads back to the same mapping
+        if (m.source == MidiSource::CC14 && m.number < 32) ccSlot[m.channel & 15][m.number + 32] = (int16_t)i;
+    }
+}
+
+MidiMapper::MidiMapper() {
+    for (int ch = 0; ch < 16; ++ch) {
+        lastController[ch] = -1;
+        nrpnNumber[ch] = -1;
+    }
+}
+
+bool MidiMapper::handleMessage(const uint8_t* bytes, int nBytes, Synthesizer& synth, int rampFrames) {
+    if ((bytes[0] & 0xF0) != 0xB0 || nBytes < 3) return false;
+    int channel = bytes[0] & 0x0F;
+    int controller = bytes[1];
+    int value = bytes[2];
+
+    switch (controller) {
+        case 99: // NRPN select
+        case 98:
+            nrpnSelect[channel][controller == 99 ? 0 : 1] = (uint8_t)value;
+            nrpnNumber[channel] = (nrpnSelect[channel][0] << 7) | nrpnSelect[channel][1];
+            return true;
+        case 101: // RPN select: data entry belongs to the registered parameter now
+        case 100:
+            nrpnNumber[channel] = -1;
+            return false;
+        case 6:  // data entry MSB
+        case 38: // data entry LSB
+        {
+            int number = nrpnNumber[channel];
+            if (number < 0) return false;
+            int lsb = 0;
+            if (controller == 6) dataMsb[channel] = (uint8_t)value;
+            else lsb = value;
+            learn(channel, MidiSource::NRPN, number);
+            if (const MidiMapping* m = active.findNrpn(channel, number)) {
+                drive(synth, m->param, m->map(((dataMsb[channel] << 7) | lsb) / 16383.0f), rampFrames);
+            }
+            return true;
+        }
+        default:
+            break;
+    }
+
+    const MidiMapping* m = active.findCc(channel, controller);
+    if (controller < 32) {
+        ccMsb[channel][controller] = (uint8_t)value;
+        learn(channel, MidiSource::CC, controller);
+    } else if (controller < 64 && lastController[channel] == controller - 32) {
+        learn(channel, MidiSource::CC14, controller - 32); // an LSB right after its MSB: a 14-bit control
+    } else if (controller < 120) { // 120 and up are channel mode messages
+        learn(channel, MidiSource::CC, controller);
+    }
+    lastController[channel] = controller;
+    if (!m) return false;
+
+    float x;
+    if (m->source == MidiSource::CC14) {
+        // The MSB applies on its own with a cleared LSB; the LSB refines it
+        int msb = ccMsb[channel][m->number];
+        x = ((msb << 7) | (controller == m->number ? 0 : value)) / 16383.0f;
+    } else {
+        x = value / 127.0f;
+    }
+    drive(synth, m->param, m->map(x), rampFrames);
+    return true;
+}
+
+void MidiMapper::drive(Synthesizer& synth, ParamId param, float value, int frames) {
+    int p = (int)param;
+    if (frames > 0) {
+        if (rampFrames[p] == 0) ++ramping;
+        rampTarget[p] = value;
+        rampFrames[p] = frames;
+        return;
+    }
+    if (rampFrames[p] > 0) {
+        rampFrames[p] = 0; // a message of its own overrides the glide
+        --ramping;
+    }
+    setParam(synth, param, value);
+}
+
+bool MidiMapper::advance(Synthesizer& synth, int frames) {
+    if (ramping == 0) return false;
+    for (int p = 0; p < (int)ParamId::Count; ++p) {
+        int& left = rampFrames[p];
+        if (left == 0) continue;
+        int step = std::min(frames, left);
+        float current = getParam(synth, (ParamId)p);
+        setParam(synth, (ParamId)p, current + (rampTarget[p] - current) * step / left);
+        left -= step;
+        if (left == 0) --ramping;
+    }
+    return ramping == 0;
+}
+
+void MidiMapper::arm(ParamId param) {
+    learnParam.store((int)param, std::memory_order_relaxed);
+}
+
+void MidiMapper::disarm() {
+    learnParam.store((int)ParamId::None, std::memory_order_relaxed);
+}
+
+void MidiMapper::learn(int channel, MidiSource source, int number) {
+    if (learnParam.load(std::memory_order_relaxed) == (int)ParamId::None) return;
+    learnEvents.push(MidiLearnEvent{(uint8_t)channel, source, (uint16_t)number});
+}
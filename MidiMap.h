@@ -0,0 +1,111 @@
+#pragma once
+
+#include "LockFree.h"
+#include "Params.h"
+#include <atomic>
+#include <cstdint>
+
+struct Synthesizer;
+
+enum class MidiSource : uint8_t {
+    CC,   // 7-bit controller
+    CC14, // controller 0-31 with its LSB on controller+32
+    NRPN  // 14-bit non-registered parameter through data entry (CC 6/38)
+};
+
+enum class MidiCurve : uint8_t { Linear, Exponential, Inverted };
+
+struct MidiMapping {
+    ParamId param = ParamId::None;
+    MidiSource source = MidiSource::CC;
+    uint8_t channel = 0;
+    uint16_t number = 0; // controller number, or NRPN number (0-16383)
+    float minValue = 0.0f;
+    float maxValue = 1.0f;
+    MidiCurve curve = MidiCurve::Linear;
+
+    // Parameter value for a controller position in 0..1
+    float map(float x) const;
+
+    bool operator==(const MidiMapping&) const = default;
+};
+
+// Controller to parameter assignments. A flat [channel][controller] table finds 7- and 14-bit CC
+// mappings in one lookup; NRPN mappings are few and searched linearly.
+// Each parameter has at most one mapping and each controller drives at most one parameter.
+class MidiMap {
+public:
+    static constexpr int MAX_MAPPINGS = 128;
+
+    MidiMap();
+
+    // Replaces any mapping of the same parameter or the same controller
+    void set(const MidiMapping& mapping);
+    void remove(ParamId param);
+    void clear();
+
+    int size() const { return count; }
+    const MidiMapping& operator[](int i) const { return mappings[i]; }
+    // Only range and curve may be changed in place; use set() to move a mapping to another controller
+    MidiMapping& operator[](int i) { return mappings[i]; }
+
+    const MidiMapping* findCc(int channel, int controller) const;
+    const MidiMapping* findNrpn(int channel, int number) const;
+    const MidiMapping* findParam(ParamId param) const;
+
+    bool operator==(const MidiMap& other) const;
+
+private:
+    void rebuild();
+
+    MidiMapping mappings[MAX_MAPPINGS];
+    int count = 0;
+    int16_t ccSlot[16][128]; // index into mappings, -1 if unmapped
+};
+
+// A controller seen while MIDI learn is armed
+struct MidiLearnEvent {
+    uint8_t channel;
+    MidiSource source;
+    uint16_t number;
+};
+
+// Audio thread side of controller mapping. The GUI edits the MidiMap in its control mirror; the map
+// arrives with the mirror's snapshots (see ControlLink) or with presets and is copied into this table
+// between blocks, so dispatch never waits on the GUI.
+class MidiMapper {
+public:
+    MidiMapper();
+
+    // Audio thread: replace the active map (control and preset snapshots)
+    void load(const MidiMap& map) { active = map; }
+
+    // Audio thread: apply a controller message through the map. Returns true if it drove a parameter
+    // or was part of an NRPN/14-bit sequence; unmapped controllers take the normal MIDI path.
+    // rampFrames > 0: the parameter glides to the new value over that many frames (see advance()).
+    bool handleMessage(const uint8_t* bytes, int nBytes, Synthesizer& synth, int rampFrames = 0);
+    // Audio thread: move gliding parameters on by frames; true when the last glide has ended
+    bool advance(Synthesizer& synth, int frames);
+
+    // GUI thread: report the next controllers moved (see MidiLearnEvent) until disarmed
+    void arm(ParamId param);
+    void disarm();
+    ParamId learning() const { return (ParamId)learnParam.load(std::memory_order_relaxed); }
+    bool pollLearn(MidiLearnEvent& event) { return learnEvents.pop(event); }
+
+private:
+    void learn(int channel, MidiSource source, int number);
+    void drive(Synthesizer& synth, ParamId param, float value, int rampFrames);
+
+    MidiMap active;
+    uint8_t ccMsb[16][32] = {};     // last MSB of controllers 0-31, for 14-bit pairs
+    int lastController[16];         // previous controller on the channel, to recognise an MSB/LSB pair
+    int nrpnNumber[16];             // selected NRPN, -1 if none (or an RPN was selected)
+    uint8_t nrpnSelect[16][2] = {}; // CC 99 / CC 98 as received
+    uint8_t dataMsb[16] = {};
+    std::atomic<int> learnParam{(int)ParamId::None};
+    SpscRing<MidiLearnEvent, 64> learnEvents;
+    float rampTarget[(int)ParamId::Count] = {};
+    int rampFrames[(int)ParamId::Count] = {}; // frames left of each parameter's glide, 0 if none
+    int ramping = 0;                          // parameters gliding
+};
@@ -0,0 +1,117 @@
+#include "MidiQueue.h"
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+const int PITCH_BEND_SLOT = 128;
+const int PRESSURE_SLOT = 129;
+
+// Slot a message coalesces into, or -1 if every message of its kind must be delivered
+int runSlotOf(const MidiEvent& ev) {
+    switch (ev.bytes[0] & 0xF0) {
+        case 0xE0: return PITCH_BEND_SLOT;
+        case 0xD0: return PRESSURE_SLOT;
+        case 0xB0: {
+            int controller = ev.bytes[1];
+            if (controller == 6 || controller == 38) return -1;         // data entry
+            if (controller >= 64 && controller <= 69) return -1;        // switches: pedals, legato
+            if (controller >= 96 && controller <= 101) return -1;       // increment/decrement, NRPN/RPN select
+            if (controller >= 120) return -1;                           // channel mode messages
+            return controller;
+        }
+        default: return -1;
+    }
+}
+
+} // namespace
+
+int64_t midiClockNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool MidiQueue::push(const unsigned char* bytes, size_t size, int64_t timeNs) {
+    if (size == 0 || size > 3) return false;
+    MidiEvent ev;
+    ev.timeNs = timeNs > 0 ? timeNs : midiClockNowNs(); // backend without timestamps
+    ev.size = (uint8_t)size;
+    for (size_t i = 0; i < size; ++i) ev.bytes[i] = bytes[i];
+    if (ring.push(ev)) return true;
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+int MidiQueue::collect(int64_t blockEndNs, int numFrames, int sampleRate) {
+    const int64_t blockStartNs = blockEndNs - (int64_t)numFrames * 1000000000ll / sampleRate;
+    int count = 0;
+
+    // Returns true if the event belongs to this block (frame set), false if it is for a later one
+    auto place = [&](MidiEvent& ev) {
+        int64_t frame = (ev.timeNs - blockStartNs) * sampleRate / 1000000000ll;
+        if (frame < 0) frame = 0; // arrived before the block window (e.g. after an xrun)
+        if (frame >= numFrames) return false;
+        ev.frame = ev.endFrame = (int32_t)frame;
+        return true;
+    };
+    auto append = [&](const MidiEvent& ev) {
+        // Insertion sort keeps events with the same frame in arrival order
+        int i = count++;
+        while (i > 0 && block[i - 1].frame > ev.frame) {
+            block[i] = block[i - 1];
+            --i;
+        }
+        block[i] = ev;
+    };
+
+    int keep = 0;
+    for (int i = 0; i < earlyCount; ++i) {
+        MidiEvent ev = early[i];
+        if (place(ev)) append(ev);
+        else early[keep++] = ev;
+    }
+    earlyCount = keep;
+
+    // A controller flood fills the block quickly; coalescing makes room for the rest of it
+    MidiEvent ev;
+    bool more = true;
+    while (more) {
+        while (count < MAX_BLOCK_EVENTS && (more = ring.pop(ev))) {
+            if (place(ev)) {
+                append(ev);
+            } else if (earlyCount < MAX_BLOCK_EVENTS) {
+                early[earlyCount++] = ev;
+            } else {
+                ev.frame = ev.endFrame = numFrames - 1;
+                append(ev);
+            }
+        }
+        int before = count;
+        count = coalesce(count);
+        if (count == before) break;
+    }
+    return count;
+}
+
+int MidiQueue::coalesce(int count) {
+    std::memset(runSlot, -1, sizeof(runSlot));
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        const MidiEvent& ev = block[i];
+        int channel = ev.bytes[0] & 0x0F;
+        int status = ev.bytes[0] & 0xF0;
+        if (status == 0x80 || status == 0x90) {
+            std::memset(runSlot[channel], -1, sizeof(runSlot[channel]));
+        }
+        int slot = runSlotOf(ev);
+        if (slot >= 0 && runSlot[channel][slot] >= 0) {
+            MidiEvent& run = block[runSlot[channel][slot]];
+            for (int b = 0; b < 3; ++b) run.bytes[b] = ev.bytes[b];
+            run.endFrame = ev.frame;
+            merged.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (slot >= 0) runSlot[channel][slot] = (int16_t)kept;
+        block[kept++] = ev;
+    }
+    return kept;
+}
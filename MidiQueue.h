@@ -0,0 +1,58 @@
+#pragma once
+
+#include "LockFree.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// A channel message as received from a MIDI input
+struct MidiEvent {
+    int64_t timeNs = 0; // arrival time on the steady clock (see midiClockNowNs)
+    int32_t frame = 0;  // offset into the audio block it is rendered in, set by MidiQueue::collect
+    int32_t endFrame = 0; // frame of the last message merged into this one (== frame if none were)
+    uint8_t bytes[3] = {0, 0, 0};
+    uint8_t size = 0;
+};
+
+// Nanoseconds on std::chrono::steady_clock, the clock libremidi's SystemMonotonic timestamps use
+int64_t midiClockNowNs();
+
+// Timestamped MIDI delivery into the render loop.
+// MIDI input threads push() without locking. The audio thread calls collect() once per block, which
+// maps every timestamp onto a frame of that block: the block ending now renders the events that arrived
+// during the block's duration before now, at the same relative positions. Event timing is therefore
+// exact to the sample, at the cost of one block of constant latency instead of up to one block of jitter.
+//
+// Continuous controller streams (CC, pitch bend, pressure) are coalesced per block: each run of one
+// (channel, controller) becomes a single event at the frame of its first message, carrying the last
+// value and the last message's frame as endFrame, so consumers can ramp across the span. Note on/off,
+// switches, and RPN/NRPN/data entry sequences stay lossless, and a note message on a channel ends the
+// channel's runs so nothing is reordered across it.
+class MidiQueue {
+public:
+    static constexpr int MAX_BLOCK_EVENTS = 256;
+
+    // Any thread. Messages longer than three bytes (sysex) are ignored. Returns false if the queue is full.
+    bool push(const unsigned char* bytes, size_t size, int64_t timeNs);
+
+    // Audio thread: gather the events for a block of numFrames ending at blockEndNs, sorted by frame.
+    // Returns the number of events available through events().
+    int collect(int64_t blockEndNs, int numFrames, int sampleRate);
+    const MidiEvent* events() const { return block; }
+
+    // Metrics, readable from any thread: messages folded into an earlier one, and messages lost to a full queue
+    uint64_t mergedCount() const { return merged.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    MpscRing<MidiEvent, 1024> ring;
+    MidiEvent block[MAX_BLOCK_EVENTS];
+    MidiEvent early[MAX_BLOCK_EVENTS]; // stamped later than the current block, held for the next one
+    int earlyCount = 0;
+
+    int coalesce(int count);
+
+    int16_t runSlot[16][130]; // per channel: controllers 0-127, pitch bend, pressure -> kept event, or -1
+    std::atomic<uint64_t> merged{0};
+    std::atomic<uint64_t> dropped{0};
+};
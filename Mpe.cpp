@@ -0,0 +1,130 @@
+#include "Mpe.h"
+#include "VoiceAllocator.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float SMOOTHING_TIME_SEC = 0.005f;
+const float TONE_MIN_HZ = 80.0f;
+const float TONE_MAX_HZ = 20000.0f;
+
+} // namespace
+
+VoiceModLanes::VoiceModLanes() {
+    for (int v = 0; v < MAX_VOICES; ++v) start(v, 0.0f, 1.0f, 0.0f, 0.0f);
+}
+
+void VoiceModLanes::start(int v, float bendValue, float slideValue, float pressureValue, float pressureDepth) {
+    bend[v] = bendTarget[v] = bendValue;
+    slide[v] = slideTarget[v] = slideValue;
+    pressure[v] = pressureTarget[v] = pressureValue;
+    toneL[v] = toneR[v] = 0.0f;
+    derive(v, pressureDepth);
+}
+
+void VoiceModLanes::smooth(int numVoices, float pressureDepth) {
+    static const float coeff = 1.0f - std::exp(-(float)MODULATION_SUB_BLOCK / (SMOOTHING_TIME_SEC * SAMPLE_RATE));
+    numVoices = std::min(numVoices, MAX_VOICES);
+    for (int v = 0; v < numVoices; ++v) {
+        bend[v] += coeff * (bendTarget[v] - bend[v]);
+        slide[v] += coeff * (slideTarget[v] - slide[v]);
+        pressure[v] += coeff * (pressureTarget[v] - pressure[v]);
+        derive(v, pressureDepth);
+    }
+}
+
+void VoiceModLanes::derive(int v, float pressureDepth) {
+    gain[v] = 1.0f + pressureDepth * pressure[v];
+    // Slide sweeps the voice's tone filter exponentially, fully open at the top
+    float cutoff = TONE_MIN_HZ * std::pow(TONE_MAX_HZ / TONE_MIN_HZ, slide[v]);
+    toneCoeff[v] = 1.0f - std::exp(-2.0f * (float)M_PI * cutoff / SAMPLE_RATE);
+}
+
+Mpe::Mpe() {
+    for (int ch = 0; ch < 16; ++ch) {
+        channelBend[ch] = 0.0f;
+        channelSlide[ch] = 1.0f; // open until the controller sends CC74
+        channelPressure[ch] = 0.0f;
+        rpnMsb[ch] = rpnLsb[ch] = 127;
+    }
+}
+
+int Mpe::managerOf(int channel) const {
+    if (channel >= 1 && channel <= lowerMembers) return 0;
+    if (channel <= 14 && channel >= 15 - upperMembers) return 15;
+    return -1;
+}
+
+bool Mpe::isMember(int channel) const {
+    return managerOf(channel) >= 0;
+}
+
+bool Mpe::handleMessage(const uint8_t* bytes, int nBytes, const VoiceAllocator& allocator) {
+    int status = bytes[0] & 0xF0;
+    int channel = bytes[0] & 0x0F;
+
+    // Registered parameters are tracked on every channel so a controller can set up MPE while it is off
+    if (status == 0xB0 && nBytes >= 3) {
+        int controller = bytes[1], value = bytes[2];
+        if (controller == 101) { rpnMsb[channel] = value; return false; }
+        if (controller == 100) { rpnLsb[channel] = value; return false; }
+        if (controller == 99 || controller == 98) { rpnMsb[channel] = rpnLsb[channel] = 127; return false; } // NRPN selected
+        if (controller == 6 && rpnMsb[channel] == 0) {
+            if (rpnLsb[channel] == 6 && (channel == 0 || channel == 15)) {
+                // MPE Configuration Message: a zone's member count, 0 removes the zone
+                int members = std::min(value, 15);
+                if (channel == 0) {
+                    lowerMembers = members;
+                    upperMembers = std::min(upperMembers, 14 - lowerMembers);
+                } else {
+                    upperMembers = members;
+                    lowerMembers = std::min(lowerMembers, 14 - upperMembers);
+                }
+                enabled = lowerMembers > 0 || upperMembers > 0;
+                return true;
+            }
+            if (rpnLsb[channel] == 0 && enabled && isMember(channel)) {
+                memberBendRange = (float)value; // pitch bend sensitivity in semitones
+                return true;
+            }
+        }
+    }
+
+    if (!enabled || !isMember(channel)) return false;
+
+    if (status == 0xE0 && nBytes >= 3) {
+        int value = (bytes[2] << 7) | bytes[1];
+        channelBend[channel] = (value - 8192.0f) / 8192.0f * memberBendRange;
+    } else if (status == 0xD0 && nBytes >= 2) {
+        channelPressure[channel] = bytes[1] / 127.0f;
+    } else if (status == 0xB0 && nBytes >= 3 && bytes[1] == 74) {
+        channelSlide[channel] = bytes[2] / 127.0f;
+    } else {
+        return false;
+    }
+    setTargets(channel, allocator);
+    return true;
+}
+
+void Mpe::noteStarted(int channel, int voice) {
+    if (voice < 0 || voice >= VoiceModLanes::MAX_VOICES) return;
+    if (enabled && isMember(channel)) {
+        lanes.start(voice, channelBend[channel], channelSlide[channel], channelPressure[channel], pressureDepth);
+    } else {
+        lanes.start(voice, 0.0f, 1.0f, 0.0f, pressureDepth);
+    }
+}
+
+void Mpe::setTargets(int channel, const VoiceAllocator& allocator) {
+    // Usually a single voice, plus any earlier note on the channel that is still releasing
+    const int8_t* voices = allocator.voicesOf(channel);
+    for (int i = 0, n = allocator.voicesOnChannel(channel); i < n; ++i) {
+        int v = voices[i];
+        if (v >= VoiceModLanes::MAX_VOICES) continue;
+        lanes.bendTarget[v] = channelBend[channel];
+        lanes.slideTarget[v] = channelSlide[channel];
+        lanes.pressureTarget[v] = channelPressure[channel];
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+class VoiceAllocator;
+
+// Per-voice expression, laid out as flat arrays indexed by voice so the renderer reads them directly.
+// MIDI writes the targets; smooth() moves the rendered values towards them once per sub-block.
+struct VoiceModLanes {
+    static constexpr int MAX_VOICES = 64;
+
+    float bendTarget[MAX_VOICES];     // semitones
+    float slideTarget[MAX_VOICES];    // CC74, 0..1
+    float pressureTarget[MAX_VOICES]; // channel pressure, 0..1
+
+    float bend[MAX_VOICES];
+    float slide[MAX_VOICES];
+    float pressure[MAX_VOICES];
+
+    // Derived once per sub-block for the renderer
+    float gain[MAX_VOICES];      // from pressure
+    float toneCoeff[MAX_VOICES]; // one-pole lowpass coefficient from slide
+    float toneL[MAX_VOICES];     // lowpass state
+    float toneR[MAX_VOICES];
+
+    VoiceModLanes();
+
+    // New note: jump straight to the given values instead of gliding from the voice's previous note
+    void start(int v, float bendValue, float slideValue, float pressureValue, float pressureDepth);
+    void smooth(int numVoices, float pressureDepth);
+
+private:
+    void derive(int v, float pressureDepth);
+};
+
+// MIDI Polyphonic Expression. Each zone has a manager channel (channel 1 for the lower zone, 16 for the
+// upper) whose pitch bend and controllers act on the whole zone, and member channels that carry one note
+// each, so pitch bend, CC74 (slide) and channel pressure on a member channel belong to that note alone.
+class Mpe {
+public:
+    bool enabled = false;
+    int lowerMembers = 15; // member channels 2..1+n of the lower zone, 0 = no lower zone
+    int upperMembers = 0;  // member channels 15 down to 16-n of the upper zone
+    float memberBendRange = 48.0f; // semitones, set by the controller through RPN 0 on a member channel
+    float pressureDepth = 0.5f;    // extra gain at full pressure
+    VoiceModLanes lanes;
+
+    Mpe();
+
+    // Manager channel of the zone a channel belongs to, or -1
+    int managerOf(int channel) const;
+    bool isMember(int channel) const;
+
+    // Member channel pitch bend, pressure and CC74, and the MPE configuration RPNs.
+    // Returns true if the message was consumed; everything else takes the normal MIDI path.
+    bool handleMessage(const uint8_t* bytes, int nBytes, const VoiceAllocator& allocator);
+
+    // A voice was started on a channel: its lanes take the channel's current expression
+    void noteStarted(int channel, int voice);
+
+private:
+    void setTargets(int channel, const VoiceAllocator& allocator);
+
+    float channelBend[16];     // semitones
+    float channelSlide[16];
+    float channelPressure[16];
+    int rpnMsb[16];
+    int rpnLsb[16];
+};
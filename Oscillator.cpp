@@ -7,64 +7,66 @@
 #include <cmath>
 #include <complex>
 
-Oscillator::Oscillator() : frequency(440.0f), amplitude(0.0f), phase(0.0f), waveformType(SINE),
-                           envelopeState(OFF), attackTime(0.01f), decayTime(0.1f), sustainLevel(0.5f), releaseTime(0.2f),
-                           envelopeLevel(0.0f), startTime(0.0f), releaseStartTime(0.0f), releaseStartLevel(0.0f), noteOnPerformanceCounter(0), phaseOffsetSec(0.0f), pulseWidth(0.5f), pitchShiftSemitones(0.0f), detuneCents(0.0f), pitchBend(0.0f), lfoMod(0.0f), randState(22222u) {}
+Oscillator::Oscillator() : frequency(440.0f), amplitude(0.0f), phase(0.0f),
+                           envelopeState(OFF),
+                           envelopeLevel(0.0f), envelopeSamples(0), releaseStartLevel(0.0f), fadeTime(0.0f), pitchBend(0.0f), lfoMod(0.0f), randState(22222u) {}
 
 void Oscillator::setFrequency(float freq) { frequency = freq; }
 void Oscillator::setAmplitude(float amp) { amplitude = amp; }
-void Oscillator::setWaveformType(WaveformType type) { waveformType = type; }
-void Oscillator::setPhaseOffsetSec(float s) { phaseOffsetSec = s; }
-void Oscillator::setPulseWidth(float pw) { pulseWidth = std::clamp(pw, 0.01f, 0.99f); }
-void Oscillator::setPitchShiftSemitones(float s) { pitchShiftSemitones = s; }
-void Oscillator::setDetuneCents(float c) { detuneCents = c; }
 void Oscillator::setPitchBend(float bend_semitones) { pitchBend = bend_semitones; }
 void Oscillator::setLfoMod(float mod_semitones) { lfoMod = mod_semitones; }
 
 float Oscillator::getFrequency() const { return frequency; }
 float Oscillator::getAmplitude() const { return amplitude; }
-int Oscillator::getWaveformType() const { return static_cast<int>(waveformType); }
-float Oscillator::getPhaseOffsetSec() const { return phaseOffsetSec; }
-float Oscillator::getPulseWidth() const { return pulseWidth; }
-float Oscillator::getPitchShiftSemitones() const { return pitchShiftSemitones; }
-float Oscillator::getDetuneCents() const { return detuneCents; }
 float Oscillator::getPitchBend() const { return pitchBend; }
 float Oscillator::getLfoMod() const { return lfoMod; }
 
-void Oscillator::setAttackTime(float time) { attackTime = time; }
-void Oscillator::setDecayTime(float time) { decayTime = time; }
-void Oscillator::setSustainLevel(float level) { sustainLevel = level; }
-void Oscillator::setReleaseTime(float time) { releaseTime = time; }
-
-float Oscillator::getAttackTime() const { return attackTime; }
-float Oscillator::getDecayTime() const { return decayTime; }
-float Oscillator::getSustainLevel() const { return sustainLevel; }
-float Oscillator::getReleaseTime() const { return releaseTime; }
-
 void Oscillator::noteOn(float initialAmplitude) {
     envelopeState = ATTACK;
-    startTime = SDL_GetPerformanceCounter() / (float)SDL_GetPerformanceFrequency();
+    envelopeSamples = 0;
+    fadeTime = 0.0f;
     amplitude = initialAmplitude; // Store the initial amplitude from MIDI velocity
-    noteOnPerformanceCounter = SDL_GetPerformanceCounter(); // Record note on time
+}
+
+void Oscillator::seedNoise(uint32_t seed) {
+    // Hash the seed so that neighbouring seeds give unrelated sequences
+    seed ^= seed >> 16;
+    seed *= 0x7feb352du;
+    seed ^= seed >> 15;
+    seed *= 0x846ca68bu;
+    seed ^= seed >> 16;
+    randState = seed;
 }
 
 void Oscillator::noteOff() {
     if (envelopeState != OFF) {
         envelopeState = RELEASE;
-        releaseStartTime = SDL_GetPerformanceCounter() / (float)SDL_GetPerformanceFrequency();
+        envelopeSamples = 0;
         releaseStartLevel = envelopeLevel; // Store current envelopeLevel for release phase
     }
 }
 
-float Oscillator::generateSample() {
+bool Oscillator::fadeOut(float seconds) {
+    if (envelopeState == OFF || fadeTime > 0.0f) return false;
+    noteOff();
+    fadeTime = seconds;
+    return true;
+}
+
+float Oscillator::generateSample(const VoiceParams& voice, const VcoParams& vco) {
     float sample = 0.0f;
-    float t = (phase / SAMPLE_RATE) + phaseOffsetSec; // Time in seconds with phase offset
+    float t = (phase / SAMPLE_RATE) + vco.phaseMs * 0.001f; // Time in seconds with phase offset
+    float pulseWidth = std::clamp(vco.pulseWidth, 0.01f, 0.99f);
+    const float attackTime = voice.attackTime;
+    const float decayTime = voice.decayTime;
+    const float sustainLevel = voice.sustainLevel;
+    const float releaseTime = fadeTime > 0.0f ? fadeTime : voice.releaseTime;
 
     // compute effective frequency with pitch shift and detune (optimized: avoid std::pow)
-    float finalPitchMod = pitchShiftSemitones + pitchBend + lfoMod;
-    float effFreq = frequency * std::exp(finalPitchMod * 0.0577622650466621f) * std::exp(detuneCents * 0.00057807807701174f);
+    float finalPitchMod = vco.pitchShift + pitchBend + lfoMod;
+    float effFreq = frequency * std::exp(finalPitchMod * 0.0577622650466621f) * std::exp(vco.detune * 0.00057807807701174f);
 
-    switch (waveformType) {
+    switch (static_cast<WaveformType>(vco.waveform)) {
         case SINE:
             sample = fastSin(2.0f * M_PI * effFreq * t);
             break;
@@ -99,16 +101,15 @@ float Oscillator::generateSample() {
         }
     }
 
-    // Apply ADSR envelope
-    float currentTime = SDL_GetPerformanceCounter() / (float)SDL_GetPerformanceFrequency();
-    float elapsedTime = 0.0f;
+    // Apply ADSR envelope, timed in rendered samples so a note starts on the frame it was triggered
+    float elapsedTime = envelopeSamples * (1.0f / SAMPLE_RATE);
+    ++envelopeSamples;
 
     switch (envelopeState) {
         case OFF:
             envelopeLevel = 0.0f;
             break;
         case ATTACK:
-            elapsedTime = currentTime - startTime;
             if (attackTime == 0) { // Instant attack
                 envelopeLevel = 1.0f;
             } else {
@@ -116,11 +117,10 @@ float Oscillator::generateSample() {
             }
               if (elapsedTime >= attackTime) {
                   envelopeState = DECAY;
-                  startTime = currentTime; // Reset startTime for decay phase
+                  envelopeSamples = 0; // Restart the stage clock for decay
               }
             break;
         case DECAY:
-            elapsedTime = currentTime - startTime;
             if (decayTime == 0) { // Instant decay
                 envelopeLevel = sustainLevel;
             }
@@ -135,7 +135,6 @@ float Oscillator::generateSample() {
             envelopeLevel = sustainLevel;
             break;
         case RELEASE:
-            elapsedTime = currentTime - releaseStartTime;
             if (releaseTime == 0) { // Instant release
                 envelopeLevel = 0.0f;
             } else {
@@ -157,14 +156,15 @@ float Oscillator::generateSample() {
     return sample * amplitude * envelopeLevel;
 }
 
-float Oscillator::generateSampleDetuned(float extraDetuneCents, float phaseOffsetSeconds) const {
+float Oscillator::generateSampleDetuned(const VcoParams& vco, float extraDetuneCents, float phaseOffsetSeconds) const {
     // compute local phase without modifying internal state
-    float localPhase = phase / SAMPLE_RATE + phaseOffsetSec + phaseOffsetSeconds; // seconds
-    float combinedCents = detuneCents + extraDetuneCents;
-    float finalPitchMod = pitchShiftSemitones + pitchBend + lfoMod;
+    float localPhase = phase / SAMPLE_RATE + vco.phaseMs * 0.001f + phaseOffsetSeconds; // seconds
+    float pulseWidth = std::clamp(vco.pulseWidth, 0.01f, 0.99f);
+    float combinedCents = vco.detune + extraDetuneCents;
+    float finalPitchMod = vco.pitchShift + pitchBend + lfoMod;
     float effFreq = frequency * std::exp(finalPitchMod * 0.0577622650466621f) * std::exp(combinedCents * 0.00057807807701174f);
     float sample = 0.0f;
-    switch (waveformType) {
+    switch (static_cast<WaveformType>(vco.waveform)) {
         case SINE:
             sample = fastSin(2.0f * M_PI * effFreq * localPhase);
             break;
@@ -208,7 +208,6 @@ float Oscillator::generateSampleDetuned(float extraDetuneCents, float phaseOffse
 float Oscillator::getPhase() const { return phase; }
 float Oscillator::getEnvelopeLevel() const { return envelopeLevel; }
 Oscillator::EnvelopeState Oscillator::getEnvelopeState() const { return envelopeState; }
-uint64_t Oscillator::getNoteOnPerformanceCounter() const { return noteOnPerformanceCounter; }
 
 // New setters for state write-back
 void Oscillator::setPhase(float p) { phase = p; }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Utils.h"
+#include "VoiceParams.h"
 #include <SDL3/SDL.h>
 #include <cstdint>
 #include <cmath>
@@ -16,45 +17,31 @@ public:
 
     void setFrequency(float freq);
     void setAmplitude(float amp);
-    void setWaveformType(WaveformType type);
-    void setPhaseOffsetSec(float s);
-    void setPulseWidth(float pw);
-    void setPitchShiftSemitones(float s);
-    void setDetuneCents(float c);
     void setPitchBend(float bend_semitones);
     void setLfoMod(float mod_semitones);
 
     float getFrequency() const;
     float getAmplitude() const;
-    int getWaveformType() const;
-    float getPhaseOffsetSec() const;
-    float getPulseWidth() const;
-    float getPitchShiftSemitones() const;
-    float getDetuneCents() const;
     float getPitchBend() const;
     float getLfoMod() const;
 
-    void setAttackTime(float time);
-    void setDecayTime(float time);
-    void setSustainLevel(float level);
-    void setReleaseTime(float time);
-
-    float getAttackTime() const;
-    float getDecayTime() const;
-    float getSustainLevel() const;
-    float getReleaseTime() const;
-
     void noteOn(float initialAmplitude);
     void noteOff();
+    // Release from the current level over seconds instead of the voice's release time; false if the
+    // oscillator is silent or already fading
+    bool fadeOut(float seconds);
+    // Start the RANDOM waveform's noise sequence over from seed
+    void seedNoise(uint32_t seed);
 
-    float generateSample();
-    float generateSampleDetuned(float extraDetuneCents, float phaseOffsetSeconds) const;
+    // The oscillator only keeps per-note state; waveform, tuning and envelope come from the
+    // voice's parameter set and this oscillator's VCO in it
+    float generateSample(const VoiceParams& voice, const VcoParams& vco);
+    float generateSampleDetuned(const VcoParams& vco, float extraDetuneCents, float phaseOffsetSeconds) const;
 
     // needed by unison rendering
     float getPhase() const;
     float getEnvelopeLevel() const;
     Oscillator::EnvelopeState getEnvelopeState() const;
-    uint64_t getNoteOnPerformanceCounter() const;
 
     // New setters for state write-back
     void setPhase(float p);
@@ -65,24 +52,13 @@ private:
     float frequency;
     float amplitude;
     float phase;
-    WaveformType waveformType;
 
     EnvelopeState envelopeState;
-    float attackTime;
-    float decayTime;
-    float sustainLevel;
-    float releaseTime;
     float envelopeLevel;
-    float startTime;
-    float releaseStartTime;
+    uint32_t envelopeSamples; // samples rendered since the current envelope stage started
     float releaseStartLevel; // New: envelope level at the start of release
-    uint64_t noteOnPerformanceCounter; // New: SDL_GetPerformanceCounter() when noteOn was called
+    float fadeTime; // release time set by fadeOut(), 0 for the voice's own
 
-    // new
-    float phaseOffsetSec; // seconds
-    float pulseWidth; // 0..1 for square wave
-    float pitchShiftSemitones; // +/- semitones
-    float detuneCents; // fine detune
     float pitchBend; // in semitones
     float lfoMod; // in semitones
     mutable uint32_t randState;
@@ -0,0 +1,124 @@
+#include "Params.h"
+#include "Synthesizer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Indexed by ParamId; ranges follow the GUI sliders
+const ParamInfo PARAMS[(int)ParamId::Count] = {
+    {"MasterVolume",        "Master Volume",         0.0f,     1.0f,  false},
+    {"Pan",                 "Pan",                  -1.0f,     1.0f,  false},
+    {"PitchBendRange",      "Pitch Bend Range",      0.0f,    12.0f,  false},
+    {"ModLfoRate",          "Mod LFO Rate",          0.1f,    20.0f,  true},
+    {"VoiceAttack",         "Attack",                0.0f,     2.0f,  true},
+    {"VoiceDecay",          "Decay",                 0.0f,     2.0f,  true},
+    {"VoiceSustain",        "Sustain",               0.0f,     1.0f,  false},
+    {"VoiceRelease",        "Release",               0.0f,     5.0f,  true},
+    {"ArpBpm",              "Arp BPM",              30.0f,   240.0f,  false},
+    {"ArpGate",             "Arp Gate",              0.01f,    1.0f,  false},
+    {"ArpSwing",            "Arp Swing",             0.0f,     0.5f,  false},
+    {"FlangerRate",         "Flanger Rate",          0.01f,   10.0f,  true},
+    {"FlangerDepth",        "Flanger Depth",         0.0f,     0.02f, false},
+    {"FlangerMix",          "Flanger Mix",           0.0f,     1.0f,  false},
+    {"DelayTime",           "Delay Time",            0.01f,    2.0f,  true},
+    {"DelayFeedback",       "Delay Feedback",        0.0f,     0.95f, false},
+    {"DelayMix",            "Delay Mix",             0.0f,     1.0f,  false},
+    {"ReverbSize",          "Reverb Size",           0.0f,     1.0f,  false},
+    {"ReverbDamp",          "Reverb Damp",           0.0f,     1.0f,  false},
+    {"ReverbDiffuse",       "Reverb Diffuse",        0.0f,     1.0f,  false},
+    {"ReverbDryMix",        "Reverb Dry Mix",        0.0f,     1.0f,  false},
+    {"ReverbWetMix",        "Reverb Wet Mix",        0.0f,     1.0f,  false},
+    {"FilterCutoff",        "Filter Cutoff",        20.0f, 20000.0f,  true},
+    {"FilterResonance",     "Filter Resonance",      0.1f,    10.0f,  true},
+    {"FilterDrive",         "Filter Drive",          0.1f,    10.0f,  true},
+    {"CompressorThreshold", "Compressor Threshold", -60.0f,    0.0f,  false},
+    {"CompressorRatio",     "Compressor Ratio",      1.0f,    20.0f,  false},
+    {"CompressorMakeup",    "Compressor Makeup",   -12.0f,    12.0f,  false},
+};
+
+const ParamInfo NO_PARAM = {"", "(none)", 0.0f, 1.0f, false};
+
+} // namespace
+
+const ParamInfo& paramInfo(ParamId id) {
+    if (id <= ParamId::None || id >= ParamId::Count) return NO_PARAM;
+    return PARAMS[(int)id];
+}
+
+ParamId paramFromKey(const char* key) {
+    for (int i = 0; i < (int)ParamId::Count; ++i) {
+        if (std::strcmp(PARAMS[i].key, key) == 0) return (ParamId)i;
+    }
+    return ParamId::None;
+}
+
+void setParam(Synthesizer& synth, ParamId id, float value) {
+    const ParamInfo& info = paramInfo(id);
+    value = std::clamp(value, info.minValue, info.maxValue);
+    switch (id) {
+        case ParamId::MasterVolume: synth.masterVolume = value; break;
+        case ParamId::Pan: synth.pan = value; break;
+        case ParamId::PitchBendRange: synth.pitchBendRange = value; break;
+        case ParamId::ModLfoRate: synth.modLfoRate = value; break;
+        case ParamId::VoiceAttack: synth.voicePatch.attackTime = value; break;
+        case ParamId::VoiceDecay: synth.voicePatch.decayTime = value; break;
+        case ParamId::VoiceSustain: synth.voicePatch.sustainLevel = value; break;
+        case ParamId::VoiceRelease: synth.voicePatch.releaseTime = value; break;
+        case ParamId::ArpBpm: synth.arpBpm = value; break;
+        case ParamId::ArpGate: synth.arpGate = value; break;
+        case ParamId::ArpSwing: synth.arpSwing = value; break;
+        case ParamId::FlangerRate: synth.flangerRate = value; break;
+        case ParamId::FlangerDepth: synth.flangerDepth = value; break;
+        case ParamId::FlangerMix: synth.flangerMix = value; break;
+        case ParamId::DelayTime: synth.delayTimeSec = value; break;
+        case ParamId::DelayFeedback: synth.delayFeedback = value; break;
+        case ParamId::DelayMix: synth.delayMix = value; break;
+        case ParamId::ReverbSize: synth.reverbSize = value; break;
+        case ParamId::ReverbDamp: synth.reverbDamp = value; break;
+        case ParamId::ReverbDiffuse: synth.reverbDiffuse = value; break;
+        case ParamId::ReverbDryMix: synth.reverbDryMix = value; break;
+        case ParamId::ReverbWetMix: synth.reverbWetMix = value; break;
+        case ParamId::FilterCutoff: synth.filter.setCutoff(value); break;
+        case ParamId::FilterResonance: synth.filter.setResonance(value); break;
+        case ParamId::FilterDrive: synth.filter.setDrive(value); break;
+        case ParamId::CompressorThreshold: synth.compressorThresholdDb = value; break;
+        case ParamId::CompressorRatio: synth.compressorRatio = value; break;
+        case ParamId::CompressorMakeup: synth.compressorMakeupDb = value; break;
+        default: break;
+    }
+}
+
+float getParam(const Synthesizer& synth, ParamId id) {
+    switch (id) {
+        case ParamId::MasterVolume: return synth.masterVolume;
+        case ParamId::Pan: return synth.pan;
+        case ParamId::PitchBendRange: return synth.pitchBendRange;
+        case ParamId::ModLfoRate: return synth.modLfoRate;
+        case ParamId::VoiceAttack: return synth.voicePatch.attackTime;
+        case ParamId::VoiceDecay: return synth.voicePatch.decayTime;
+        case ParamId::VoiceSustain: return synth.voicePatch.sustainLevel;
+        case ParamId::VoiceRelease: return synth.voicePatch.releaseTime;
+        case ParamId::ArpBpm: return synth.arpBpm;
+        case ParamId::ArpGate: return synth.arpGate;
+        case ParamId::ArpSwing: return synth.arpSwing;
+        case ParamId::FlangerRate: return synth.flangerRate;
+        case ParamId::FlangerDepth: return synth.flangerDepth;
+        case ParamId::FlangerMix: return synth.flangerMix;
+        case ParamId::DelayTime: return synth.delayTimeSec;
+        case ParamId::DelayFeedback: return synth.delayFeedback;
+        case ParamId::DelayMix: return synth.delayMix;
+        case ParamId::ReverbSize: return synth.reverbSize;
+        case ParamId::ReverbDamp: return synth.reverbDamp;
+        case ParamId::ReverbDiffuse: return synth.reverbDiffuse;
+        case ParamId::ReverbDryMix: return synth.reverbDryMix;
+        case ParamId::ReverbWetMix: return synth.reverbWetMix;
+        case ParamId::FilterCutoff: return synth.filter.getCutoff();
+        case ParamId::FilterResonance: return synth.filter.getResonance();
+        case ParamId::FilterDrive: return synth.filter.getDrive();
+        case ParamId::CompressorThreshold: return synth.compressorThresholdDb;
+        case ParamId::CompressorRatio: return synth.compressorRatio;
+        case ParamId::CompressorMakeup: return synth.compressorMakeupDb;
+        default: return 0.0f;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+struct Synthesizer;
+
+// Every parameter that can be driven by a MIDI controller. The values are stored in presets by key,
+// so new parameters can be added anywhere in the list.
+enum class ParamId : int16_t {
+    None = -1,
+    MasterVolume,
+    Pan,
+    PitchBendRange,
+    ModLfoRate,
+    VoiceAttack,
+    VoiceDecay,
+    VoiceSustain,
+    VoiceRelease,
+    ArpBpm,
+    ArpGate,
+    ArpSwing,
+    FlangerRate,
+    FlangerDepth,
+    FlangerMix,
+    DelayTime,
+    DelayFeedback,
+    DelayMix,
+    ReverbSize,
+    ReverbDamp,
+    ReverbDiffuse,
+    ReverbDryMix,
+    ReverbWetMix,
+    FilterCutoff,
+    FilterResonance,
+    FilterDrive,
+    CompressorThreshold,
+    CompressorRatio,
+    CompressorMakeup,
+    Count
+};
+
+struct ParamInfo {
+    const char* key;   // preset JSON name
+    const char* label; // GUI name
+    float minValue;
+    float maxValue;
+    bool logarithmic;  // frequencies and times: exponential controller curves suit them
+};
+
+const ParamInfo& paramInfo(ParamId id);
+ParamId paramFromKey(const char* key); // ParamId::None if unknown
+
+// Caller holds g_synthMutex or is the audio thread. Values are clamped to the parameter's range.
+void setParam(Synthesizer& synth, ParamId id, float value);
+float getParam(const Synthesizer& synth, ParamId id);
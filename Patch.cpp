@@ -0,0 +1,155 @@
+#include "Patch.h"
+#include "Synthesizer.h"
+
+void Patch::capture(const Synthesizer& synth) {
+    masterVolume = synth.masterVolume;
+    pan = synth.pan;
+    unisonCount = synth.unisonCount;
+    unisonSpreadIndex = synth.unisonSpreadIndex;
+    pitchBend = synth.pitchBend;
+    pitchBendRange = synth.pitchBendRange;
+    modWheelValue = synth.modWheelValue;
+    modLfoPhase = synth.modLfoPhase;
+    modLfoRate = synth.modLfoRate;
+
+    arpEnabled = synth.arpEnabled;
+    arpBpm = synth.arpBpm;
+    arpGate = synth.arpGate;
+    arpDirection = synth.arpDirection;
+    arpRange = synth.arpRange;
+    arpHold = synth.arpHold;
+    arpSwing = synth.arpSwing;
+    arpRatchet = synth.arpRatchet;
+
+    voice = synth.voicePatch;
+
+    multitimbral = synth.multitimbral;
+    for (int p = 0; p < NUM_PARTS; ++p) parts[p] = synth.parts[p];
+    midiMap = synth.midiMap;
+
+    flangerEnabled = synth.flangerEnabled;
+    flangerRate = synth.flangerRate;
+    flangerDepth = synth.flangerDepth;
+    flangerMix = synth.flangerMix;
+
+    delayEnabled = synth.delayEnabled;
+    delayTimeSec = synth.delayTimeSec;
+    delayFeedback = synth.delayFeedback;
+    delayMix = synth.delayMix;
+
+    reverbEnabled = synth.reverbEnabled;
+    reverbSize = synth.reverbSize;
+    reverbDamp = synth.reverbDamp;
+    reverbDelay = synth.reverbDelay;
+    reverbDiffuse = synth.reverbDiffuse;
+    reverbStereo = synth.reverbStereo;
+    reverbDryMix = synth.reverbDryMix;
+    reverbWetMix = synth.reverbWetMix;
+
+    compressorEnabled = synth.compressorEnabled;
+    compressorThresholdDb = synth.compressorThresholdDb;
+    compressorRatio = synth.compressorRatio;
+    compressorAttackMs = synth.compressorAttackMs;
+    compressorReleaseMs = synth.compressorReleaseMs;
+    compressorMakeupDb = synth.compressorMakeupDb;
+
+    dcFilterEnabled = synth.dcFilterEnabled;
+    dcFilterAlpha = synth.dcFilterAlpha;
+
+    softClipEnabled = synth.softClipEnabled;
+    softClipDrive = synth.softClipDrive;
+
+    autoGainEnabled = synth.autoGainEnabled;
+    autoGainTargetRMS = synth.autoGainTargetRMS;
+    autoGainAlpha = synth.autoGainAlpha;
+
+    filterEnabled = synth.filterEnabled;
+    filterCutoff = synth.filter.getCutoff();
+    filterResonance = synth.filter.getResonance();
+    filterDrive = synth.filter.getDrive();
+    filterInertial = synth.filter.getInertial();
+    filterOversampling = synth.filter.getOversampling();
+}
+
+void Patch::apply(Synthesizer& synth, const Patch* since) const {
+    // field is a pointer to member; everything counts as changed without since
+    auto changed = [&](auto field) { return !since || this->*field != since->*field; };
+    auto set = [&](auto& target, auto field) {
+        if (changed(field)) target = this->*field;
+    };
+
+    set(synth.masterVolume, &Patch::masterVolume);
+    set(synth.pan, &Patch::pan);
+    set(synth.unisonCount, &Patch::unisonCount);
+    set(synth.unisonSpreadIndex, &Patch::unisonSpreadIndex);
+    if (!since) {
+        synth.pitchBend = pitchBend;
+        synth.modWheelValue = modWheelValue;
+        synth.modLfoPhase = modLfoPhase;
+    }
+    set(synth.pitchBendRange, &Patch::pitchBendRange);
+    set(synth.modLfoRate, &Patch::modLfoRate);
+
+    set(synth.arpEnabled, &Patch::arpEnabled);
+    set(synth.arpBpm, &Patch::arpBpm);
+    set(synth.arpGate, &Patch::arpGate);
+    set(synth.arpDirection, &Patch::arpDirection);
+    set(synth.arpRange, &Patch::arpRange);
+    set(synth.arpHold, &Patch::arpHold);
+    set(synth.arpSwing, &Patch::arpSwing);
+    set(synth.arpRatchet, &Patch::arpRatchet);
+
+    set(synth.voicePatch, &Patch::voice);
+
+    set(synth.multitimbral, &Patch::multitimbral);
+    for (int p = 0; p < NUM_PARTS; ++p) {
+        if (!since || parts[p] != since->parts[p]) synth.parts[p] = parts[p];
+    }
+    if (changed(&Patch::midiMap)) {
+        synth.midiMap = midiMap;
+        synth.midiMapper.load(midiMap);
+    }
+
+    set(synth.flangerEnabled, &Patch::flangerEnabled);
+    set(synth.flangerRate, &Patch::flangerRate);
+    set(synth.flangerDepth, &Patch::flangerDepth);
+    set(synth.flangerMix, &Patch::flangerMix);
+
+    set(synth.delayEnabled, &Patch::delayEnabled);
+    set(synth.delayTimeSec, &Patch::delayTimeSec);
+    set(synth.delayFeedback, &Patch::delayFeedback);
+    set(synth.delayMix, &Patch::delayMix);
+
+    set(synth.reverbEnabled, &Patch::reverbEnabled);
+    set(synth.reverbSize, &Patch::reverbSize);
+    set(synth.reverbDamp, &Patch::reverbDamp);
+    set(synth.reverbDelay, &Patch::reverbDelay);
+    set(synth.reverbDiffuse, &Patch::reverbDiffuse);
+    set(synth.reverbStereo, &Patch::reverbStereo);
+    set(synth.reverbDryMix, &Patch::reverbDryMix);
+    set(synth.reverbWetMix, &Patch::reverbWetMix);
+
+    set(synth.compressorEnabled, &Patch::compressorEnabled);
+    set(synth.compressorThresholdDb, &Patch::compressorThresholdDb);
+    set(synth.compressorRatio, &Patch::compressorRatio);
+    set(synth.compressorAttackMs, &Patch::compressorAttackMs);
+    set(synth.compressorReleaseMs, &Patch::compressorReleaseMs);
+    set(synth.compressorMakeupDb, &Patch::compressorMakeupDb);
+
+    set(synth.dcFilterEnabled, &Patch::dcFilterEnabled);
+    set(synth.dcFilterAlpha, &Patch::dcFilterAlpha);
+
+    set(synth.softClipEnabled, &Patch::softClipEnabled);
+    set(synth.softClipDrive, &Patch::softClipDrive);
+
+    set(synth.autoGainEnabled, &Patch::autoGainEnabled);
+    set(synth.autoGainTargetRMS, &Patch::autoGainTargetRMS);
+    set(synth.autoGainAlpha, &Patch::autoGainAlpha);
+
+    set(synth.filterEnabled, &Patch::filterEnabled);
+    if (changed(&Patch::filterCutoff)) synth.filter.setCutoff(filterCutoff);
+    if (changed(&Patch::filterResonance)) synth.filter.setResonance(filterResonance);
+    if (changed(&Patch::filterDrive)) synth.filter.setDrive(filterDrive);
+    if (changed(&Patch::filterInertial)) synth.filter.setInertial(filterInertial);
+    if (changed(&Patch::filterOversampling)) synth.filter.setOversampling(filterOversampling);
+}
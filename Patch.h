@@ -0,0 +1,104 @@
+#pragma once
+
+#include "LockFree.h"
+#include "MidiMap.h"
+#include "VoiceParams.h"
+#include <string>
+#include <vector>
+
+struct Synthesizer;
+
+const int NUM_PARTS = 16;
+
+// One multitimbral part, played by the MIDI channel with the same index
+struct Part {
+    VoiceParams voice;   // played by every voice the part starts
+    int maxVoices = 8;   // voice budget; beyond it the part steals from its own voices
+    float volume = 1.0f;
+    float pan = 0.0f;
+    float fxSend = 1.0f; // share sent through flanger/delay/reverb, the rest joins the bus after them
+    bool muted = false;
+
+    bool operator==(const Part&) const = default;
+};
+
+// Complete snapshot of every preset parameter.
+// A Patch is built off the audio thread (see Preset::read), never modified after it has been
+// published, and applied to the synthesizer by the audio thread between two blocks.
+struct Patch {
+    // Library metadata (not used by the engine)
+    std::string name;
+    std::vector<std::string> tags;
+
+    // Global parameters
+    float masterVolume = 1.0f;
+    float pan = 0.0f;
+    int unisonCount = 1;
+    int unisonSpreadIndex = 0;
+    float pitchBend = 0.0f;
+    float pitchBendRange = 2.0f;
+    float modWheelValue = 0.0f;
+    float modLfoPhase = 0.0f;
+    float modLfoRate = 5.0f;
+
+    // Arpeggiator
+    bool arpEnabled = false;
+    float arpBpm = 120.0f;
+    float arpGate = 0.5f;
+    int arpDirection = 0;
+    int arpRange = 4;
+    bool arpHold = false;
+    float arpSwing = 0.0f;
+    int arpRatchet = 1;
+
+    // Voice sound, shared by every voice outside multitimbral mode
+    VoiceParams voice;
+
+    // Multitimbral parts
+    bool multitimbral = false;
+    Part parts[NUM_PARTS];
+
+    // Controller assignments
+    MidiMap midiMap;
+
+    // Effects
+    bool flangerEnabled = false;
+    float flangerRate = 0.5f, flangerDepth = 0.003f, flangerMix = 0.5f;
+    bool delayEnabled = true;
+    float delayTimeSec = 0.3f, delayFeedback = 0.3f, delayMix = 0.4f;
+    bool reverbEnabled = true;
+    float reverbSize = 0.5f, reverbDamp = 0.2f, reverbDelay = 0.02f, reverbDiffuse = 0.7f;
+    float reverbStereo = 0.8f, reverbDryMix = 0.7f, reverbWetMix = 0.3f;
+    bool compressorEnabled = true;
+    float compressorThresholdDb = -6.0f, compressorRatio = 4.0f, compressorAttackMs = 10.0f;
+    float compressorReleaseMs = 100.0f, compressorMakeupDb = 0.0f;
+    bool dcFilterEnabled = false;
+    float dcFilterAlpha = 0.995f;
+    bool softClipEnabled = false;
+    float softClipDrive = 1.0f;
+    bool autoGainEnabled = false;
+    float autoGainTargetRMS = 0.3f, autoGainAlpha = 0.999f;
+
+    // Filter
+    bool filterEnabled = true;
+    float filterCutoff = 1000.0f, filterResonance = 0.707f, filterDrive = 1.0f, filterInertial = 0.0f;
+    int filterOversampling = 0;
+
+    // Window state (applied by the GUI thread, ignored by apply())
+    bool hasWindow = false;
+    int windowX = 0, windowY = 0, windowW = 800, windowH = 600;
+    bool windowFullscreen = false;
+
+    // Copy the current synthesizer state into this patch (caller holds g_synthMutex, or is the audio
+    // thread); leaves name and tags alone and does not allocate
+    void capture(const Synthesizer& synth);
+    // Write this patch into the synthesizer; allocation-free, safe on the audio thread.
+    // With since, only the fields that differ from it are written, and the performance state
+    // (pitch bend, mod wheel, LFO phase) is left to the controllers.
+    void apply(Synthesizer& synth, const Patch* since = nullptr) const;
+
+    bool operator==(const Patch&) const = default;
+};
+
+// Preset snapshots on their way to the audio thread
+using PatchExchange = SnapshotExchange<Patch>;
@@ -1,10 +1,16 @@
 #include "Preset.h"
+#include "Patch.h"
 #include "Synthesizer.h"
 #include "Voice.h"
 #include <fstream>
 #include <string>
 #include <iostream>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
+#include <cstring>
 #include <SDL3/SDL.h>
 #include <cJSON.h>
 
@@ -12,134 +18,304 @@ extern Synthesizer g_synth;
 extern std::mutex g_synthMutex;
 extern SDL_Window* g_window;
 
-void Preset::save(const std::string& filename) {
+namespace {
+
+void captureWindowState(Patch& patch) {
+    if (!g_window) return;
+    patch.hasWindow = true;
+    SDL_GetWindowPosition(g_window, &patch.windowX, &patch.windowY);
+    SDL_GetWindowSize(g_window, &patch.windowW, &patch.windowH);
+    Uint32 flags = SDL_GetWindowFlags(g_window);
+    patch.windowFullscreen = (flags & SDL_WINDOW_FULLSCREEN);
+}
+
+void applyWindowState(const Patch& patch) {
+    if (!patch.hasWindow || !g_window) return;
+    SDL_SetWindowPosition(g_window, patch.windowX, patch.windowY);
+    SDL_SetWindowSize(g_window, patch.windowW, patch.windowH);
+    if (patch.windowFullscreen) {
+        SDL_SetWindowFullscreen(g_window, true);
+    }
+}
+
+// Voice parameters, shared by the patch's "Voice" object and the multitimbral parts
+cJSON* voiceToJson(const VoiceParams& voice) {
+    cJSON *vobj = cJSON_CreateObject();
+    cJSON_AddNumberToObject(vobj, "AttackTime", voice.attackTime);
+    cJSON_AddNumberToObject(vobj, "DecayTime", voice.decayTime);
+    cJSON_AddNumberToObject(vobj, "SustainLevel", voice.sustainLevel);
+    cJSON_AddNumberToObject(vobj, "ReleaseTime", voice.releaseTime);
+    cJSON_AddNumberToObject(vobj, "MixLevel", voice.mixLevel);
+    cJSON_AddNumberToObject(vobj, "UnisonCount", voice.unisonCount);
+    cJSON_AddNumberToObject(vobj, "UnisonSpreadIndex", voice.unisonSpreadIndex);
+
+    cJSON *vcos = cJSON_AddArrayToObject(vobj, "VCOs");
+    for (int i = 0; i < 3; ++i) {
+        cJSON *vco = cJSON_CreateObject();
+        cJSON_AddNumberToObject(vco, "Waveform", voice.vcos[i].waveform);
+        cJSON_AddNumberToObject(vco, "Mix", voice.vcos[i].mix);
+        cJSON_AddNumberToObject(vco, "Detune", voice.vcos[i].detune);
+        cJSON_AddNumberToObject(vco, "PhaseMs", voice.vcos[i].phaseMs);
+        cJSON_AddNumberToObject(vco, "PulseWidth", voice.vcos[i].pulseWidth);
+        cJSON_AddNumberToObject(vco, "PitchShift", voice.vcos[i].pitchShift);
+        cJSON_AddNumberToObject(vco, "Pan", voice.vcos[i].pan);
+        cJSON_AddItemToArray(vcos, vco);
+    }
+    return vobj;
+}
+
+void voiceFromJson(cJSON* vobj, VoiceParams& voice) {
+    cJSON *item = cJSON_GetObjectItem(vobj, "AttackTime");
+    if (item) voice.attackTime = item->valuedouble;
+    item = cJSON_GetObjectItem(vobj, "DecayTime");
+    if (item) voice.decayTime = item->valuedouble;
+    item = cJSON_GetObjectItem(vobj, "SustainLevel");
+    if (item) voice.sustainLevel = item->valuedouble;
+    item = cJSON_GetObjectItem(vobj, "ReleaseTime");
+    if (item) voice.releaseTime = item->valuedouble;
+    item = cJSON_GetObjectItem(vobj, "MixLevel");
+    if (item) voice.mixLevel = item->valuedouble;
+    item = cJSON_GetObjectItem(vobj, "UnisonCount");
+    if (item) voice.unisonCount = item->valueint;
+    item = cJSON_GetObjectItem(vobj, "UnisonSpreadIndex");
+    if (item) voice.unisonSpreadIndex = item->valueint;
+
+    cJSON *vcos = cJSON_GetObjectItem(vobj, "VCOs");
+    if (vcos && cJSON_IsArray(vcos)) {
+        for (int i = 0; i < 3 && i < cJSON_GetArraySize(vcos); ++i) {
+            cJSON *vco = cJSON_GetArrayItem(vcos, i);
+            if (!vco) continue;
+            item = cJSON_GetObjectItem(vco, "Waveform");
+            if (item) voice.vcos[i].waveform = item->valueint;
+            item = cJSON_GetObjectItem(vco, "Mix");
+            if (item) voice.vcos[i].mix = item->valuedouble;
+            item = cJSON_GetObjectItem(vco, "Detune");
+            if (item) voice.vcos[i].detune = item->valuedouble;
+            item = cJSON_GetObjectItem(vco, "PhaseMs");
+            if (item) voice.vcos[i].phaseMs = item->valuedouble;
+            item = cJSON_GetObjectItem(vco, "PulseWidth");
+            if (item) voice.vcos[i].pulseWidth = item->valuedouble;
+            item = cJSON_GetObjectItem(vco, "PitchShift");
+            if (item) voice.vcos[i].pitchShift = item->valuedouble;
+            item = cJSON_GetObjectItem(vco, "Pan");
+            if (item) voice.vcos[i].pan = item->valuedouble;
+        }
+    }
+}
+
+const char* MIDI_SOURCE_NAMES[] = {"CC", "CC14", "NRPN"};
+const char* MIDI_CURVE_NAMES[] = {"Linear", "Exponential", "Inverted"};
+
+int indexOfName(const char* const* names, int count, const char* name) {
+    for (int i = 0; i < count; ++i) {
+        if (std::strcmp(names[i], name) == 0) return i;
+    }
+    return 0;
+}
+
+// Background preset I/O: jobs are queued by the GUI, results are picked up by Preset::poll()
+struct PresetJob {
+    bool isLoad;
+    std::string filename;
+    Patch patch; // base state for loads, state to write for saves
+    bool ok;
+    int part = -1; // loads only: take the file's first voice into this part instead of loading everything
+    std::function<bool(std::string&)> work; // runAsync() jobs: everything above is unused
+    std::function<void(bool, std::string&)> done;
+    std::string status;
+};
+
+std::mutex g_jobMutex;
+std::condition_variable g_jobCv;
+std::deque<PresetJob> g_jobs;
+std::deque<PresetJob> g_results;
+std::thread g_worker;
+bool g_workerShouldExit = false;
+
+void workerThreadFunction() {
+    std::unique_lock<std::mutex> lock(g_jobMutex);
+    while (true) {
+        g_jobCv.wait(lock, [] { return g_workerShouldExit || !g_jobs.empty(); });
+        if (g_jobs.empty()) break; // exit requested and nothing left to do
+        PresetJob job = std::move(g_jobs.front());
+        g_jobs.pop_front();
+        lock.unlock();
+
+        if (job.work) {
+            job.ok = job.work(job.status);
+        } else if (job.isLoad) {
+            if (job.part >= 0) {
+                Patch loaded;
+                job.ok = Preset::read(job.filename, loaded);
+                if (job.ok) job.patch.parts[job.part].voice = loaded.voice;
+            } else {
+                job.ok = Preset::read(job.filename, job.patch);
+            }
+            if (job.ok) {
+                g_synth.patchExchange.publish(new Patch(job.patch));
+            }
+        } else {
+            job.ok = Preset::write(job.filename, job.patch);
+        }
+
+        lock.lock();
+        g_results.push_back(std::move(job));
+    }
+}
+
+void enqueueJob(PresetJob&& job) {
+    std::lock_guard<std::mutex> lock(g_jobMutex);
+    if (!g_worker.joinable()) {
+        g_workerShouldExit = false;
+        g_worker = std::thread(workerThreadFunction);
+    }
+    g_jobs.push_back(std::move(job));
+    g_jobCv.notify_one();
+}
+
+} // namespace
+
+bool Preset::write(const std::string& filename, const Patch& patch) {
     cJSON *root = cJSON_CreateObject();
 
+    // Library metadata
+    if (!patch.name.empty()) cJSON_AddStringToObject(root, "Name", patch.name.c_str());
+    if (!patch.tags.empty()) {
+        cJSON *tags = cJSON_AddArrayToObject(root, "Tags");
+        for (const std::string& tag : patch.tags) cJSON_AddItemToArray(tags, cJSON_CreateString(tag.c_str()));
+    }
+
     // Global parameters
-    cJSON_AddNumberToObject(root, "MasterVolume", g_synth.masterVolume);
-    cJSON_AddNumberToObject(root, "Pan", g_synth.pan);
-    cJSON_AddNumberToObject(root, "UnisonCount", g_synth.unisonCount);
-    cJSON_AddNumberToObject(root, "UnisonSpreadIndex", g_synth.unisonSpreadIndex);
-    cJSON_AddNumberToObject(root, "PitchBend", g_synth.pitchBend);
-    cJSON_AddNumberToObject(root, "PitchBendRange", g_synth.pitchBendRange);
-    cJSON_AddNumberToObject(root, "ModWheelValue", g_synth.modWheelValue);
-    cJSON_AddNumberToObject(root, "ModLfoPhase", g_synth.modLfoPhase);
-    cJSON_AddNumberToObject(root, "ModLfoRate", g_synth.modLfoRate);
+    cJSON_AddNumberToObject(root, "MasterVolume", patch.masterVolume);
+    cJSON_AddNumberToObject(root, "Pan", patch.pan);
+    cJSON_AddNumberToObject(root, "UnisonCount", patch.unisonCount);
+    cJSON_AddNumberToObject(root, "UnisonSpreadIndex", patch.unisonSpreadIndex);
+    cJSON_AddNumberToObject(root, "PitchBend", patch.pitchBend);
+    cJSON_AddNumberToObject(root, "PitchBendRange", patch.pitchBendRange);
+    cJSON_AddNumberToObject(root, "ModWheelValue", patch.modWheelValue);
+    cJSON_AddNumberToObject(root, "ModLfoPhase", patch.modLfoPhase);
+    cJSON_AddNumberToObject(root, "ModLfoRate", patch.modLfoRate);
 
     // Arpeggiator
     cJSON *arp = cJSON_AddObjectToObject(root, "Arpeggiator");
-    cJSON_AddBoolToObject(arp, "Enabled", g_synth.arpEnabled);
-    cJSON_AddNumberToObject(arp, "Bpm", g_synth.arpBpm);
-    cJSON_AddNumberToObject(arp, "Gate", g_synth.arpGate);
-    cJSON_AddNumberToObject(arp, "Direction", g_synth.arpDirection);
-    cJSON_AddNumberToObject(arp, "Range", g_synth.arpRange);
-    cJSON_AddBoolToObject(arp, "Hold", g_synth.arpHold);
-
-    // Voices
-    cJSON *voices = cJSON_AddArrayToObject(root, "Voices");
-    for (size_t v = 0; v < g_synth.voices.size(); ++v) {
-        Voice& voice = g_synth.voices[v];
-        cJSON *vobj = cJSON_CreateObject();
-        cJSON_AddNumberToObject(vobj, "AttackTime", voice.getAttackTime());
-        cJSON_AddNumberToObject(vobj, "DecayTime", voice.getDecayTime());
-        cJSON_AddNumberToObject(vobj, "SustainLevel", voice.getSustainLevel());
-        cJSON_AddNumberToObject(vobj, "ReleaseTime", voice.getReleaseTime());
-        cJSON_AddNumberToObject(vobj, "MixLevel", voice.getMixLevel());
-        cJSON_AddNumberToObject(vobj, "UnisonCount", voice.getUnisonCount());
-        cJSON_AddNumberToObject(vobj, "UnisonSpreadIndex", voice.getUnisonSpreadIndex());
-
-        cJSON *vcos = cJSON_AddArrayToObject(vobj, "VCOs");
-        for (int i = 0; i < 3; ++i) {
-            cJSON *vco = cJSON_CreateObject();
-            cJSON_AddNumberToObject(vco, "Waveform", voice.getVcoWaveform(i));
-            cJSON_AddNumberToObject(vco, "Mix", voice.getVcoMix(i));
-            cJSON_AddNumberToObject(vco, "Detune", voice.getVcoDetune(i));
-            cJSON_AddNumberToObject(vco, "PhaseMs", voice.getVcoPhaseMs(i));
-            cJSON_AddNumberToObject(vco, "PulseWidth", voice.getVcoPulseWidth(i));
-            cJSON_AddNumberToObject(vco, "PitchShift", voice.getVcoPitchShift(i));
-            cJSON_AddNumberToObject(vco, "Pan", voice.getVcoPan(i));
-            cJSON_AddItemToArray(vcos, vco);
+    cJSON_AddBoolToObject(arp, "Enabled", patch.arpEnabled);
+    cJSON_AddNumberToObject(arp, "Bpm", patch.arpBpm);
+    cJSON_AddNumberToObject(arp, "Gate", patch.arpGate);
+    cJSON_AddNumberToObject(arp, "Direction", patch.arpDirection);
+    cJSON_AddNumberToObject(arp, "Range", patch.arpRange);
+    cJSON_AddBoolToObject(arp, "Hold", patch.arpHold);
+    cJSON_AddNumberToObject(arp, "Swing", patch.arpSwing);
+    cJSON_AddNumberToObject(arp, "Ratchet", patch.arpRatchet);
+
+    // Voice
+    cJSON_AddItemToObject(root, "Voice", voiceToJson(patch.voice));
+
+    // Multitimbral mode; the parts are only stored when it is on
+    cJSON_AddBoolToObject(root, "Multitimbral", patch.multitimbral);
+    if (patch.multitimbral) {
+        cJSON *parts = cJSON_AddArrayToObject(root, "Parts");
+        for (const Part& part : patch.parts) {
+            cJSON *pobj = cJSON_CreateObject();
+            cJSON_AddItemToObject(pobj, "Voice", voiceToJson(part.voice));
+            cJSON_AddNumberToObject(pobj, "MaxVoices", part.maxVoices);
+            cJSON_AddNumberToObject(pobj, "Volume", part.volume);
+            cJSON_AddNumberToObject(pobj, "Pan", part.pan);
+            cJSON_AddNumberToObject(pobj, "FxSend", part.fxSend);
+            cJSON_AddBoolToObject(pobj, "Muted", part.muted);
+            cJSON_AddItemToArray(parts, pobj);
+        }
+    }
+
+    // MIDI controller assignments
+    if (patch.midiMap.size() > 0) {
+        cJSON *mappings = cJSON_AddArrayToObject(root, "MidiMap");
+        for (int i = 0; i < patch.midiMap.size(); ++i) {
+            const MidiMapping& m = patch.midiMap[i];
+            cJSON *mobj = cJSON_CreateObject();
+            cJSON_AddStringToObject(mobj, "Param", paramInfo(m.param).key);
+            cJSON_AddStringToObject(mobj, "Source", MIDI_SOURCE_NAMES[(int)m.source]);
+            cJSON_AddNumberToObject(mobj, "Channel", m.channel + 1);
+            cJSON_AddNumberToObject(mobj, "Number", m.number);
+            cJSON_AddNumberToObject(mobj, "Min", m.minValue);
+            cJSON_AddNumberToObject(mobj, "Max", m.maxValue);
+            cJSON_AddStringToObject(mobj, "Curve", MIDI_CURVE_NAMES[(int)m.curve]);
+            cJSON_AddItemToArray(mappings, mobj);
         }
-        cJSON_AddItemToArray(voices, vobj);
     }
 
     // Effects
     cJSON *effects = cJSON_AddObjectToObject(root, "Effects");
 
     cJSON *flanger = cJSON_AddObjectToObject(effects, "Flanger");
-    cJSON_AddBoolToObject(flanger, "Enabled", g_synth.flangerEnabled);
-    cJSON_AddNumberToObject(flanger, "Rate", g_synth.flangerRate);
-    cJSON_AddNumberToObject(flanger, "Depth", g_synth.flangerDepth);
-    cJSON_AddNumberToObject(flanger, "Mix", g_synth.flangerMix);
+    cJSON_AddBoolToObject(flanger, "Enabled", patch.flangerEnabled);
+    cJSON_AddNumberToObject(flanger, "Rate", patch.flangerRate);
+    cJSON_AddNumberToObject(flanger, "Depth", patch.flangerDepth);
+    cJSON_AddNumberToObject(flanger, "Mix", patch.flangerMix);
 
     cJSON *delay = cJSON_AddObjectToObject(effects, "Delay");
-    cJSON_AddBoolToObject(delay, "Enabled", g_synth.delayEnabled);
-    cJSON_AddNumberToObject(delay, "TimeSec", g_synth.delayTimeSec);
-    cJSON_AddNumberToObject(delay, "Feedback", g_synth.delayFeedback);
-    cJSON_AddNumberToObject(delay, "Mix", g_synth.delayMix);
+    cJSON_AddBoolToObject(delay, "Enabled", patch.delayEnabled);
+    cJSON_AddNumberToObject(delay, "TimeSec", patch.delayTimeSec);
+    cJSON_AddNumberToObject(delay, "Feedback", patch.delayFeedback);
+    cJSON_AddNumberToObject(delay, "Mix", patch.delayMix);
 
     cJSON *reverb = cJSON_AddObjectToObject(effects, "Reverb");
-    cJSON_AddBoolToObject(reverb, "Enabled", g_synth.reverbEnabled);
-    cJSON_AddNumberToObject(reverb, "Size", g_synth.reverbSize);
-    cJSON_AddNumberToObject(reverb, "Damp", g_synth.reverbDamp);
-    cJSON_AddNumberToObject(reverb, "Delay", g_synth.reverbDelay);
-    cJSON_AddNumberToObject(reverb, "Diffuse", g_synth.reverbDiffuse);
-    cJSON_AddNumberToObject(reverb, "Stereo", g_synth.reverbStereo);
-    cJSON_AddNumberToObject(reverb, "DryMix", g_synth.reverbDryMix);
-    cJSON_AddNumberToObject(reverb, "WetMix", g_synth.reverbWetMix);
+    cJSON_AddBoolToObject(reverb, "Enabled", patch.reverbEnabled);
+    cJSON_AddNumberToObject(reverb, "Size", patch.reverbSize);
+    cJSON_AddNumberToObject(reverb, "Damp", patch.reverbDamp);
+    cJSON_AddNumberToObject(reverb, "Delay", patch.reverbDelay);
+    cJSON_AddNumberToObject(reverb, "Diffuse", patch.reverbDiffuse);
+    cJSON_AddNumberToObject(reverb, "Stereo", patch.reverbStereo);
+    cJSON_AddNumberToObject(reverb, "DryMix", patch.reverbDryMix);
+    cJSON_AddNumberToObject(reverb, "WetMix", patch.reverbWetMix);
 
      cJSON *compressor = cJSON_AddObjectToObject(effects, "Compressor");
-     cJSON_AddBoolToObject(compressor, "Enabled", g_synth.compressorEnabled);
-     cJSON_AddNumberToObject(compressor, "ThresholdDb", g_synth.compressorThresholdDb);
-     cJSON_AddNumberToObject(compressor, "Ratio", g_synth.compressorRatio);
-     cJSON_AddNumberToObject(compressor, "AttackMs", g_synth.compressorAttackMs);
-     cJSON_AddNumberToObject(compressor, "ReleaseMs", g_synth.compressorReleaseMs);
-     cJSON_AddNumberToObject(compressor, "MakeupDb", g_synth.compressorMakeupDb);
+     cJSON_AddBoolToObject(compressor, "Enabled", patch.compressorEnabled);
+     cJSON_AddNumberToObject(compressor, "ThresholdDb", patch.compressorThresholdDb);
+     cJSON_AddNumberToObject(compressor, "Ratio", patch.compressorRatio);
+     cJSON_AddNumberToObject(compressor, "AttackMs", patch.compressorAttackMs);
+     cJSON_AddNumberToObject(compressor, "ReleaseMs", patch.compressorReleaseMs);
+     cJSON_AddNumberToObject(compressor, "MakeupDb", patch.compressorMakeupDb);
 
      cJSON *dcFilter = cJSON_AddObjectToObject(effects, "DCFilter");
-     cJSON_AddBoolToObject(dcFilter, "Enabled", g_synth.dcFilterEnabled);
-     cJSON_AddNumberToObject(dcFilter, "Alpha", g_synth.dcFilterAlpha);
+     cJSON_AddBoolToObject(dcFilter, "Enabled", patch.dcFilterEnabled);
+     cJSON_AddNumberToObject(dcFilter, "Alpha", patch.dcFilterAlpha);
 
      cJSON *softClip = cJSON_AddObjectToObject(effects, "SoftClipping");
-     cJSON_AddBoolToObject(softClip, "Enabled", g_synth.softClipEnabled);
-     cJSON_AddNumberToObject(softClip, "Drive", g_synth.softClipDrive);
+     cJSON_AddBoolToObject(softClip, "Enabled", patch.softClipEnabled);
+     cJSON_AddNumberToObject(softClip, "Drive", patch.softClipDrive);
 
      cJSON *autoGain = cJSON_AddObjectToObject(effects, "AutoGain");
-     cJSON_AddBoolToObject(autoGain, "Enabled", g_synth.autoGainEnabled);
-     cJSON_AddNumberToObject(autoGain, "TargetRMS", g_synth.autoGainTargetRMS);
-     cJSON_AddNumberToObject(autoGain, "Alpha", g_synth.autoGainAlpha);
+     cJSON_AddBoolToObject(autoGain, "Enabled", patch.autoGainEnabled);
+     cJSON_AddNumberToObject(autoGain, "TargetRMS", patch.autoGainTargetRMS);
+     cJSON_AddNumberToObject(autoGain, "Alpha", patch.autoGainAlpha);
 
     // Filter
     cJSON *filter = cJSON_AddObjectToObject(root, "Filter");
-    cJSON_AddBoolToObject(filter, "Enabled", g_synth.filterEnabled);
-    cJSON_AddNumberToObject(filter, "Cutoff", g_synth.filter.getCutoff());
-    cJSON_AddNumberToObject(filter, "Resonance", g_synth.filter.getResonance());
-    cJSON_AddNumberToObject(filter, "Drive", g_synth.filter.getDrive());
-    cJSON_AddNumberToObject(filter, "Inertial", g_synth.filter.getInertial());
-    cJSON_AddNumberToObject(filter, "Oversampling", g_synth.filter.getOversampling());
+    cJSON_AddBoolToObject(filter, "Enabled", patch.filterEnabled);
+    cJSON_AddNumberToObject(filter, "Cutoff", patch.filterCutoff);
+    cJSON_AddNumberToObject(filter, "Resonance", patch.filterResonance);
+    cJSON_AddNumberToObject(filter, "Drive", patch.filterDrive);
+    cJSON_AddNumberToObject(filter, "Inertial", patch.filterInertial);
+    cJSON_AddNumberToObject(filter, "Oversampling", patch.filterOversampling);
 
     // Window state
-    if (g_window) {
+    if (patch.hasWindow) {
         cJSON *window = cJSON_AddObjectToObject(root, "Window");
-        int x, y;
-        SDL_GetWindowPosition(g_window, &x, &y);
-        cJSON_AddNumberToObject(window, "x", x);
-        cJSON_AddNumberToObject(window, "y", y);
-        int w, h;
-        SDL_GetWindowSize(g_window, &w, &h);
-        cJSON_AddNumberToObject(window, "w", w);
-        cJSON_AddNumberToObject(window, "h", h);
-        Uint32 flags = SDL_GetWindowFlags(g_window);
-        bool fullscreen = (flags & SDL_WINDOW_FULLSCREEN);
-        cJSON_AddBoolToObject(window, "fullscreen", fullscreen);
+        cJSON_AddNumberToObject(window, "x", patch.windowX);
+        cJSON_AddNumberToObject(window, "y", patch.windowY);
+        cJSON_AddNumberToObject(window, "w", patch.windowW);
+        cJSON_AddNumberToObject(window, "h", patch.windowH);
+        cJSON_AddBoolToObject(window, "fullscreen", patch.windowFullscreen);
     }
 
+    bool ok = false;
     char *json_str = cJSON_Print(root);
     if (json_str) {
         std::ofstream file(filename);
         if (file.is_open()) {
             file << json_str;
             file.close();
+            ok = true;
             SDL_Log("Preset saved to: %s", filename.c_str());
         } else {
             SDL_Log("Failed to open preset file for writing: %s", filename.c_str());
@@ -149,13 +325,14 @@ void Preset::save(const std::string& filename) {
         SDL_Log("Failed to serialize JSON");
     }
     cJSON_Delete(root);
+    return ok;
 }
 
-void Preset::load(const std::string& filename) {
+bool Preset::read(const std::string& filename, Patch& patch) {
     std::ifstream file(filename);
     if (!file.is_open()) {
         SDL_Log("Failed to open preset file for reading: %s", filename.c_str());
-        return;
+        return false;
     }
 
     std::string json_str((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
@@ -164,91 +341,123 @@ void Preset::load(const std::string& filename) {
     cJSON *root = cJSON_Parse(json_str.c_str());
     if (!root) {
         SDL_Log("Failed to parse JSON from: %s", filename.c_str());
-        return;
+        return false;
+    }
+    fromJson(root, patch);
+    cJSON_Delete(root);
+    SDL_Log("Preset loaded from: %s", filename.c_str());
+    return true;
+}
+
+void Preset::fromJson(cJSON* root, Patch& patch) {
+    // Library metadata
+    cJSON *item = cJSON_GetObjectItem(root, "Name");
+    if (item && cJSON_IsString(item)) patch.name = item->valuestring;
+    cJSON *tags = cJSON_GetObjectItem(root, "Tags");
+    if (tags && cJSON_IsArray(tags)) {
+        patch.tags.clear();
+        cJSON *tag = nullptr;
+        cJSON_ArrayForEach(tag, tags) {
+            if (cJSON_IsString(tag)) patch.tags.push_back(tag->valuestring);
+        }
     }
 
     // Global parameters
-    cJSON *item = cJSON_GetObjectItem(root, "MasterVolume");
-    if (item) g_synth.masterVolume = item->valuedouble;
+    item = cJSON_GetObjectItem(root, "MasterVolume");
+    if (item) patch.masterVolume = item->valuedouble;
     item = cJSON_GetObjectItem(root, "Pan");
-    if (item) g_synth.pan = item->valuedouble;
+    if (item) patch.pan = item->valuedouble;
     item = cJSON_GetObjectItem(root, "UnisonCount");
-    if (item) g_synth.unisonCount = item->valueint;
+    if (item) patch.unisonCount = item->valueint;
     item = cJSON_GetObjectItem(root, "UnisonSpreadIndex");
-    if (item) g_synth.unisonSpreadIndex = item->valueint;
+    if (item) patch.unisonSpreadIndex = item->valueint;
     item = cJSON_GetObjectItem(root, "PitchBend");
-    if (item) g_synth.pitchBend = item->valuedouble;
+    if (item) patch.pitchBend = item->valuedouble;
     item = cJSON_GetObjectItem(root, "PitchBendRange");
-    if (item) g_synth.pitchBendRange = item->valuedouble;
+    if (item) patch.pitchBendRange = item->valuedouble;
     item = cJSON_GetObjectItem(root, "ModWheelValue");
-    if (item) g_synth.modWheelValue = item->valuedouble;
+    if (item) patch.modWheelValue = item->valuedouble;
     item = cJSON_GetObjectItem(root, "ModLfoPhase");
-    if (item) g_synth.modLfoPhase = item->valuedouble;
+    if (item) patch.modLfoPhase = item->valuedouble;
     item = cJSON_GetObjectItem(root, "ModLfoRate");
-    if (item) g_synth.modLfoRate = item->valuedouble;
+    if (item) patch.modLfoRate = item->valuedouble;
 
     // Arpeggiator
     cJSON *arp = cJSON_GetObjectItem(root, "Arpeggiator");
     if (arp) {
         item = cJSON_GetObjectItem(arp, "Enabled");
-        if (item) g_synth.arpEnabled = cJSON_IsTrue(item);
+        if (item) patch.arpEnabled = cJSON_IsTrue(item);
         item = cJSON_GetObjectItem(arp, "Bpm");
-        if (item) g_synth.arpBpm = item->valuedouble;
+        if (item) patch.arpBpm = item->valuedouble;
         item = cJSON_GetObjectItem(arp, "Gate");
-        if (item) g_synth.arpGate = item->valuedouble;
+        if (item) patch.arpGate = item->valuedouble;
         item = cJSON_GetObjectItem(arp, "Direction");
-        if (item) g_synth.arpDirection = item->valueint;
+        if (item) patch.arpDirection = item->valueint;
         item = cJSON_GetObjectItem(arp, "Range");
-        if (item) g_synth.arpRange = item->valueint;
+        if (item) patch.arpRange = item->valueint;
         item = cJSON_GetObjectItem(arp, "Hold");
-        if (item) g_synth.arpHold = cJSON_IsTrue(item);
+        if (item) patch.arpHold = cJSON_IsTrue(item);
+        item = cJSON_GetObjectItem(arp, "Swing");
+        if (item) patch.arpSwing = item->valuedouble;
+        item = cJSON_GetObjectItem(arp, "Ratchet");
+        if (item) patch.arpRatchet = item->valueint;
     }
 
-    // Voices
-    cJSON *voices = cJSON_GetObjectItem(root, "Voices");
-    if (voices && cJSON_IsArray(voices)) {
-        int num_voices = cJSON_GetArraySize(voices);
-        for (int v = 0; v < num_voices && v < (int)g_synth.voices.size(); ++v) {
-            cJSON *vobj = cJSON_GetArrayItem(voices, v);
-            if (!vobj) continue;
-            Voice& voice = g_synth.voices[v];
-
-            item = cJSON_GetObjectItem(vobj, "AttackTime");
-            if (item) voice.setAttackTime(item->valuedouble);
-            item = cJSON_GetObjectItem(vobj, "DecayTime");
-            if (item) voice.setDecayTime(item->valuedouble);
-            item = cJSON_GetObjectItem(vobj, "SustainLevel");
-            if (item) voice.setSustainLevel(item->valuedouble);
-            item = cJSON_GetObjectItem(vobj, "ReleaseTime");
-            if (item) voice.setReleaseTime(item->valuedouble);
-            item = cJSON_GetObjectItem(vobj, "MixLevel");
-            if (item) voice.setMixLevel(item->valuedouble);
-            item = cJSON_GetObjectItem(vobj, "UnisonCount");
-            if (item) voice.setUnisonCount(item->valueint);
-            item = cJSON_GetObjectItem(vobj, "UnisonSpreadIndex");
-            if (item) voice.setUnisonSpreadIndex(item->valueint);
-
-            cJSON *vcos = cJSON_GetObjectItem(vobj, "VCOs");
-            if (vcos && cJSON_IsArray(vcos)) {
-                for (int i = 0; i < 3 && i < cJSON_GetArraySize(vcos); ++i) {
-                    cJSON *vco = cJSON_GetArrayItem(vcos, i);
-                    if (!vco) continue;
-                    item = cJSON_GetObjectItem(vco, "Waveform");
-                    if (item) voice.setVcoWaveform(i, static_cast<Oscillator::WaveformType>(item->valueint));
-                    item = cJSON_GetObjectItem(vco, "Mix");
-                    if (item) voice.setVcoMix(i, item->valuedouble);
-                    item = cJSON_GetObjectItem(vco, "Detune");
-                    if (item) voice.setVcoDetune(i, item->valuedouble);
-                    item = cJSON_GetObjectItem(vco, "PhaseMs");
-                    if (item) voice.setVcoPhaseMs(i, item->valuedouble);
-                    item = cJSON_GetObjectItem(vco, "PulseWidth");
-                    if (item) voice.setVcoPulseWidth(i, item->valuedouble);
-                    item = cJSON_GetObjectItem(vco, "PitchShift");
-                    if (item) voice.setVcoPitchShift(i, item->valuedouble);
-                    item = cJSON_GetObjectItem(vco, "Pan");
-                    if (item) voice.setVcoPan(i, item->valuedouble);
-                }
-            }
+    // Voice; older presets stored a copy per voice in "Voices", all alike, so the first one stands for all
+    cJSON *voice = cJSON_GetObjectItem(root, "Voice");
+    if (!voice) {
+        cJSON *voices = cJSON_GetObjectItem(root, "Voices");
+        if (voices && cJSON_IsArray(voices)) voice = cJSON_GetArrayItem(voices, 0);
+    }
+    if (voice && cJSON_IsObject(voice)) voiceFromJson(voice, patch.voice);
+
+    // Multitimbral parts; a preset without the key is single-timbral, and parts it does not store stay
+    item = cJSON_GetObjectItem(root, "Multitimbral");
+    patch.multitimbral = item && cJSON_IsTrue(item);
+    cJSON *parts = cJSON_GetObjectItem(root, "Parts");
+    if (parts && cJSON_IsArray(parts)) {
+        for (int p = 0; p < NUM_PARTS && p < cJSON_GetArraySize(parts); ++p) {
+            cJSON *pobj = cJSON_GetArrayItem(parts, p);
+            if (!pobj) continue;
+            Part& part = patch.parts[p];
+            cJSON *vobj = cJSON_GetObjectItem(pobj, "Voice");
+            if (vobj) voiceFromJson(vobj, part.voice);
+            item = cJSON_GetObjectItem(pobj, "MaxVoices");
+            if (item) part.maxVoices = item->valueint;
+            item = cJSON_GetObjectItem(pobj, "Volume");
+            if (item) part.volume = item->valuedouble;
+            item = cJSON_GetObjectItem(pobj, "Pan");
+            if (item) part.pan = item->valuedouble;
+            item = cJSON_GetObjectItem(pobj, "FxSend");
+            if (item) part.fxSend = item->valuedouble;
+            item = cJSON_GetObjectItem(pobj, "Muted");
+            if (item) part.muted = cJSON_IsTrue(item);
+        }
+    }
+
+    // MIDI controller assignments replace the current ones as a whole
+    cJSON *mappings = cJSON_GetObjectItem(root, "MidiMap");
+    if (mappings && cJSON_IsArray(mappings)) {
+        patch.midiMap.clear();
+        cJSON *mobj;
+        cJSON_ArrayForEach(mobj, mappings) {
+            MidiMapping m;
+            item = cJSON_GetObjectItem(mobj, "Param");
+            if (!item || !cJSON_IsString(item) || (m.param = paramFromKey(item->valuestring)) == ParamId::None) continue;
+            item = cJSON_GetObjectItem(mobj, "Source");
+            if (item && cJSON_IsString(item)) m.source = (MidiSource)indexOfName(MIDI_SOURCE_NAMES, 3, item->valuestring);
+            item = cJSON_GetObjectItem(mobj, "Channel");
+            if (item) m.channel = (uint8_t)std::clamp(item->valueint - 1, 0, 15);
+            item = cJSON_GetObjectItem(mobj, "Number");
+            if (item) m.number = (uint16_t)std::clamp(item->valueint, 0, m.source == MidiSource::NRPN ? 16383 : 127);
+            const ParamInfo& info = paramInfo(m.param);
+            item = cJSON_GetObjectItem(mobj, "Min");
+            m.minValue = item ? (float)item->valuedouble : info.minValue;
+            item = cJSON_GetObjectItem(mobj, "Max");
+            m.maxValue = item ? (float)item->valuedouble : info.maxValue;
+            item = cJSON_GetObjectItem(mobj, "Curve");
+            if (item && cJSON_IsString(item)) m.curve = (MidiCurve)indexOfName(MIDI_CURVE_NAMES, 3, item->valuestring);
+            patch.midiMap.set(m);
         }
     }
 
@@ -258,87 +467,87 @@ void Preset::load(const std::string& filename) {
         cJSON *flanger = cJSON_GetObjectItem(effects, "Flanger");
         if (flanger) {
             item = cJSON_GetObjectItem(flanger, "Enabled");
-            if (item) g_synth.flangerEnabled = cJSON_IsTrue(item);
+            if (item) patch.flangerEnabled = cJSON_IsTrue(item);
             item = cJSON_GetObjectItem(flanger, "Rate");
-            if (item) g_synth.flangerRate = item->valuedouble;
+            if (item) patch.flangerRate = item->valuedouble;
             item = cJSON_GetObjectItem(flanger, "Depth");
-            if (item) g_synth.flangerDepth = item->valuedouble;
+            if (item) patch.flangerDepth = item->valuedouble;
             item = cJSON_GetObjectItem(flanger, "Mix");
-            if (item) g_synth.flangerMix = item->valuedouble;
+            if (item) patch.flangerMix = item->valuedouble;
         }
 
         cJSON *delay = cJSON_GetObjectItem(effects, "Delay");
         if (delay) {
             item = cJSON_GetObjectItem(delay, "Enabled");
-            if (item) g_synth.delayEnabled = cJSON_IsTrue(item);
+            if (item) patch.delayEnabled = cJSON_IsTrue(item);
             item = cJSON_GetObjectItem(delay, "TimeSec");
-            if (item) g_synth.delayTimeSec = item->valuedouble;
+            if (item) patch.delayTimeSec = item->valuedouble;
             item = cJSON_GetObjectItem(delay, "Feedback");
-            if (item) g_synth.delayFeedback = item->valuedouble;
+            if (item) patch.delayFeedback = item->valuedouble;
             item = cJSON_GetObjectItem(delay, "Mix");
-            if (item) g_synth.delayMix = item->valuedouble;
+            if (item) patch.delayMix = item->valuedouble;
         }
 
         cJSON *reverb = cJSON_GetObjectItem(effects, "Reverb");
         if (reverb) {
             item = cJSON_GetObjectItem(reverb, "Enabled");
-            if (item) g_synth.reverbEnabled = cJSON_IsTrue(item);
+            if (item) patch.reverbEnabled = cJSON_IsTrue(item);
             item = cJSON_GetObjectItem(reverb, "Size");
-            if (item) g_synth.reverbSize = item->valuedouble;
+            if (item) patch.reverbSize = item->valuedouble;
             item = cJSON_GetObjectItem(reverb, "Damp");
-            if (item) g_synth.reverbDamp = item->valuedouble;
+            if (item) patch.reverbDamp = item->valuedouble;
             item = cJSON_GetObjectItem(reverb, "Delay");
-            if (item) g_synth.reverbDelay = item->valuedouble;
+            if (item) patch.reverbDelay = item->valuedouble;
             item = cJSON_GetObjectItem(reverb, "Diffuse");
-            if (item) g_synth.reverbDiffuse = item->valuedouble;
+            if (item) patch.reverbDiffuse = item->valuedouble;
             item = cJSON_GetObjectItem(reverb, "Stereo");
-            if (item) g_synth.reverbStereo = item->valuedouble;
+            if (item) patch.reverbStereo = item->valuedouble;
             item = cJSON_GetObjectItem(reverb, "DryMix");
-            if (item) g_synth.reverbDryMix = item->valuedouble;
+            if (item) patch.reverbDryMix = item->valuedouble;
             item = cJSON_GetObjectItem(reverb, "WetMix");
-            if (item) g_synth.reverbWetMix = item->valuedouble;
+            if (item) patch.reverbWetMix = item->valuedouble;
         }
 
          cJSON *compressor = cJSON_GetObjectItem(effects, "Compressor");
          if (compressor) {
              item = cJSON_GetObjectItem(compressor, "Enabled");
-             if (item) g_synth.compressorEnabled = cJSON_IsTrue(item);
+             if (item) patch.compressorEnabled = cJSON_IsTrue(item);
              item = cJSON_GetObjectItem(compressor, "ThresholdDb");
-             if (item) g_synth.compressorThresholdDb = item->valuedouble;
+             if (item) patch.compressorThresholdDb = item->valuedouble;
              item = cJSON_GetObjectItem(compressor, "Ratio");
-             if (item) g_synth.compressorRatio = item->valuedouble;
+             if (item) patch.compressorRatio = item->valuedouble;
              item = cJSON_GetObjectItem(compressor, "AttackMs");
-             if (item) g_synth.compressorAttackMs = item->valuedouble;
+             if (item) patch.compressorAttackMs = item->valuedouble;
              item = cJSON_GetObjectItem(compressor, "ReleaseMs");
-             if (item) g_synth.compressorReleaseMs = item->valuedouble;
+             if (item) patch.compressorReleaseMs = item->valuedouble;
              item = cJSON_GetObjectItem(compressor, "MakeupDb");
-             if (item) g_synth.compressorMakeupDb = item->valuedouble;
+             if (item) patch.compressorMakeupDb = item->valuedouble;
          }
 
          cJSON *dcFilter = cJSON_GetObjectItem(effects, "DCFilter");
          if (dcFilter) {
              item = cJSON_GetObjectItem(dcFilter, "Enabled");
-             if (item) g_synth.dcFilterEnabled = cJSON_IsTrue(item);
+             if (item) patch.dcFilterEnabled = cJSON_IsTrue(item);
              item = cJSON_GetObjectItem(dcFilter, "Alpha");
-             if (item) g_synth.dcFilterAlpha = item->valuedouble;
+             if (item) patch.dcFilterAlpha = item->valuedouble;
          }
 
          cJSON *softClip = cJSON_GetObjectItem(effects, "SoftClipping");
          if (softClip) {
              item = cJSON_GetObjectItem(softClip, "Enabled");
-             if (item) g_synth.softClipEnabled = cJSON_IsTrue(item);
+             if (item) patch.softClipEnabled = cJSON_IsTrue(item);
              item = cJSON_GetObjectItem(softClip, "Drive");
-             if (item) g_synth.softClipDrive = item->valuedouble;
+             if (item) patch.softClipDrive = item->valuedouble;
          }
 
          cJSON *autoGain = cJSON_GetObjectItem(effects, "AutoGain");
          if (autoGain) {
              item = cJSON_GetObjectItem(autoGain, "Enabled");
-             if (item) g_synth.autoGainEnabled = cJSON_IsTrue(item);
+             if (item) patch.autoGainEnabled = cJSON_IsTrue(item);
              item = cJSON_GetObjectItem(autoGain, "TargetRMS");
-             if (item) g_synth.autoGainTargetRMS = item->valuedouble;
+             if (item) patch.autoGainTargetRMS = item->valuedouble;
              item = cJSON_GetObjectItem(autoGain, "Alpha");
-             if (item) g_synth.autoGainAlpha = item->valuedouble;
+             if (item) patch.autoGainAlpha = item->valuedouble;
          }
     }
 
@@ -346,40 +555,113 @@ void Preset::load(const std::string& filename) {
     cJSON *filter = cJSON_GetObjectItem(root, "Filter");
     if (filter) {
         item = cJSON_GetObjectItem(filter, "Enabled");
-        if (item) g_synth.filterEnabled = cJSON_IsTrue(item);
+        if (item) patch.filterEnabled = cJSON_IsTrue(item);
         item = cJSON_GetObjectItem(filter, "Cutoff");
-        if (item) g_synth.filter.setCutoff(item->valuedouble);
+        if (item) patch.filterCutoff = item->valuedouble;
         item = cJSON_GetObjectItem(filter, "Resonance");
-        if (item) g_synth.filter.setResonance(item->valuedouble);
+        if (item) patch.filterResonance = item->valuedouble;
         item = cJSON_GetObjectItem(filter, "Drive");
-        if (item) g_synth.filter.setDrive(item->valuedouble);
+        if (item) patch.filterDrive = item->valuedouble;
         item = cJSON_GetObjectItem(filter, "Inertial");
-        if (item) g_synth.filter.setInertial(item->valuedouble);
+        if (item) patch.filterInertial = item->valuedouble;
         item = cJSON_GetObjectItem(filter, "Oversampling");
-        if (item) g_synth.filter.setOversampling(item->valueint);
+        if (item) patch.filterOversampling = item->valueint;
     }
 
     // Window state
     cJSON *window = cJSON_GetObjectItem(root, "Window");
-    if (window && g_window) {
+    if (window) {
+        patch.hasWindow = true;
         item = cJSON_GetObjectItem(window, "x");
-        int x = item ? item->valueint : SDL_WINDOWPOS_UNDEFINED;
+        patch.windowX = item ? item->valueint : SDL_WINDOWPOS_UNDEFINED;
         item = cJSON_GetObjectItem(window, "y");
-        int y = item ? item->valueint : SDL_WINDOWPOS_UNDEFINED;
-        SDL_SetWindowPosition(g_window, x, y);
-
+        patch.windowY = item ? item->valueint : SDL_WINDOWPOS_UNDEFINED;
         item = cJSON_GetObjectItem(window, "w");
-        int w = item ? item->valueint : 800;
+        patch.windowW = item ? item->valueint : 800;
         item = cJSON_GetObjectItem(window, "h");
-        int h = item ? item->valueint : 600;
-        SDL_SetWindowSize(g_window, w, h);
-
+        patch.windowH = item ? item->valueint : 600;
         item = cJSON_GetObjectItem(window, "fullscreen");
-        if (item && cJSON_IsTrue(item)) {
-            SDL_SetWindowFullscreen(g_window, true);
+        patch.windowFullscreen = item && cJSON_IsTrue(item);
+    }
+}
+
+void Preset::save(const std::string& filename) {
+    Patch patch;
+    {
+        std::lock_guard<std::mutex> lock(g_synthMutex);
+        patch.capture(g_synth);
+    }
+    captureWindowState(patch);
+    write(filename, patch);
+}
+
+void Preset::load(const std::string& filename) {
+    // Keys missing from the file keep their current values
+    Patch* patch = new Patch();
+    {
+        std::lock_guard<std::mutex> lock(g_synthMutex);
+        patch->capture(g_synth);
+    }
+    if (!read(filename, *patch)) {
+        delete patch;
+        return;
+    }
+    applyWindowState(*patch);
+    g_synth.patchExchange.publish(patch);
+}
+
+void Preset::saveAsync(const std::string& filename, const Patch& patch) {
+    PresetJob job{false, filename, patch, false};
+    captureWindowState(job.patch);
+    enqueueJob(std::move(job));
+}
+
+void Preset::loadAsync(const std::string& filename, const Patch& base) {
+    enqueueJob(PresetJob{true, filename, base, false});
+}
+
+void Preset::loadPartAsync(const std::string& filename, const Patch& base, int part) {
+    if (part < 0 || part >= NUM_PARTS) return;
+    enqueueJob(PresetJob{true, filename, base, false, part});
+}
+
+void Preset::runAsync(std::function<bool(std::string& status)> work,
+                      std::function<void(bool ok, std::string& status)> done) {
+    PresetJob job{false, std::string(), Patch(), false};
+    job.work = std::move(work);
+    job.done = std::move(done);
+    enqueueJob(std::move(job));
+}
+
+bool Preset::poll(std::string& statusMessage) {
+    PresetJob job;
+    {
+        std::lock_guard<std::mutex> lock(g_jobMutex);
+        if (g_results.empty()) return false;
+        job = std::move(g_results.front());
+        g_results.pop_front();
+    }
+    if (job.work) {
+        statusMessage = job.status;
+        if (job.done) job.done(job.ok, statusMessage);
+    } else if (job.isLoad) {
+        if (job.part >= 0) {
+            statusMessage = (job.ok ? "Preset loaded into part " + std::to_string(job.part + 1) + ": " : "Failed to load preset: ") + job.filename;
+        } else {
+            if (job.ok) applyWindowState(job.patch);
+            statusMessage = (job.ok ? "Preset loaded: " : "Failed to load preset: ") + job.filename;
         }
+    } else {
+        statusMessage = (job.ok ? "Preset saved: " : "Failed to save preset: ") + job.filename;
     }
+    return true;
+}
 
-    cJSON_Delete(root);
-    SDL_Log("Preset loaded from: %s", filename.c_str());
-}
\ No newline at end of file
+void Preset::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(g_jobMutex);
+        g_workerShouldExit = true;
+        g_jobCv.notify_one();
+    }
+    if (g_worker.joinable()) g_worker.join();
+}
@@ -1,9 +1,33 @@
 #pragma once
 
+#include <functional>
 #include <string>
 
+struct Patch;
+struct cJSON;
+
 class Preset {
 public:
+    // Synchronous save/load of the live synthesizer state. Must not be called with g_synthMutex held.
     static void save(const std::string& filename);
     static void load(const std::string& filename);
-};
\ No newline at end of file
+
+    // JSON <-> Patch. read() only overwrites the keys present in the file.
+    static bool read(const std::string& filename, Patch& patch);
+    static bool write(const std::string& filename, const Patch& patch);
+    // The same for a preset object that is already parsed (e.g. embedded in another file)
+    static void fromJson(cJSON* root, Patch& patch);
+
+    // Background preset I/O. A loaded patch is published to the audio thread by the worker;
+    // poll() reports finished jobs and applies window state on the GUI thread.
+    static void saveAsync(const std::string& filename, const Patch& patch);
+    static void loadAsync(const std::string& filename, const Patch& base);
+    // Load only the file's first voice into a multitimbral part of base; the rest of base is published unchanged
+    static void loadPartAsync(const std::string& filename, const Patch& base, int part);
+    // Other file work (e.g. building a preset bank), run in order with the preset jobs. work runs on the
+    // worker and sets the status message; done, if given, runs on the GUI thread from poll() with the result.
+    static void runAsync(std::function<bool(std::string& status)> work,
+                         std::function<void(bool ok, std::string& status)> done = nullptr);
+    static bool poll(std::string& statusMessage);
+    static void shutdown();
+};
@@ -0,0 +1,466 @@
+#include "PresetBank.h"
+#include "Patch.h"
+#include "Preset.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <SDL3/SDL.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char BANK_MAGIC[8] = {'S', 'Y', 'N', 'B', 'A', 'N', 'K', '\0'};
+static const uint32_t BANK_BYTE_ORDER = 0x01020304u;
+static_assert(BANK_PARTS == NUM_PARTS, "PatchRecord holds every part");
+static_assert(BANK_MAX_MAPPINGS >= (int)ParamId::Count, "PatchRecord holds a mapping for every parameter");
+
+static void voiceToRecord(const VoiceParams& src, BankVoiceRecord& dst) {
+    dst.attackTime = src.attackTime;
+    dst.decayTime = src.decayTime;
+    dst.sustainLevel = src.sustainLevel;
+    dst.releaseTime = src.releaseTime;
+    dst.mixLevel = src.mixLevel;
+    dst.unisonCount = src.unisonCount;
+    dst.unisonSpreadIndex = src.unisonSpreadIndex;
+    for (int i = 0; i < 3; ++i) {
+        dst.vcos[i].waveform = src.vcos[i].waveform;
+        dst.vcos[i].mix = src.vcos[i].mix;
+        dst.vcos[i].detune = src.vcos[i].detune;
+        dst.vcos[i].phaseMs = src.vcos[i].phaseMs;
+        dst.vcos[i].pulseWidth = src.vcos[i].pulseWidth;
+        dst.vcos[i].pitchShift = src.vcos[i].pitchShift;
+        dst.vcos[i].pan = src.vcos[i].pan;
+    }
+}
+
+static void voiceFromRecord(const BankVoiceRecord& src, VoiceParams& dst) {
+    dst.attackTime = src.attackTime;
+    dst.decayTime = src.decayTime;
+    dst.sustainLevel = src.sustainLevel;
+    dst.releaseTime = src.releaseTime;
+    dst.mixLevel = src.mixLevel;
+    dst.unisonCount = src.unisonCount;
+    dst.unisonSpreadIndex = src.unisonSpreadIndex;
+    for (int i = 0; i < 3; ++i) {
+        dst.vcos[i].waveform = src.vcos[i].waveform;
+        dst.vcos[i].mix = src.vcos[i].mix;
+        dst.vcos[i].detune = src.vcos[i].detune;
+        dst.vcos[i].phaseMs = src.vcos[i].phaseMs;
+        dst.vcos[i].pulseWidth = src.vcos[i].pulseWidth;
+        dst.vcos[i].pitchShift = src.vcos[i].pitchShift;
+        dst.vcos[i].pan = src.vcos[i].pan;
+    }
+}
+
+void PatchRecord::fromPatch(const Patch& patch) {
+    std::memset(this, 0, sizeof(*this));
+    masterVolume = patch.masterVolume;
+    pan = patch.pan;
+    unisonCount = patch.unisonCount;
+    unisonSpreadIndex = patch.unisonSpreadIndex;
+    pitchBend = patch.pitchBend;
+    pitchBendRange = patch.pitchBendRange;
+    modWheelValue = patch.modWheelValue;
+    modLfoPhase = patch.modLfoPhase;
+    modLfoRate = patch.modLfoRate;
+
+    arpEnabled = patch.arpEnabled;
+    arpBpm = patch.arpBpm;
+    arpGate = patch.arpGate;
+    arpDirection = patch.arpDirection;
+    arpRange = patch.arpRange;
+    arpHold = patch.arpHold;
+    arpSwing = patch.arpSwing;
+    arpRatchet = patch.arpRatchet;
+
+    voiceToRecord(patch.voice, voice);
+
+    flangerEnabled = patch.flangerEnabled;
+    flangerRate = patch.flangerRate;
+    flangerDepth = patch.flangerDepth;
+    flangerMix = patch.flangerMix;
+    delayEnabled = patch.delayEnabled;
+    delayTimeSec = patch.delayTimeSec;
+    delayFeedback = patch.delayFeedback;
+    delayMix = patch.delayMix;
+    reverbEnabled = patch.reverbEnabled;
+    reverbSize = patch.reverbSize;
+    reverbDamp = patch.reverbDamp;
+    reverbDelay = patch.reverbDelay;
+    reverbDiffuse = patch.reverbDiffuse;
+    reverbStereo = patch.reverbStereo;
+    reverbDryMix = patch.reverbDryMix;
+    reverbWetMix = patch.reverbWetMix;
+    compressorEnabled = patch.compressorEnabled;
+    compressorThresholdDb = patch.compressorThresholdDb;
+    compressorRatio = patch.compressorRatio;
+    compressorAttackMs = patch.compressorAttackMs;
+    compressorReleaseMs = patch.compressorReleaseMs;
+    compressorMakeupDb = patch.compressorMakeupDb;
+    dcFilterEnabled = patch.dcFilterEnabled;
+    dcFilterAlpha = patch.dcFilterAlpha;
+    softClipEnabled = patch.softClipEnabled;
+    softClipDrive = patch.softClipDrive;
+    autoGainEnabled = patch.autoGainEnabled;
+    autoGainTargetRMS = patch.autoGainTargetRMS;
+    autoGainAlpha = patch.autoGainAlpha;
+
+    filterEnabled = patch.filterEnabled;
+    filterCutoff = patch.filterCutoff;
+    filterResonance = patch.filterResonance;
+    filterDrive = patch.filterDrive;
+    filterInertial = patch.filterInertial;
+    filterOversampling = patch.filterOversampling;
+
+    hasWindow = patch.hasWindow;
+    windowX = patch.windowX;
+    windowY = patch.windowY;
+    windowW = patch.windowW;
+    windowH = patch.windowH;
+    windowFullscreen = patch.windowFullscreen;
+
+    multitimbral = patch.multitimbral;
+    for (int p = 0; p < BANK_PARTS; ++p) {
+        const Part& src = patch.parts[p];
+        BankPartRecord& dst = parts[p];
+        voiceToRecord(src.voice, dst.voice);
+        dst.maxVoices = src.maxVoices;
+        dst.volume = src.volume;
+        dst.pan = src.pan;
+        dst.fxSend = src.fxSend;
+        dst.muted = src.muted;
+    }
+
+    mappingCount = std::min(patch.midiMap.size(), BANK_MAX_MAPPINGS);
+    for (int i = 0; i < mappingCount; ++i) {
+        const MidiMapping& src = patch.midiMap[i];
+        BankMappingRecord& dst = mappings[i];
+        std::strncpy(dst.param, paramInfo(src.param).key, sizeof(dst.param) - 1);
+        dst.source = (int32_t)src.source;
+        dst.channel = src.channel;
+        dst.number = src.number;
+        dst.curve = (int32_t)src.curve;
+        dst.minValue = src.minValue;
+        dst.maxValue = src.maxValue;
+    }
+}
+
+void PatchRecord::toPatch(Patch& patch) const {
+    patch.masterVolume = masterVolume;
+    patch.pan = pan;
+    patch.unisonCount = unisonCount;
+    patch.unisonSpreadIndex = unisonSpreadIndex;
+    patch.pitchBend = pitchBend;
+    patch.pitchBendRange = pitchBendRange;
+    patch.modWheelValue = modWheelValue;
+    patch.modLfoPhase = modLfoPhase;
+    patch.modLfoRate = modLfoRate;
+
+    patch.arpEnabled = arpEnabled != 0;
+    patch.arpBpm = arpBpm;
+    patch.arpGate = arpGate;
+    patch.arpDirection = arpDirection;
+    patch.arpRange = arpRange;
+    patch.arpHold = arpHold != 0;
+    patch.arpSwing = arpSwing;
+    patch.arpRatchet = std::max(1, (int)arpRatchet);
+
+    voiceFromRecord(voice, patch.voice);
+
+    patch.flangerEnabled = flangerEnabled != 0;
+    patch.flangerRate = flangerRate;
+    patch.flangerDepth = flangerDepth;
+    patch.flangerMix = flangerMix;
+    patch.delayEnabled = delayEnabled != 0;
+    patch.delayTimeSec = delayTimeSec;
+    patch.delayFeedback = delayFeedback;
+    patch.delayMix = delayMix;
+    patch.reverbEnabled = reverbEnabled != 0;
+    patch.reverbSize = reverbSize;
+    patch.reverbDamp = reverbDamp;
+    patch.reverbDelay = reverbDelay;
+    patch.reverbDiffuse = reverbDiffuse;
+    patch.reverbStereo = reverbStereo;
+    patch.reverbDryMix = reverbDryMix;
+    patch.reverbWetMix = reverbWetMix;
+    patch.compressorEnabled = compressorEnabled != 0;
+    patch.compressorThresholdDb = compressorThresholdDb;
+    patch.compressorRatio = compressorRatio;
+    patch.compressorAttackMs = compressorAttackMs;
+    patch.compressorReleaseMs = compressorReleaseMs;
+    patch.compressorMakeupDb = compressorMakeupDb;
+    patch.dcFilterEnabled = dcFilterEnabled != 0;
+    patch.dcFilterAlpha = dcFilterAlpha;
+    patch.softClipEnabled = softClipEnabled != 0;
+    patch.softClipDrive = softClipDrive;
+    patch.autoGainEnabled = autoGainEnabled != 0;
+    patch.autoGainTargetRMS = autoGainTargetRMS;
+    patch.autoGainAlpha = autoGainAlpha;
+
+    patch.filterEnabled = filterEnabled != 0;
+    patch.filterCutoff = filterCutoff;
+    patch.filterResonance = filterResonance;
+    patch.filterDrive = filterDrive;
+    patch.filterInertial = filterInertial;
+    patch.filterOversampling = filterOversampling;
+
+    patch.hasWindow = hasWindow != 0;
+    patch.windowX = windowX;
+    patch.windowY = windowY;
+    patch.windowW = windowW;
+    patch.windowH = windowH;
+    patch.windowFullscreen = windowFullscreen != 0;
+
+    patch.multitimbral = multitimbral != 0;
+    if (multitimbral) {
+        for (int p = 0; p < BANK_PARTS; ++p) {
+            const BankPartRecord& src = parts[p];
+            Part& dst = patch.parts[p];
+            voiceFromRecord(src.voice, dst.voice);
+            dst.maxVoices = src.maxVoices;
+            dst.volume = src.volume;
+            dst.pan = src.pan;
+            dst.fxSend = src.fxSend;
+            dst.muted = src.muted != 0;
+        }
+    }
+
+    if (mappingCount > 0) {
+        patch.midiMap.clear();
+        for (int i = 0; i < std::min((int)mappingCount, BANK_MAX_MAPPINGS); ++i) {
+            const BankMappingRecord& src = mappings[i];
+            MidiMapping dst;
+            std::string key(src.param, std::find(src.param, src.param + sizeof(src.param), '\0'));
+            dst.param = paramFromKey(key.c_str());
+            if (dst.param == ParamId::None) continue; // a parameter this build does not have
+            dst.source = (MidiSource)std::clamp((int)src.source, 0, 2);
+            dst.channel = (uint8_t)std::clamp((int)src.channel, 0, 15);
+            dst.number = (uint16_t)std::clamp((int)src.number, 0, dst.source == MidiSource::NRPN ? 16383 : 127);
+            dst.curve = (MidiCurve)std::clamp((int)src.curve, 0, 2);
+            dst.minValue = src.minValue;
+            dst.maxValue = src.maxValue;
+            patch.midiMap.set(dst);
+        }
+    }
+}
+
+PresetBank::~PresetBank() {
+    close();
+}
+
+bool PresetBank::open(const std::string& filename) {
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(BankHeader)) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    base = static_cast<const uint8_t*>(view);
+    mappedSize = (size_t)fileSize.QuadPart;
+#elif defined(__EMSCRIPTEN__)
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+    fallback.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (fallback.size() < sizeof(BankHeader)) {
+        fallback.clear();
+        return false;
+    }
+    base = fallback.data();
+    mappedSize = fallback.size();
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BankHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (view == MAP_FAILED) return false;
+    base = static_cast<const uint8_t*>(view);
+    mappedSize = (size_t)st.st_size;
+#endif
+
+    header = reinterpret_cast<const BankHeader*>(base);
+    uint64_t count = header->patchCount;
+    bool valid = std::memcmp(header->magic, BANK_MAGIC, sizeof(BANK_MAGIC)) == 0
+        && header->version == BANK_VERSION
+        && header->byteOrder == BANK_BYTE_ORDER
+        && header->headerSize == sizeof(BankHeader)
+        && header->recordSize == sizeof(PatchRecord)
+        && header->indexOffset + count * sizeof(BankIndexEntry) <= mappedSize
+        && header->recordsOffset % alignof(PatchRecord) == 0
+        && header->recordsOffset + count * sizeof(PatchRecord) <= mappedSize
+        && header->stringsOffset + header->stringsSize <= mappedSize;
+    if (!valid) {
+        SDL_Log("Not a valid preset bank (version %u): %s", BANK_VERSION, filename.c_str());
+        close();
+        return false;
+    }
+    index = reinterpret_cast<const BankIndexEntry*>(base + header->indexOffset);
+    records = reinterpret_cast<const PatchRecord*>(base + header->recordsOffset);
+    strings = reinterpret_cast<const char*>(base + header->stringsOffset);
+    return true;
+}
+
+void PresetBank::close() {
+#if defined(_WIN32)
+    if (base) UnmapViewOfFile(base);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#elif !defined(__EMSCRIPTEN__)
+    if (base) munmap(const_cast<uint8_t*>(base), mappedSize);
+#endif
+    fallback.clear();
+    base = nullptr;
+    mappedSize = 0;
+    header = nullptr;
+    index = nullptr;
+    records = nullptr;
+    strings = nullptr;
+}
+
+std::string_view PresetBank::name(int i) const {
+    const BankIndexEntry& e = index[i];
+    if ((uint64_t)e.nameOffset + e.nameLength > header->stringsSize) return {};
+    return std::string_view(strings + e.nameOffset, e.nameLength);
+}
+
+std::string_view PresetBank::tags(int i) const {
+    const BankIndexEntry& e = index[i];
+    if ((uint64_t)e.tagsOffset + e.tagsLength > header->stringsSize) return {};
+    return std::string_view(strings + e.tagsOffset, e.tagsLength);
+}
+
+int PresetBank::find(std::string_view patchName) const {
+    int lo = 0, hi = size() - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = name(mid).compare(patchName);
+        if (cmp == 0) return mid;
+        if (cmp < 0) lo = mid + 1; else hi = mid - 1;
+    }
+    return -1;
+}
+
+bool PresetBank::get(int i, Patch& patch) const {
+    if (!isOpen() || i < 0 || i >= size()) return false;
+    record(i)->toPatch(patch);
+    patch.name = std::string(name(i));
+    patch.tags.clear();
+    std::string_view t = tags(i);
+    while (!t.empty()) {
+        size_t comma = t.find(',');
+        std::string_view tag = t.substr(0, comma);
+        if (!tag.empty()) patch.tags.emplace_back(tag);
+        if (comma == std::string_view::npos) break;
+        t.remove_prefix(comma + 1);
+    }
+    return true;
+}
+
+bool PresetBank::write(const std::string& filename, std::vector<Patch> patches) {
+    std::stable_sort(patches.begin(), patches.end(), [](const Patch& a, const Patch& b) { return a.name < b.name; });
+
+    std::vector<BankIndexEntry> entries(patches.size());
+    std::vector<PatchRecord> recs(patches.size());
+    std::string table;
+    for (size_t i = 0; i < patches.size(); ++i) {
+        std::string joinedTags;
+        for (const std::string& tag : patches[i].tags) {
+            if (!joinedTags.empty()) joinedTags += ',';
+            joinedTags += tag;
+        }
+        entries[i].nameOffset = (uint32_t)table.size();
+        entries[i].nameLength = (uint32_t)patches[i].name.size();
+        table += patches[i].name;
+        entries[i].tagsOffset = (uint32_t)table.size();
+        entries[i].tagsLength = (uint32_t)joinedTags.size();
+        table += joinedTags;
+        recs[i].fromPatch(patches[i]);
+    }
+
+    BankHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BANK_MAGIC, sizeof(BANK_MAGIC));
+    header.version = BANK_VERSION;
+    header.headerSize = sizeof(BankHeader);
+    header.patchCount = (uint32_t)patches.size();
+    header.recordSize = sizeof(PatchRecord);
+    header.byteOrder = BANK_BYTE_ORDER;
+    header.indexOffset = sizeof(BankHeader);
+    uint64_t indexEnd = header.indexOffset + entries.size() * sizeof(BankIndexEntry);
+    header.recordsOffset = (indexEnd + 63) & ~uint64_t(63); // cache-line aligned records
+    header.stringsOffset = header.recordsOffset + recs.size() * sizeof(PatchRecord);
+    header.stringsSize = table.size();
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        SDL_Log("Failed to open preset bank for writing: %s", filename.c_str());
+        return false;
+    }
+    static const char zeros[64] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BankIndexEntry));
+    file.write(zeros, header.recordsOffset - indexEnd);
+    file.write(reinterpret_cast<const char*>(recs.data()), recs.size() * sizeof(PatchRecord));
+    file.write(table.data(), table.size());
+    if (!file.good()) {
+        SDL_Log("Failed to write preset bank: %s", filename.c_str());
+        return false;
+    }
+    SDL_Log("Preset bank with %zu patches written to: %s", patches.size(), filename.c_str());
+    return true;
+}
+
+bool PresetBank::importJson(const std::vector<std::string>& jsonFiles, const std::string& bankFile) {
+    std::vector<Patch> patches;
+    patches.reserve(jsonFiles.size());
+    for (const std::string& path : jsonFiles) {
+        Patch patch;
+        if (!Preset::read(path, patch)) continue;
+        if (patch.name.empty()) patch.name = std::filesystem::path(path).stem().string();
+        patches.push_back(std::move(patch));
+    }
+    return write(bankFile, std::move(patches));
+}
+
+int PresetBank::exportJson(const std::string& bankFile, const std::string& directory) {
+    PresetBank bank;
+    if (!bank.open(bankFile)) return -1;
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    int written = 0;
+    for (int i = 0; i < bank.size(); ++i) {
+        Patch patch;
+        bank.get(i, patch);
+        std::string stem = patch.name.empty() ? "patch_" + std::to_string(i) : patch.name;
+        std::replace_if(stem.begin(), stem.end(), [](char c) { return c == '/' || c == '\\' || c == ':'; }, '_');
+        if (Preset::write((std::filesystem::path(directory) / (stem + ".json")).string(), patch)) ++written;
+    }
+    return written;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Patch;
+
+// Binary preset bank (*.synbank), version 3. All integers and floats are stored little-endian.
+//
+//   BankHeader
+//   BankIndexEntry[patchCount]   sorted by name, same order as the records
+//   PatchRecord[patchCount]      fixed layout, directly usable from the mapping
+//   string table                 UTF-8 names and comma-separated tags, not NUL-terminated
+//
+// Opening a bank maps the file and validates the header only, so it costs the same for ten
+// patches as for ten thousand; record(i) is a single pointer offset into the mapping.
+
+const uint32_t BANK_VERSION = 3; // 2: multitimbral parts, 3: controller mappings
+const int BANK_PARTS = 16;
+const int BANK_MAX_MAPPINGS = 32; // at least one per parameter
+
+struct BankHeader {
+    char magic[8];          // "SYNBANK\0"
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t patchCount;
+    uint32_t recordSize;
+    uint64_t indexOffset;
+    uint64_t recordsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint32_t byteOrder;     // 0x01020304 as written by the host
+    uint32_t reserved[3];
+};
+static_assert(sizeof(BankHeader) == 72, "BankHeader layout changed");
+
+struct BankIndexEntry {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t tagsOffset;
+    uint32_t tagsLength;
+};
+static_assert(sizeof(BankIndexEntry) == 16, "BankIndexEntry layout changed");
+
+struct BankVcoRecord {
+    int32_t waveform;
+    float mix, detune, phaseMs, pulseWidth, pitchShift, pan;
+};
+
+struct BankVoiceRecord {
+    float attackTime, decayTime, sustainLevel, releaseTime, mixLevel;
+    int32_t unisonCount, unisonSpreadIndex;
+    BankVcoRecord vcos[3];
+};
+
+struct BankPartRecord {
+    BankVoiceRecord voice;
+    int32_t maxVoices;
+    float volume, pan, fxSend;
+    int32_t muted;
+};
+
+// A MIDI-learn assignment. The parameter is stored by its preset key, as in JSON presets, so the
+// record does not depend on the order of ParamId.
+struct BankMappingRecord {
+    char param[24];     // NUL-padded
+    int32_t source, channel, number, curve;
+    float minValue, maxValue;
+};
+
+// Every field of the JSON preset schema, booleans widened to int32 so the record has no padding
+struct PatchRecord {
+    float masterVolume, pan;
+    int32_t unisonCount, unisonSpreadIndex;
+    float pitchBend, pitchBendRange, modWheelValue, modLfoPhase, modLfoRate;
+
+    int32_t arpEnabled;
+    float arpBpm, arpGate;
+    int32_t arpDirection, arpRange, arpHold;
+
+    BankVoiceRecord voice;
+
+    int32_t flangerEnabled;
+    float flangerRate, flangerDepth, flangerMix;
+    int32_t delayEnabled;
+    float delayTimeSec, delayFeedback, delayMix;
+    int32_t reverbEnabled;
+    float reverbSize, reverbDamp, reverbDelay, reverbDiffuse, reverbStereo, reverbDryMix, reverbWetMix;
+    int32_t compressorEnabled;
+    float compressorThresholdDb, compressorRatio, compressorAttackMs, compressorReleaseMs, compressorMakeupDb;
+    int32_t dcFilterEnabled;
+    float dcFilterAlpha;
+    int32_t softClipEnabled;
+    float softClipDrive;
+    int32_t autoGainEnabled;
+    float autoGainTargetRMS, autoGainAlpha;
+
+    int32_t filterEnabled;
+    float filterCutoff, filterResonance, filterDrive, filterInertial;
+    int32_t filterOversampling;
+
+    int32_t hasWindow, windowX, windowY, windowW, windowH, windowFullscreen;
+
+    float arpSwing;
+    int32_t arpRatchet; // 0 in banks written before ratchets, read as 1
+
+    // Like the JSON schema, the parts only count when the mode is on; with it off, loading the record
+    // switches the mode off and leaves the current parts alone
+    int32_t multitimbral;
+    BankPartRecord parts[BANK_PARTS];
+
+    // Replace the current assignments if there are any, again as in the JSON schema
+    int32_t mappingCount;
+    BankMappingRecord mappings[BANK_MAX_MAPPINGS];
+
+    int32_t reserved[24];
+
+    void fromPatch(const Patch& patch);
+    void toPatch(Patch& patch) const;
+};
+static_assert(sizeof(PatchRecord) == 4096, "PatchRecord layout changed, bump BANK_VERSION");
+
+class PresetBank {
+public:
+    PresetBank() = default;
+    PresetBank(const PresetBank&) = delete;
+    PresetBank& operator=(const PresetBank&) = delete;
+    ~PresetBank();
+
+    // Map a bank file read-only. Only the header is validated.
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    int size() const { return header ? (int)header->patchCount : 0; }
+    const PatchRecord* record(int i) const { return records + i; }
+    std::string_view name(int i) const;
+    std::string_view tags(int i) const;
+    int find(std::string_view patchName) const; // binary search on the sorted index, -1 if missing
+
+    // Full Patch (including name and tags) for slot i
+    bool get(int i, Patch& patch) const;
+
+    // Write a bank; patches are sorted by name
+    static bool write(const std::string& filename, std::vector<Patch> patches);
+    // Build a bank from JSON presets; patches without a "Name" are named after the file
+    static bool importJson(const std::vector<std::string>& jsonFiles, const std::string& bankFile);
+    // Write every patch of a bank as <directory>/<name>.json
+    static int exportJson(const std::string& bankFile, const std::string& directory);
+
+private:
+    const uint8_t* base = nullptr;
+    size_t mappedSize = 0;
+    const BankHeader* header = nullptr;
+    const BankIndexEntry* index = nullptr;
+    const PatchRecord* records = nullptr;
+    const char* strings = nullptr;
+    std::vector<uint8_t> fallback; // file contents where mmap is unavailable
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
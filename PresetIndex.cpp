@@ -0,0 +1,319 @@
+#include "PresetIndex.h"
+#include "Patch.h"
+#include "Preset.h"
+#include "PresetBank.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <SDL3/SDL.h>
+#include <cJSON.h>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#define PRESET_INDEX_INOTIFY 1
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int CACHE_VERSION = 1;
+const int POLL_INTERVAL_MS = 250;
+const int RESCAN_INTERVAL_MS = 2000; // fallback when there is no change notification
+
+bool isPresetFile(const std::filesystem::path& path) {
+    return path.extension() == ".json";
+}
+
+uint64_t hashParameters(const Patch& patch) {
+    PatchRecord record;
+    record.fromPatch(patch);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < sizeof(record); ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string lower(const std::string& s) {
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return out;
+}
+
+// 3 = prefix, 2 = substring, 1 = subsequence, 0 = no match. Both arguments are lowercase.
+int matchScore(const std::string& text, const std::string& query) {
+    size_t pos = text.find(query);
+    if (pos == 0) return 3;
+    if (pos != std::string::npos) return 2;
+    size_t q = 0;
+    for (size_t i = 0; i < text.size() && q < query.size(); ++i) {
+        if (text[i] == query[q]) ++q;
+    }
+    return q == query.size() ? 1 : 0;
+}
+
+} // namespace
+
+PresetIndex::~PresetIndex() {
+    stop();
+}
+
+void PresetIndex::start(const std::string& dir, const std::string& cache) {
+    stop();
+    directory = dir;
+    cacheFile = cache;
+    shouldExit = false;
+    worker = std::thread(&PresetIndex::run, this);
+}
+
+void PresetIndex::stop() {
+    if (!worker.joinable()) return;
+    shouldExit = true;
+    worker.join();
+}
+
+void PresetIndex::requestRescan() {
+    rescanRequested = true;
+}
+
+std::vector<PresetIndexEntry> PresetIndex::search(const std::string& query, size_t maxResults) const {
+    std::string q = lower(query);
+    std::vector<std::pair<int, PresetIndexEntry>> matches;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [path, entry] : entries) {
+            int score = 3;
+            if (!q.empty()) {
+                score = std::max(matchScore(lower(entry.name), q), matchScore(lower(entry.path), q));
+                for (const std::string& tag : entry.tags) score = std::max(score, matchScore(lower(tag), q));
+            }
+            if (score > 0) matches.emplace_back(score, entry);
+        }
+    }
+    std::stable_sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) {
+        if (a.first != b.first) return a.first > b.first;
+        return a.second.name < b.second.name;
+    });
+    std::vector<PresetIndexEntry> result;
+    size_t count = maxResults ? std::min(maxResults, matches.size()) : matches.size();
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) result.push_back(std::move(matches[i].second));
+    return result;
+}
+
+std::vector<std::string> PresetIndex::paths() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> result;
+    result.reserve(entries.size());
+    for (const auto& [path, entry] : entries) result.push_back(path);
+    return result;
+}
+
+void PresetIndex::run() {
+    loadCache();
+    if (rescan()) saveCache();
+
+#ifdef PRESET_INDEX_INOTIFY
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0 && inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+        SDL_Log("inotify unavailable for %s, falling back to periodic rescans", directory.c_str());
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+
+    auto lastRescan = std::chrono::steady_clock::now();
+    while (!shouldExit) {
+        bool changed = false;
+#ifdef PRESET_INDEX_INOTIFY
+        if (fd >= 0) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (::poll(&pfd, 1, POLL_INTERVAL_MS) > 0) {
+                alignas(inotify_event) char buffer[4096];
+                ssize_t len;
+                while ((len = ::read(fd, buffer, sizeof(buffer))) > 0) {
+                    for (char* p = buffer; p < buffer + len; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len) {
+                        const inotify_event* ev = reinterpret_cast<const inotify_event*>(p);
+                        if (ev->mask & IN_Q_OVERFLOW) {
+                            rescanRequested = true;
+                            continue;
+                        }
+                        if (ev->len == 0 || !isPresetFile(ev->name)) continue;
+                        if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) changed |= removeFile(ev->name);
+                        else changed |= updateFile(ev->name);
+                    }
+                }
+            }
+        } else
+#endif
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastRescan >= std::chrono::milliseconds(RESCAN_INTERVAL_MS)) {
+                rescanRequested = true;
+            }
+        }
+
+        if (rescanRequested.exchange(false)) {
+            changed |= rescan();
+            lastRescan = std::chrono::steady_clock::now();
+        }
+        // Write the cache once a burst of changes has settled
+        if (!changed && dirty) saveCache();
+    }
+
+#ifdef PRESET_INDEX_INOTIFY
+    if (fd >= 0) ::close(fd);
+#endif
+    if (dirty) saveCache();
+}
+
+bool PresetIndex::rescan() {
+    std::error_code ec;
+    std::set<std::string> seen;
+    bool changed = false;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (shouldExit) return changed;
+        if (!isPresetFile(it->path())) continue;
+        std::string filename = it->path().filename().string();
+        seen.insert(filename);
+        changed |= updateFile(filename);
+    }
+    std::vector<std::string> missing;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [path, entry] : entries) {
+            if (!seen.count(path)) missing.push_back(path);
+        }
+    }
+    for (const std::string& path : missing) changed |= removeFile(path);
+    return changed;
+}
+
+// Re-read one preset if its size or mtime differs from the index; returns true if the entry changed
+bool PresetIndex::updateFile(const std::string& filename) {
+    std::filesystem::path path = std::filesystem::path(directory) / filename;
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(path, ec);
+    if (ec) return removeFile(filename);
+    int64_t mtime = (int64_t)std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+    if (ec) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(filename);
+        if (it != entries.end() && it->second.mtime == mtime && it->second.size == size) return false;
+    }
+
+    Patch patch;
+    if (!Preset::read(path.string(), patch)) return removeFile(filename);
+    PresetIndexEntry entry;
+    entry.path = filename;
+    entry.mtime = mtime;
+    entry.size = size;
+    entry.name = patch.name.empty() ? path.stem().string() : patch.name;
+    entry.tags = std::move(patch.tags);
+    entry.paramHash = hashParameters(patch);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[filename] = std::move(entry);
+    }
+    gen.fetch_add(1, std::memory_order_release);
+    dirty = true;
+    return true;
+}
+
+bool PresetIndex::removeFile(const std::string& filename) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (entries.erase(filename) == 0) return false;
+    }
+    gen.fetch_add(1, std::memory_order_release);
+    dirty = true;
+    return true;
+}
+
+void PresetIndex::loadCache() {
+    FILE* file = fopen(cacheFile.c_str(), "rb");
+    if (!file) return;
+    std::string text;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) text.append(chunk, n);
+    fclose(file);
+
+    cJSON* root = cJSON_Parse(text.c_str());
+    if (!root) return;
+    cJSON* version = cJSON_GetObjectItem(root, "Version");
+    cJSON* list = cJSON_GetObjectItem(root, "Entries");
+    if (version && version->valueint == CACHE_VERSION && list && cJSON_IsArray(list)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cJSON* item = nullptr;
+        cJSON_ArrayForEach(item, list) {
+            cJSON* path = cJSON_GetObjectItem(item, "Path");
+            cJSON* mtime = cJSON_GetObjectItem(item, "MTime");
+            cJSON* size = cJSON_GetObjectItem(item, "Size");
+            cJSON* name = cJSON_GetObjectItem(item, "Name");
+            cJSON* hash = cJSON_GetObjectItem(item, "Hash");
+            if (!cJSON_IsString(path) || !cJSON_IsString(mtime) || !cJSON_IsString(size)) continue;
+            PresetIndexEntry entry;
+            entry.path = path->valuestring;
+            // 64-bit values are stored as strings, cJSON numbers are doubles
+            entry.mtime = strtoll(mtime->valuestring, nullptr, 10);
+            entry.size = strtoull(size->valuestring, nullptr, 10);
+            if (cJSON_IsString(name)) entry.name = name->valuestring;
+            if (cJSON_IsString(hash)) entry.paramHash = strtoull(hash->valuestring, nullptr, 16);
+            cJSON* tags = cJSON_GetObjectItem(item, "Tags");
+            cJSON* tag = nullptr;
+            cJSON_ArrayForEach(tag, tags) {
+                if (cJSON_IsString(tag)) entry.tags.push_back(tag->valuestring);
+            }
+            entries[entry.path] = std::move(entry);
+        }
+    }
+    cJSON_Delete(root);
+    gen.fetch_add(1, std::memory_order_release);
+}
+
+void PresetIndex::saveCache() {
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "Version", CACHE_VERSION);
+    cJSON* list = cJSON_AddArrayToObject(root, "Entries");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        char buf[32];
+        for (const auto& [path, entry] : entries) {
+            cJSON* item = cJSON_CreateObject();
+            cJSON_AddStringToObject(item, "Path", entry.path.c_str());
+            cJSON_AddStringToObject(item, "MTime", std::to_string(entry.mtime).c_str());
+            cJSON_AddStringToObject(item, "Size", std::to_string(entry.size).c_str());
+            cJSON_AddStringToObject(item, "Name", entry.name.c_str());
+            snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)entry.paramHash);
+            cJSON_AddStringToObject(item, "Hash", buf);
+            cJSON* tags = cJSON_AddArrayToObject(item, "Tags");
+            for (const std::string& tag : entry.tags) cJSON_AddItemToArray(tags, cJSON_CreateString(tag.c_str()));
+            cJSON_AddItemToArray(list, item);
+        }
+    }
+    char* text = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!text) return;
+
+    // Write to a temporary file and rename, so a crash never leaves a truncated cache
+    std::string tmp = cacheFile + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (file) {
+        bool ok = fputs(text, file) >= 0;
+        ok = fclose(file) == 0 && ok;
+        std::error_code ec;
+        if (ok) std::filesystem::rename(tmp, cacheFile, ec);
+        if (ok && !ec) dirty = false;
+    }
+    cJSON_free(text);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One preset file as seen by the index
+struct PresetIndexEntry {
+    std::string path;           // file name relative to the indexed directory
+    int64_t mtime = 0;          // last write time, filesystem clock ticks
+    uint64_t size = 0;
+    std::string name;           // "Name" key, or the file stem
+    std::vector<std::string> tags;
+    uint64_t paramHash = 0;     // FNV-1a over the parameter record, equal for identical sounds
+};
+
+// Persistent index of the *.json presets in one directory.
+// All filesystem access happens on a worker thread: the cached index is loaded from disk, only files
+// whose mtime or size changed are parsed again, and afterwards the index follows inotify events
+// (Linux) or a periodic stat-only rescan (elsewhere). The GUI only ever copies entries under a mutex.
+class PresetIndex {
+public:
+    PresetIndex() = default;
+    PresetIndex(const PresetIndex&) = delete;
+    PresetIndex& operator=(const PresetIndex&) = delete;
+    ~PresetIndex();
+
+    void start(const std::string& directory, const std::string& cacheFile);
+    void stop();
+
+    // Ask the worker to stat the whole directory again (e.g. after an external bulk change)
+    void requestRescan();
+
+    // Incremented whenever the set of entries changes
+    uint64_t generation() const { return gen.load(std::memory_order_acquire); }
+
+    // Case-insensitive search over name, file name and tags. Prefix matches rank first, then
+    // substring matches, then fuzzy (in-order subsequence) matches. An empty query returns everything.
+    std::vector<PresetIndexEntry> search(const std::string& query, size_t maxResults = 0) const;
+    std::vector<std::string> paths() const;
+
+private:
+    void run();
+    bool rescan();
+    bool updateFile(const std::string& filename);
+    bool removeFile(const std::string& filename);
+    void loadCache();
+    void saveCache();
+
+    std::string directory;
+    std::string cacheFile;
+    mutable std::mutex mutex;
+    std::map<std::string, PresetIndexEntry> entries;
+    std::atomic<uint64_t> gen{0};
+    std::atomic<bool> shouldExit{false};
+    std::atomic<bool> rescanRequested{false};
+    std::thread worker;
+    bool dirty = false; // cache file out of date (worker only)
+};
@@ -0,0 +1,108 @@
+#include "Recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+const int WRITER_SLEEP_MS = 100;
+
+std::string stemFilename(const std::string& filename) {
+    size_t dot = filename.find_last_of('.');
+    size_t slash = filename.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return filename + ".stems.wav";
+    return filename.substr(0, dot) + ".stems" + filename.substr(dot);
+}
+
+} // namespace
+
+bool Recorder::start(const std::string& filename, int sampleRate, int stems, std::string& error) {
+    if (active.load(std::memory_order_relaxed) || busy()) {
+        error = "A recording is still being written";
+        return false;
+    }
+    numStems = std::clamp(stems, 0, MAX_STEMS);
+    if (!masterFile.open(filename, sampleRate, 2)) {
+        error = "Cannot write " + filename;
+        return false;
+    }
+    if (numStems > 0 && !stemFile.open(stemFilename(filename), sampleRate, numStems)) {
+        masterFile.close();
+        error = "Cannot write " + stemFilename(filename);
+        return false;
+    }
+
+    // Everything the audio thread touches is allocated here, before capture is armed
+    size_t ringFrames = (size_t)sampleRate * RING_SECONDS;
+    masterRing.allocate(ringFrames * 2);
+    stemRing.allocate(numStems > 0 ? ringFrames * numStems : 0);
+    stemBlock.assign(numStems > 0 ? (size_t)STEM_BLOCK_FRAMES * numStems : 0, 0);
+
+    rate = sampleRate;
+    summary = filename;
+    writeFailed = false;
+    framesCaptured.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    stopRequested.store(false, std::memory_order_relaxed);
+    finished.store(false, std::memory_order_relaxed);
+    writer = std::thread(&Recorder::writerLoop, this);
+    active.store(true, std::memory_order_release);
+    return true;
+}
+
+void Recorder::stop() {
+    if (!active.load(std::memory_order_relaxed)) return;
+    active.store(false, std::memory_order_relaxed);
+    stopRequested.store(true, std::memory_order_release);
+}
+
+bool Recorder::poll(std::string& message) {
+    if (!writer.joinable() || !finished.load(std::memory_order_acquire)) return false;
+    writer.join();
+    char text[256];
+    snprintf(text, sizeof(text), "%s: %s, %.1f s, %llu frames lost to overruns", writeFailed ? "Recording failed" : "Recorded",
+             summary.c_str(), (double)masterFile.framesWritten() / std::max(1, rate), (unsigned long long)overrunFrames());
+    message = text;
+    return true;
+}
+
+void Recorder::shutdown() {
+    stop();
+    if (writer.joinable()) writer.join();
+}
+
+void Recorder::capture(const int16_t* master, int numFrames) {
+    if (!blockActive) return;
+    framesCaptured.fetch_add(numFrames, std::memory_order_relaxed);
+    bool ok = masterRing.write(master, (size_t)numFrames * 2);
+    if (numStems > 0) {
+        int stemFrames = std::min(numFrames, STEM_BLOCK_FRAMES);
+        ok = stemRing.write(stemBlock.data(), (size_t)stemFrames * numStems) && ok;
+    }
+    if (!ok) overruns.fetch_add(numFrames, std::memory_order_relaxed);
+}
+
+size_t Recorder::drain(SpscBulkRing<int16_t>& ring, WavWriter& file, int channels) {
+    const int16_t* data = nullptr;
+    size_t n = ring.peek(data);
+    if (n == 0) return 0;
+    if (!file.write(data, n / channels)) writeFailed = true;
+    ring.consume(n);
+    return n;
+}
+
+void Recorder::writerLoop() {
+    for (;;) {
+        // Read the flag before draining, so the last blocks queued before stop() are still written
+        bool stopping = stopRequested.load(std::memory_order_acquire);
+        size_t moved = drain(masterRing, masterFile, 2);
+        if (numStems > 0) moved += drain(stemRing, stemFile, numStems);
+        if (moved == 0) {
+            if (stopping) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_SLEEP_MS));
+        }
+    }
+    if (!masterFile.close()) writeFailed = true;
+    if (!stemFile.close()) writeFailed = true;
+    finished.store(true, std::memory_order_release);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "LockFree.h"
+#include "WavWriter.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records the master bus, and optionally one mono stem per voice, to WAV files.
+// The audio thread only copies each block into preallocated rings; a writer thread drains them to
+// disk in large sequential writes. When the disk falls behind, blocks that do not fit are dropped and
+// counted as overruns instead of stalling the audio thread. Memory stays fixed however long the
+// recording runs, and files past 4 GB are finished as RF64.
+class Recorder {
+public:
+    static constexpr int MAX_STEMS = 32;
+    static constexpr int RING_SECONDS = 10;
+    static constexpr int STEM_BLOCK_FRAMES = 16384; // longest audio block the stems can take
+
+    ~Recorder() { shutdown(); }
+
+    // Allocates the rings, opens the files and starts the writer thread, then arms capture().
+    // Needs no lock. With numStems > 0, <name>.stems.wav gets one channel per voice.
+    bool start(const std::string& filename, int sampleRate, int numStems, std::string& error);
+    // Call with g_synthMutex held (or with the audio thread stopped) so no capture() is in flight.
+    // Returns at once; the writer finishes the files in the background.
+    void stop();
+    // GUI thread: joins a writer that has finished. Returns true once per recording, with a summary.
+    bool poll(std::string& message);
+    // Waits for the writer; for shutdown
+    void shutdown();
+
+    bool recording() const { return active.load(std::memory_order_relaxed); }
+    bool busy() const { return writer.joinable(); }
+    uint64_t framesRecorded() const { return framesCaptured.load(std::memory_order_relaxed); }
+    uint64_t overrunFrames() const { return overruns.load(std::memory_order_relaxed); }
+
+    // Audio thread, start of block: whether this block is recorded
+    void beginBlock() { blockActive = active.load(std::memory_order_acquire); }
+    // Audio thread. The stem row for a frame of the current block, or nullptr when stems are off.
+    int16_t* stemFrame(int frame) {
+        if (!blockActive || numStems == 0 || frame >= STEM_BLOCK_FRAMES) return nullptr;
+        return stemBlock.data() + (size_t)frame * numStems;
+    }
+    int stemCount() const { return numStems; }
+    // Audio thread, end of block: queue the interleaved stereo master and the block's stems
+    void capture(const int16_t* master, int numFrames);
+
+private:
+    void writerLoop();
+    size_t drain(SpscBulkRing<int16_t>& ring, WavWriter& file, int channels);
+
+    SpscBulkRing<int16_t> masterRing;
+    SpscBulkRing<int16_t> stemRing;
+    std::vector<int16_t> stemBlock; // one block of stems, filled frame by frame by the render loop
+    int numStems = 0;
+    bool blockActive = false; // audio thread's view of active for the current block
+
+    WavWriter masterFile;
+    WavWriter stemFile;
+    std::string summary;
+    int rate = 0;
+    bool writeFailed = false;
+
+    std::thread writer;
+    std::atomic<bool> active{false};
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> finished{false};
+    std::atomic<uint64_t> framesCaptured{0};
+    std::atomic<uint64_t> overruns{0};
+};
@@ -0,0 +1,38 @@
+#include "ScopeCapture.h"
+#include <algorithm>
+
+bool ScopeCapture::beginBlock(int numFrames) {
+    if (!enabled.load(std::memory_order_relaxed)) return false;
+    blockFrames = numFrames;
+    claimed.store(start + numFrames, std::memory_order_relaxed);
+    // Readers that see any of this block's samples also see the claim
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+void ScopeCapture::endBlock() {
+    start += blockFrames;
+    written.store(start, std::memory_order_release);
+}
+
+bool ScopeCapture::readMaster(float* left, float* right, int count) const {
+    count = std::min(count, MASTER_SIZE);
+    uint64_t end = written.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+        int idx = (int)((end - count + i) & (MASTER_SIZE - 1));
+        left[i] = masterL[idx].load(std::memory_order_relaxed);
+        right[i] = masterR[idx].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return claimed.load(std::memory_order_relaxed) - end <= (uint64_t)(MASTER_SIZE - count);
+}
+
+bool ScopeCapture::readVoice(int voice, float* out, int count) const {
+    count = std::min(count, VOICE_SIZE);
+    uint64_t end = written.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+        out[i] = voices[voice][(end - count + i) & (VOICE_SIZE - 1)].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return claimed.load(std::memory_order_relaxed) - end <= (uint64_t)(VOICE_SIZE - count);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Oscilloscope and goniometer feed from the audio thread.
+// The render loop stores samples with plain (relaxed) stores at positions it tracks itself and
+// publishes the block with a single release store, instead of an atomic read-modify-write per sample
+// and voice. Readers follow the seqlock pattern: they copy a window, then check how far the writer
+// had claimed meanwhile, and report whether any of the copied samples may have been overwritten.
+// Capture is skipped entirely while the GUI has the scope hidden.
+class ScopeCapture {
+public:
+    static constexpr int MASTER_SIZE = 4096; // powers of two
+    static constexpr int VOICE_SIZE = 2048;
+    static constexpr int MAX_VOICES = 16;
+
+    std::atomic<bool> enabled{true}; // GUI: false while nobody looks at the scopes
+
+    // Audio thread. Returns false, and nothing should be written, while capture is disabled.
+    bool beginBlock(int numFrames);
+    void writeMaster(int frame, float left, float right) {
+        int i = (int)((start + frame) & (MASTER_SIZE - 1));
+        masterL[i].store(left, std::memory_order_relaxed);
+        masterR[i].store(right, std::memory_order_relaxed);
+    }
+    void writeVoice(int voice, int frame, float sample) {
+        voices[voice][(start + frame) & (VOICE_SIZE - 1)].store(sample, std::memory_order_relaxed);
+    }
+    void endBlock();
+
+    // GUI thread: the newest count samples, oldest first. False if the writer may have overwritten
+    // some of them during the copy; the caller can retry or draw them anyway.
+    bool readMaster(float* left, float* right, int count) const;
+    bool readVoice(int voice, float* out, int count) const;
+
+private:
+    std::atomic<float> masterL[MASTER_SIZE];
+    std::atomic<float> masterR[MASTER_SIZE];
+    std::atomic<float> voices[MAX_VOICES][VOICE_SIZE];
+
+    uint64_t start = 0;   // audio thread: position of the current block's first frame
+    int blockFrames = 0;
+    std::atomic<uint64_t> written{0}; // samples complete and visible
+    std::atomic<uint64_t> claimed{0}; // samples the writer may be storing right now
+};
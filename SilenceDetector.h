@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cmath>
+
+// Puts an effect with a tail to sleep once its input and what it writes into its delay line have both
+// stayed below -120 dBFS for holdFrames (the length of the line, so nothing louder is left in it), and
+// wakes it on the first input above that. Watching the line rather than the stage's output keeps a
+// stage whose wet mix is turned down awake while its line still rings. A sleeping stage passes its
+// input through untouched, which is as quiet as its output would have been. Audio thread only.
+struct SilenceDetector {
+    static constexpr float THRESHOLD = 1e-6f; // -120 dBFS
+
+    int quietFrames = 0;
+    bool asleep = false;
+
+    static bool quiet(float left, float right) { return std::fabs(left) < THRESHOLD && std::fabs(right) < THRESHOLD; }
+
+    // Before the stage: true if it can skip this frame
+    bool sleeping(float inLeft, float inRight) {
+        if (quiet(inLeft, inRight)) return asleep;
+        quietFrames = 0;
+        asleep = false;
+        return false;
+    }
+    // After the stage, with what it wrote into its line (the output, for stages without one)
+    void update(float left, float right, int holdFrames) {
+        if (!quiet(left, right)) quietFrames = 0;
+        else if (++quietFrames >= holdFrames) asleep = true;
+    }
+};
@@ -0,0 +1,29 @@
+#include "SongPlayer.h"
+#include "EventScheduler.h"
+#include <cstring>
+
+void SongPlayer::play(std::shared_ptr<const MidiFile> newSong, int64_t startFrame) {
+    song = std::move(newSong);
+    cursor = 0;
+    start = startFrame;
+}
+
+void SongPlayer::stop() {
+    song.reset();
+    cursor = 0;
+}
+
+void SongPlayer::feed(EventScheduler& scheduler, int64_t blockStart, int numFrames) {
+    if (!song) return;
+    const std::vector<SongEvent>& events = song->events;
+    int64_t blockEnd = blockStart + numFrames;
+    ScheduledEvent ev;
+    ev.kind = ScheduledKind::Midi;
+    while (cursor < events.size() && start + events[cursor].frame < blockEnd) {
+        const SongEvent& e = events[cursor++];
+        ev.time = start + e.frame;
+        std::memcpy(ev.bytes, e.bytes, sizeof(ev.bytes));
+        ev.size = e.size;
+        scheduler.schedule(ev);
+    }
+}
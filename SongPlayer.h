@@ -0,0 +1,30 @@
+#pragma once
+
+#include "MidiFile.h"
+#include <cstdint>
+#include <memory>
+
+class EventScheduler;
+
+// Plays a decoded MIDI file through the event scheduler. Each block the audio thread hands the events
+// falling inside that block to the scheduler, so the heap never holds more than one block of the song
+// and stopping takes effect at the next block. The song is immutable while it plays.
+// play() and stop() are called with g_synthMutex held; the song is only released there, never on the audio thread.
+class SongPlayer {
+public:
+    void play(std::shared_ptr<const MidiFile> newSong, int64_t startFrame);
+    void stop();
+
+    bool playing() const { return song && cursor < song->events.size(); }
+    const MidiFile* current() const { return song.get(); }
+    // Position in samples relative to the start of the song
+    int64_t position(int64_t now) const { return song ? now - start : 0; }
+
+    // Audio thread, once per block before dispatching
+    void feed(EventScheduler& scheduler, int64_t blockStart, int numFrames);
+
+private:
+    std::shared_ptr<const MidiFile> song;
+    size_t cursor = 0;
+    int64_t start = 0;
+};
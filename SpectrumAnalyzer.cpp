@@ -0,0 +1,118 @@
+#include "SpectrumAnalyzer.h"
+#include "Denormals.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const int IDLE_SLEEP_MS = 5;
+const float POWER_EPSILON = 1e-12f;
+
+} // namespace
+
+SpectrumAnalyzer::SpectrumAnalyzer() : fft(FFT_SIZE) {
+    // Periodic Hann: overlapping windows at a hop of FFT_SIZE / 2 or less sum to a constant
+    for (int i = 0; i < FFT_SIZE; ++i) window[i] = 0.5f * (1.0f - std::cos(2.0f * (float)M_PI * i / FFT_SIZE));
+    std::memset(history, 0, sizeof(history));
+    std::memset(averagePower, 0, sizeof(averagePower));
+    std::fill(&current.average[0][0], &current.average[0][0] + 2 * BANDS, FLOOR_DB);
+    std::fill(&current.peak[0][0], &current.peak[0][0] + 2 * BANDS, FLOOR_DB);
+}
+
+void SpectrumAnalyzer::start(int rate) {
+    sampleRate = rate;
+    input.allocate((size_t)rate * 2); // one second of stereo
+    mapBands();
+#ifndef __EMSCRIPTEN__
+    if (worker.joinable()) return;
+    shouldExit = false;
+    worker = std::thread(&SpectrumAnalyzer::run, this);
+#endif
+}
+
+void SpectrumAnalyzer::stop() {
+    shouldExit = true;
+    if (worker.joinable()) worker.join();
+}
+
+void SpectrumAnalyzer::process() {
+    while (analyzeNext()) {}
+}
+
+void SpectrumAnalyzer::push(const int16_t* samples, int numFrames) {
+    input.write(samples, (size_t)numFrames * 2);
+}
+
+void SpectrumAnalyzer::run() {
+    DenormalGuard denormals; // windowed frames of a fading signal
+    while (!shouldExit) {
+        if (!analyzeNext()) std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_SLEEP_MS));
+    }
+}
+
+void SpectrumAnalyzer::mapBands() {
+    float binHz = (float)sampleRate / FFT_SIZE;
+    float nyquist = sampleRate * 0.5f;
+    for (int b = 0; b < BANDS; ++b) {
+        float f0 = MIN_HZ * std::pow(nyquist / MIN_HZ, (float)b / BANDS);
+        float f1 = MIN_HZ * std::pow(nyquist / MIN_HZ, (float)(b + 1) / BANDS);
+        // Low bands are narrower than a bin and repeat the bin they fall in
+        bandLo[b] = std::clamp((int)std::lround(f0 / binHz), 1, FFT_SIZE / 2);
+        bandHi[b] = std::clamp((int)std::lround(f1 / binHz), bandLo[b] + 1, FFT_SIZE / 2 + 1);
+    }
+}
+
+bool SpectrumAnalyzer::analyzeNext() {
+    int hopSize = std::clamp(hop.load(std::memory_order_relaxed), FFT_SIZE / 8, FFT_SIZE);
+
+    // Slide the newest samples into the history until a hop's worth has arrived
+    while (pending < hopSize) {
+        const int16_t* data = nullptr;
+        int available = (int)(input.peek(data) / 2);
+        if (available == 0) return false;
+        int take = std::min(available, hopSize - pending);
+        for (int c = 0; c < 2; ++c) {
+            std::memmove(history[c], history[c] + take, (FFT_SIZE - take) * sizeof(float));
+            float* dst = history[c] + FFT_SIZE - take;
+            for (int i = 0; i < take; ++i) dst[i] = data[i * 2 + c] * (1.0f / 32768.0f);
+        }
+        input.consume((size_t)take * 2);
+        pending += take;
+    }
+    pending = 0;
+
+    // Left and right as the real and imaginary parts of one complex FFT
+    for (int i = 0; i < FFT_SIZE; ++i) {
+        re[i] = history[0][i] * window[i];
+        im[i] = history[1][i] * window[i];
+    }
+    fft.forward(re, im);
+
+    // Separate the two real spectra: L = (Z[k] + conj Z[N-k]) / 2, R = (Z[k] - conj Z[N-k]) / 2i.
+    // Scaled so a full-scale sine reads 0 dB (the Hann window sums to N / 2).
+    const float scale = 4.0f / FFT_SIZE;
+    const float powerScale = 0.25f * scale * scale;
+    for (int k = 0; k <= FFT_SIZE / 2; ++k) {
+        int m = (FFT_SIZE - k) & (FFT_SIZE - 1);
+        float sumRe = re[k] + re[m], sumIm = im[k] - im[m];
+        float diffRe = re[k] - re[m], diffIm = im[k] + im[m];
+        power[0][k] = (sumRe * sumRe + sumIm * sumIm) * powerScale;
+        power[1][k] = (diffIm * diffIm + diffRe * diffRe) * powerScale;
+    }
+
+    float smoothing = std::clamp(averaging.load(std::memory_order_relaxed), 0.0f, 0.99f);
+    float peakFall = peakDecayDb.load(std::memory_order_relaxed) * hopSize / sampleRate;
+    for (int c = 0; c < 2; ++c) {
+        for (int b = 0; b < BANDS; ++b) {
+            float p = *std::max_element(power[c] + bandLo[b], power[c] + bandHi[b]);
+            averagePower[c][b] = smoothing * averagePower[c][b] + (1.0f - smoothing) * p;
+            float db = std::max(FLOOR_DB, 10.0f * std::log10(averagePower[c][b] + POWER_EPSILON));
+            current.average[c][b] = db;
+            current.peak[c][b] = std::max(db, current.peak[c][b] - peakFall);
+        }
+    }
+    frames.push(current); // the GUI skipped a frame if the queue is full
+    return true;
+}
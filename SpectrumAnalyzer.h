@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Fft.h"
+#include "LockFree.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Spectrum of the master bus, computed off the audio and GUI threads.
+// The audio thread hands every rendered block to push(); the analysis thread runs overlapping
+// Hann-windowed FFTs over all of it at the configured hop, both channels at once (as the real and
+// imaginary parts of one complex FFT), maps the bins onto log-spaced bands, and applies exponential
+// averaging and peak hold. Finished frames queue up for the GUI, which only ever reads those.
+class SpectrumAnalyzer {
+public:
+    static constexpr int FFT_SIZE = 2048;
+    static constexpr int BANDS = 512;
+    static constexpr float MIN_HZ = 20.0f;
+    static constexpr float FLOOR_DB = -120.0f;
+
+    struct Frame {
+        float average[2][BANDS]; // dB, 0 dB = full-scale sine
+        float peak[2][BANDS];
+    };
+
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer() { stop(); }
+
+    // Launch the analysis thread (none on the web build; call process() instead)
+    void start(int sampleRate);
+    void stop();
+    // Analyze everything queued so far on the calling thread
+    void process();
+
+    // Audio thread: an interleaved stereo block. Dropped if the analyzer is not keeping up.
+    void push(const int16_t* samples, int numFrames);
+    // GUI thread: oldest finished frame not read yet
+    bool pop(Frame& frame) { return frames.pop(frame); }
+
+    std::atomic<int> hop{FFT_SIZE / 4};    // samples between frames, FFT_SIZE / 8 .. FFT_SIZE
+    std::atomic<float> averaging{0.7f};    // weight of the previous average per frame, 0 = off
+    std::atomic<float> peakDecayDb{20.0f}; // how fast peak hold falls, dB per second
+
+private:
+    void run();
+    bool analyzeNext();
+    void mapBands();
+
+    Fft fft;
+    int sampleRate = 0;
+    SpscBulkRing<int16_t> input;
+    SpscRing<Frame, 16> frames;
+
+    float window[FFT_SIZE];
+    float history[2][FFT_SIZE]; // newest FFT_SIZE samples per channel
+    int pending = 0;            // samples gathered towards the next hop
+    float re[FFT_SIZE];
+    float im[FFT_SIZE];
+    float power[2][FFT_SIZE / 2 + 1];
+    float averagePower[2][BANDS];
+    Frame current;
+    int bandLo[BANDS];          // bins [lo, hi) that make up each band
+    int bandHi[BANDS];
+
+    std::thread worker;
+    std::atomic<bool> shouldExit{false};
+};
@@ -1,14 +1,31 @@
 #pragma once
 
 #include "Voice.h"
+#include "VoiceAllocator.h"
 #include "Filter.h"
+#include "Patch.h"
+#include "MidiQueue.h"
+#include "Mpe.h"
+#include "Arpeggiator.h"
+#include "EventScheduler.h"
+#include "Melody.h"
+#include "SongPlayer.h"
+#include "Recorder.h"
+#include "MidiMap.h"
+#include "ControlLink.h"
+#include "DspProfiler.h"
+#include "LoadGovernor.h"
+#include "SilenceDetector.h"
 #include <vector>
-#include <map>
 #include <cstdint>
 
+class ScopeCapture;
+class SpectrumAnalyzer;
+
 struct Synthesizer {
     std::vector<Voice> voices;
-    std::map<int,int> noteToVoice; // midiNote -> voice index
+    VoiceParams voicePatch; // the sound every voice plays outside multitimbral mode; voices reference it
+    VoiceAllocator voiceAllocator; // every note source starts and stops voices through this
     float masterVolume;
     float pan; // -1.0 = full left, 0.0 = center, 1.0 = full right
 
@@ -18,11 +35,26 @@ struct Synthesizer {
 
     // Pitch Bend & Modulation
     float pitchBend; // -1.0 to 1.0
+    float renderedPitchBend; // follows pitchBend, ramping across coalesced pitch bend runs
+    int pitchBendRampFrames; // frames left in the current ramp
     float pitchBendRange; // in semitones
     float modWheelValue; // 0 to 1.0
+    float renderedModWheel; // follows modWheelValue like renderedPitchBend
+    int modWheelRampFrames;
     float modLfoPhase;
     float modLfoRate;
 
+    // Multitimbral parts: MIDI channel n plays parts[n] when enabled
+    bool multitimbral;
+    Part parts[NUM_PARTS];
+
+    // MPE zones and the per-voice expression they drive
+    Mpe mpe;
+
+    // Controller assignments: midiMap is the engine copy presets capture, midiMapper dispatches on the audio thread
+    MidiMap midiMap;
+    MidiMapper midiMapper;
+
     // Arpeggiator
     bool arpEnabled;
     float arpBpm;
@@ -30,12 +62,9 @@ struct Synthesizer {
     int arpDirection; // 0=Up,1=Down,2=UpDown,3=Random
     int arpRange; // octaves
     bool arpHold;
-    std::vector<int> arpHeldNotes; // notes currently held (MIDI)
-    int arpStepIndex;
-    uint64_t arpLastStepTime;
-    int arpActiveVoice;
-    int arpActiveMidi;
-    uint64_t arpOffDeadline; // perf counter value when to turn off current arp note
+    float arpSwing; // 0..0.5, delay of every second step as a fraction of a step
+    int arpRatchet; // 1..4 repeats per step
+    Arpeggiator arp;
 
     // Flanger
     bool flangerEnabled;
@@ -47,6 +76,7 @@ struct Synthesizer {
     int flangerIndexL;
     int flangerIndexR;
     float flangerPhase;
+    SilenceDetector flangerSilence;
 
     // Delay
     bool delayEnabled;
@@ -58,6 +88,7 @@ struct Synthesizer {
     int delayIndexL;
     int delayIndexR;
     int delayMaxSamples;
+    SilenceDetector delaySilence;
 
     // Reverb (enhanced multi-tap with stereo processing)
     bool reverbEnabled;
@@ -73,6 +104,8 @@ struct Synthesizer {
     int reverbIndexL;
     int reverbIndexR;
     int reverbMaxSamples;
+    float reverbDampL = 0.0f, reverbDampR = 0.0f; // damping low-pass state
+    SilenceDetector reverbSilence;
 
     // Mixer / Bus compression
     bool compressorEnabled;
@@ -105,5 +138,45 @@ struct Synthesizer {
     float autoGainGainL, autoGainGainR; // current smoothed gain
     float autoGainRMSL, autoGainRMSR; // current smoothed RMS
 
+    // Compressor, filter and master stage sleep together once the bus has been silent for a while
+    SilenceDetector busSilence;
+
+    // Preset snapshots published to the audio thread
+    PatchExchange patchExchange;
+
+    // GUI edits in, telemetry and engine-side parameter changes out
+    ControlLink controlLink;
+
+    // Timestamped MIDI input, dispatched by the audio thread on the exact frame
+    MidiQueue midiQueue;
+
+    // Engine timeline: frames rendered so far. The scheduler, the melody and the arpeggiator run on it.
+    int64_t sampleClock;
+    EventScheduler scheduler;
+    Melody melody;
+    SongPlayer songPlayer;
+
+    // Master bus (and voice stem) recording, fed at the end of every rendered block
+    Recorder recorder;
+
+    // Per-stage timing of the audio callback, and the governor it feeds
+    DspProfiler profiler;
+    LoadGovernor governor;
+
+    // Visualization feeds, set by the GUI; left null for offline renders and benchmarks
+    ScopeCapture* scope = nullptr;
+    SpectrumAnalyzer* spectrum = nullptr;
+
     Synthesizer();
+
+    // Restart every random sequence (noise oscillators, random arpeggio) from seed. A new synthesizer
+    // starts from seed 0, so renders driven only by the sample clock come out the same every time.
+    void seedRandom(uint32_t seed);
+
+    // Start a note on a MIDI channel. In multitimbral mode the channel's part sets the voice budget
+    // and the started voice plays the part's parameters; muted parts start nothing. Returns the voice or -1.
+    int noteOn(int channel, int note, float velocity);
+
+    // Part that plays a channel: the channel's own, or its zone's manager channel for MPE member channels
+    int partOf(int channel) const;
 };
\ No newline at end of file
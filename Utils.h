@@ -5,7 +5,7 @@
 
 // Audio parameters
 const int SAMPLE_RATE = 44100;
-const int BUFFER_SIZE = 1024; // Number of samples per buffer
+const int MODULATION_SUB_BLOCK = 16; // frames between control-rate modulation updates in the render loop
 
 // MIDI to Frequency conversion
 inline float midiNoteToFrequency(int midiNote) {
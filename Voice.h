@@ -11,65 +11,35 @@ public:
 
     void noteOn(int note, float velocity);
     void noteOff();
+    // Give each oscillator its own noise sequence derived from seed
+    void seedNoise(uint32_t seed);
 
     float generateSample();
     float generateSampleDetuned(float detuneCents, float phaseOffsetSeconds) const;
     void generateStereoSample(float& left, float& right);
     void generateStereoSampleDetuned(float detuneCents, float phaseOffsetSeconds, float voicePan, float& left, float& right) const;
 
-    // global-ish setters (per-voice parameters)
-    void setWaveformType(Oscillator::WaveformType type);
-    void setAttackTime(float t);
-    void setDecayTime(float t);
-    void setSustainLevel(float l);
-    void setReleaseTime(float t);
+    // Parameter set this voice plays; must outlive the voice or be replaced before it goes away
+    void setParams(const VoiceParams* p);
+    const VoiceParams& getParams() const;
+
+    // per-note state
     void setAmplitude(float a);
     void setFrequency(float f);
-    void setMixLevel(float m);
-
-    // per-VCO controls
-    void setVcoWaveform(int idx, Oscillator::WaveformType t);
-    void setVcoMix(int idx, float m);
-    void setVcoDetune(int idx, float cents);
-    void setVcoPhaseMs(int idx, float ms);
-    void setVcoPulseWidth(int idx, float pw);
-    void setVcoPitchShift(int idx, float semis);
-    void setVcoPan(int idx, float pan);
-
     void setPitchBend(float bend_semitones);
     void setLfoMod(float mod_semitones);
 
-    // per-voice unison
-    void setUnisonCount(int c);
-    void setUnisonSpreadIndex(int si);
-
-    // getters
     float getFrequency() const;
     float getAmplitude() const;
-    int getWaveformType() const;
-    float getAttackTime() const;
-    float getDecayTime() const;
-    float getSustainLevel() const;
-    float getReleaseTime() const;
-    float getMixLevel() const;
-    int getUnisonCount() const;
-    int getUnisonSpreadIndex() const;
-    float getPhaseOffsetMs() const;
-    float getPulseWidth() const;
-    float getPitchShift() const;
-    float getDetune() const;
-
-    // per-vco getters
-    float getVcoMix(int idx) const;
-    float getVcoDetune(int idx) const;
-    float getVcoPhaseMs(int idx) const;
-    float getVcoPulseWidth(int idx) const;
-    int getVcoWaveform(int idx) const;
-    float getVcoPitchShift(int idx) const;
-    float getVcoPan(int idx) const;
 
     int getMidiNote() const;
-    uint64_t getLastUsed() const;
+    bool isSounding() const; // any oscillator envelope not yet OFF
+    bool isReleasing() const;
+    // Velocity times envelope; in the attack the velocity alone, the level the note is heading for
+    float getLevel() const;
+    // Release over seconds from the current level, skipping what is left of the envelope; false if
+    // the voice is silent or already fading
+    bool fadeOut(float seconds);
 
     // expose for unison
     float getPhase() const;
@@ -79,15 +49,8 @@ public:
     Oscillator& getOscillator(int idx);
 
 private:
+    const VoiceParams* params;
     Oscillator oscs[3];
     int midiNote;
-    uint64_t lastUsed;
-    float mixLevel;
-    int unisonCount; // 0 means use global
-    int unisonSpreadIndex; // -1 means use global
     float baseFrequency;
-    float vcoMix[3];
-    float vcoDetune[3];
-    float vcoPhaseMs[3];
-    float vcoPan[3];
 };
\ No newline at end of file
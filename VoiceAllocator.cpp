@@ -0,0 +1,188 @@
+#include "VoiceAllocator.h"
+#include "Voice.h"
+#include <algorithm>
+#include <cstring>
+
+VoiceAllocator::VoiceAllocator(std::vector<Voice>& voices) : voices(voices) {
+    reset();
+}
+
+void VoiceAllocator::reset() {
+    numVoices = std::min((int)voices.size(), MAX_VOICES);
+    std::memset(noteTable, -1, sizeof(noteTable));
+    stealHeap.clear();
+    for (StealHeap& heap : channelHeaps) heap.clear();
+    freeHead = -1;
+    numFree = 0;
+    for (int v = 0; v < MAX_VOICES; ++v) {
+        state[v] = FREE;
+        slotChannel[v] = -1;
+        slotNote[v] = -1;
+        owner[v] = 0;
+        age[v] = 0;
+        releaseLevel[v] = 0.0f;
+    }
+    // Pushed in reverse so voice 0 is handed out first
+    for (int v = numVoices - 1; v >= 0; --v) pushFree(v);
+}
+
+int VoiceAllocator::noteOn(int channel, int note, float velocity, int maxVoices) {
+    if (channel < 0 || channel >= MAX_CHANNELS || note < 0 || note >= MAX_NOTES || numVoices == 0) return -1;
+
+    int v = noteTable[channel][note];
+    if (v >= 0) {
+        // Same note again: retrigger its voice rather than stacking a second one
+        untrack(v);
+    } else {
+        if (channelHeaps[channel].size >= std::max(1, maxVoices)) {
+            v = channelHeaps[channel].top(); // over budget: the channel steals from itself
+        } else if (numFree > 0) {
+            v = popFree();
+        } else {
+            v = stealHeap.top();
+        }
+        if (state[v] != FREE) {
+            untrack(v);
+            unmap(v);
+            if (voices[v].getMidiNote() != -1) voices[v].noteOff();
+        }
+    }
+
+    state[v] = HELD;
+    age[v] = ++ageCounter;
+    slotChannel[v] = (int8_t)channel;
+    slotNote[v] = (int8_t)note;
+    owner[v] = (int8_t)channel;
+    noteTable[channel][note] = (int8_t)v;
+    track(v);
+    voices[v].noteOn(note, velocity);
+    return v;
+}
+
+int VoiceAllocator::noteOff(int channel, int note) {
+    if (channel < 0 || channel >= MAX_CHANNELS || note < 0 || note >= MAX_NOTES) return -1;
+    int v = noteTable[channel][note];
+    if (v < 0) return -1;
+
+    unmap(v);
+    voices[v].noteOff();
+    untrack(v);
+    state[v] = RELEASED;
+    releaseLevel[v] = voices[v].getEnvelopeLevel();
+    track(v);
+    return v;
+}
+
+void VoiceAllocator::allNotesOff() {
+    for (int v = 0; v < numVoices; ++v) {
+        unmap(v);
+        if (state[v] == HELD) {
+            voices[v].noteOff();
+            untrack(v);
+            state[v] = RELEASED;
+            releaseLevel[v] = voices[v].getEnvelopeLevel();
+            track(v);
+        }
+    }
+}
+
+void VoiceAllocator::reclaim() {
+    for (int v = 0; v < numVoices; ++v) {
+        if (state[v] == FREE || voices[v].isSounding()) continue;
+        untrack(v);
+        unmap(v);
+        state[v] = FREE;
+        pushFree(v);
+    }
+}
+
+int VoiceAllocator::voiceForNote(int channel, int note) const {
+    if (channel < 0 || channel >= MAX_CHANNELS || note < 0 || note >= MAX_NOTES) return -1;
+    return noteTable[channel][note];
+}
+
+bool VoiceAllocator::higherPriority(int a, int b) const {
+    if (state[a] != state[b]) return state[a] == RELEASED;
+    if (state[a] == RELEASED && releaseLevel[a] != releaseLevel[b]) return releaseLevel[a] < releaseLevel[b];
+    return age[a] < age[b];
+}
+
+void VoiceAllocator::track(int v) {
+    stealHeap.insert(*this, v);
+    channelHeaps[owner[v]].insert(*this, v);
+}
+
+void VoiceAllocator::untrack(int v) {
+    stealHeap.remove(*this, v);
+    channelHeaps[owner[v]].remove(*this, v);
+}
+
+void VoiceAllocator::pushFree(int v) {
+    nextFree[v] = (int8_t)freeHead;
+    freeHead = v;
+    ++numFree;
+}
+
+int VoiceAllocator::popFree() {
+    int v = freeHead;
+    freeHead = nextFree[v];
+    --numFree;
+    return v;
+}
+
+void VoiceAllocator::unmap(int v) {
+    int channel = slotChannel[v], note = slotNote[v];
+    if (channel >= 0 && note >= 0 && noteTable[channel][note] == v) noteTable[channel][note] = -1;
+    slotChannel[v] = -1;
+    slotNote[v] = -1;
+}
+
+void VoiceAllocator::StealHeap::clear() {
+    size = 0;
+    std::memset(pos, -1, sizeof(pos));
+}
+
+void VoiceAllocator::StealHeap::insert(const VoiceAllocator& va, int v) {
+    items[size] = (int8_t)v;
+    pos[v] = (int8_t)size;
+    siftUp(va, size++);
+}
+
+void VoiceAllocator::StealHeap::remove(const VoiceAllocator& va, int v) {
+    int i = pos[v];
+    if (i < 0) return;
+    pos[v] = -1;
+    if (--size == i) return;
+    int moved = items[size];
+    items[i] = (int8_t)moved;
+    pos[moved] = (int8_t)i;
+    siftUp(va, i);
+    siftDown(va, pos[moved]);
+}
+
+void VoiceAllocator::StealHeap::siftUp(const VoiceAllocator& va, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!va.higherPriority(items[i], items[parent])) break;
+        swap(i, parent);
+        i = parent;
+    }
+}
+
+void VoiceAllocator::StealHeap::siftDown(const VoiceAllocator& va, int i) {
+    for (;;) {
+        int best = i;
+        int left = 2 * i + 1, right = left + 1;
+        if (left < size && va.higherPriority(items[left], items[best])) best = left;
+        if (right < size && va.higherPriority(items[right], items[best])) best = right;
+        if (best == i) return;
+        swap(i, best);
+        i = best;
+    }
+}
+
+void VoiceAllocator::StealHeap::swap(int i, int j) {
+    std::swap(items[i], items[j]);
+    pos[items[i]] = (int8_t)i;
+    pos[items[j]] = (int8_t)j;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Voice;
+
+// Single voice allocator shared by every note source (MIDI, arpeggiator, melody).
+// All storage is fixed-size, so no call allocates and every call is O(1) or O(log voices):
+//  - noteTable[channel][note] maps a sounding note to its voice
+//  - free voices sit on an intrusive singly linked list
+//  - voices that are playing sit in an indexed min-heap ordered by steal priority: released voices
+//    before held ones, released voices by their level at note-off (quietest first), held voices by age
+//    (oldest first), remaining ties by age. A second heap per channel serves per-part voice budgets.
+// Not thread-safe; callers hold g_synthMutex like for any other synthesizer state.
+class VoiceAllocator {
+public:
+    static constexpr int MAX_CHANNELS = 16;
+    static constexpr int MAX_NOTES = 128;
+    static constexpr int MAX_VOICES = 64;
+
+    explicit VoiceAllocator(std::vector<Voice>& voices);
+
+    // Forget all notes and put every voice on the free list (does not touch the voices)
+    void reset();
+
+    // Start a note and return its voice. A note that is already sounding on the channel is retriggered
+    // on the same voice; otherwise a free voice is used, and only if there is none a voice is stolen.
+    // A channel that already owns maxVoices voices steals from itself instead.
+    int noteOn(int channel, int note, float velocity, int maxVoices = MAX_VOICES);
+
+    // Release a note. Returns its voice, or -1 if the note was not sounding.
+    int noteOff(int channel, int note);
+
+    // Release every voice and clear the note table
+    void allNotesOff();
+
+    // Audio thread, once per block: voices whose envelope has finished go back to the free list
+    void reclaim();
+
+    int voiceForNote(int channel, int note) const;
+    int freeCount() const { return numFree; }
+    // Channel that started the voice's current or last note (it keeps sounding through its release)
+    int channelOf(int voice) const { return owner[voice]; }
+    int voicesOnChannel(int channel) const { return channelHeaps[channel].size; }
+    const int8_t* voicesOf(int channel) const { return channelHeaps[channel].items; } // voicesOnChannel() entries
+
+private:
+    enum SlotState : uint8_t { FREE, HELD, RELEASED };
+
+    // Indexed binary min-heap of voice indices, ordered by VoiceAllocator::higherPriority
+    struct StealHeap {
+        int8_t items[MAX_VOICES];
+        int8_t pos[MAX_VOICES]; // position of each voice in items, -1 if not in the heap
+        int size = 0;
+
+        void clear();
+        void insert(const VoiceAllocator& va, int v);
+        void remove(const VoiceAllocator& va, int v);
+        int top() const { return items[0]; }
+
+    private:
+        void siftUp(const VoiceAllocator& va, int i);
+        void siftDown(const VoiceAllocator& va, int i);
+        void swap(int i, int j);
+    };
+
+    bool higherPriority(int a, int b) const; // a should be stolen before b
+    void track(int v);   // add to the steal heaps after a state change
+    void untrack(int v); // remove from the steal heaps
+    void pushFree(int v);
+    int popFree();
+    void unmap(int v);
+
+    std::vector<Voice>& voices;
+    int numVoices = 0;
+
+    int8_t noteTable[MAX_CHANNELS][MAX_NOTES];
+
+    SlotState state[MAX_VOICES];
+    int8_t slotChannel[MAX_VOICES];
+    int8_t slotNote[MAX_VOICES];
+    int8_t owner[MAX_VOICES];
+    uint64_t age[MAX_VOICES];
+    float releaseLevel[MAX_VOICES];
+    uint64_t ageCounter = 0;
+
+    int8_t nextFree[MAX_VOICES];
+    int freeHead = -1;
+    int numFree = 0;
+
+    StealHeap stealHeap;                   // every voice that is not free
+    StealHeap channelHeaps[MAX_CHANNELS];  // the same voices, split by owner channel
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+// Per-VCO parameters of a patch
+struct VcoParams {
+    int waveform = 0;
+    float mix = 1.0f / 3.0f;
+    float detune = 0.0f;
+    float phaseMs = 0.0f;
+    float pulseWidth = 0.5f;
+    float pitchShift = 0.0f;
+    float pan = 0.0f;
+
+    bool operator==(const VcoParams&) const = default;
+};
+
+// Sound of a voice: envelope, mix, unison and the three VCOs.
+// Voices do not own a copy; each one references the parameter set of whoever started it (the
+// synthesizer's voicePatch, or a multitimbral part), which only the audio thread writes, between blocks.
+struct VoiceParams {
+    float attackTime = 0.01f;
+    float decayTime = 0.1f;
+    float sustainLevel = 0.5f;
+    float releaseTime = 0.2f;
+    float mixLevel = 1.0f;
+    int unisonCount = 0;        // 0 means use global
+    int unisonSpreadIndex = -1; // -1 means use global
+    VcoParams vcos[3];
+
+    bool operator==(const VoiceParams&) const = default;
+};
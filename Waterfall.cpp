@@ -0,0 +1,78 @@
+#include "Waterfall.h"
+#include "imgui.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const float LUT_MIN_DB = -100.0f; // dB range across the table
+const float LUT_MAX_DB = 0.0f;
+
+// Map magnitude (dB  -100..0) to RGB
+void magToColor(float db, unsigned char &r, unsigned char &g, unsigned char &b) {
+    float t = std::clamp((db + 100.0f) / 100.0f, 0.0f, 1.0f);
+    // blue -> cyan -> yellow -> red
+    if (t < 0.33f) {
+        float u = t / 0.33f;
+        r = static_cast<unsigned char>(0.0f * 255);
+        g = static_cast<unsigned char>((0.0f + u * 255.0f) );
+        b = static_cast<unsigned char>((128.0f + u * 127.0f));
+    } else if (t < 0.66f) {
+        float u = (t - 0.33f) / 0.33f;
+        r = static_cast<unsigned char>((u * 255.0f));
+        g = static_cast<unsigned char>((255.0f));
+        b = static_cast<unsigned char>((255.0f - u * 255.0f));
+    } else {
+        float u = (t - 0.66f) / 0.34f;
+        r = static_cast<unsigned char>((255.0f));
+        g = static_cast<unsigned char>((255.0f - u * 255.0f));
+        b = static_cast<unsigned char>(0);
+    }
+}
+
+} // namespace
+
+Waterfall::Waterfall() {
+    for (int i = 0; i < 256; ++i) {
+        magToColor(LUT_MIN_DB + (LUT_MAX_DB - LUT_MIN_DB) * i / 255.0f, lut[i][0], lut[i][1], lut[i][2]);
+    }
+}
+
+void Waterfall::createTexture() {
+    std::vector<unsigned char> blank((size_t)WIDTH * HISTORY * 3, 0);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, WIDTH, HISTORY, 0, GL_RGB, GL_UNSIGNED_BYTE, blank.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+void Waterfall::addRow(const SpectrumAnalyzer::Frame& frame) {
+    if (texture == 0) createTexture();
+    const float scale = 255.0f / (LUT_MAX_DB - LUT_MIN_DB);
+    for (int x = 0; x < WIDTH; ++x) {
+        int band = x * SpectrumAnalyzer::BANDS / WIDTH;
+        float db = std::max(frame.average[0][band], frame.average[1][band]); // louder channel
+        int index = std::clamp((int)((db - LUT_MIN_DB) * scale), 0, 255);
+        row[x * 3 + 0] = lut[index][0];
+        row[x * 3 + 1] = lut[index][1];
+        row[x * 3 + 2] = lut[index][2];
+    }
+    head = (head + HISTORY - 1) % HISTORY;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, head, WIDTH, 1, GL_RGB, GL_UNSIGNED_BYTE, row);
+}
+
+void Waterfall::draw(float width, float height, int rows) {
+    if (texture == 0) createTexture();
+    rows = std::clamp(rows, 1, HISTORY);
+    float top = (float)head / HISTORY;
+    ImGui::Image((void*)(intptr_t)texture, ImVec2(width, height), ImVec2(0.0f, top), ImVec2(1.0f, top + (float)rows / HISTORY));
+}
+
+void Waterfall::destroy() {
+    if (texture != 0) glDeleteTextures(1, &texture);
+    texture = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "SpectrumAnalyzer.h"
+#include <SDL3/SDL_opengl.h>
+
+// Scrolling spectrogram of the analyzer's frames.
+// The texture is a circular set of rows: each new frame overwrites the oldest row with a single-row
+// upload, and drawing scrolls through texture coordinates (the texture repeats vertically), so the
+// per-frame cost is the same however long the history is. dB values map to colors through a
+// precomputed table.
+class Waterfall {
+public:
+    static constexpr int WIDTH = 512;
+    static constexpr int HISTORY = 2048; // rows kept in the texture
+
+    Waterfall();
+
+    // GL thread. The texture is created on first use and must be released before the context is.
+    void addRow(const SpectrumAnalyzer::Frame& frame);
+    // The newest rows rows, newest at the top
+    void draw(float width, float height, int rows);
+    void destroy();
+
+private:
+    void createTexture();
+
+    GLuint texture = 0;
+    int head = 0; // row holding the newest frame; older rows follow at head + 1, head + 2, ...
+    unsigned char lut[256][3];
+    unsigned char row[WIDTH * 3];
+};
@@ -0,0 +1,81 @@
+#include "WavWriter.h"
+
+namespace {
+
+const size_t WRITE_BUFFER_BYTES = 1 << 20; // stdio buffer: the disk sees large sequential writes
+const uint32_t DS64_SIZE = 28;              // ds64 chunk body without a table
+const size_t HEADER_BYTES = 12 + 8 + DS64_SIZE + 8 + 16 + 8;
+
+void putLe(uint8_t* p, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = (uint8_t)(value >> (8 * i));
+}
+
+} // namespace
+
+bool WavWriter::open(const std::string& filename, int rate, int numChannels) {
+    close();
+    file = fopen(filename.c_str(), "wb");
+    if (!file) return false;
+    setvbuf(file, nullptr, _IOFBF, WRITE_BUFFER_BYTES);
+    sampleRate = rate;
+    channels = numChannels;
+    frames = 0;
+    if (!writeHeader(false)) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool WavWriter::write(const int16_t* samples, size_t numFrames) {
+    if (!file) return false;
+    // Samples go out as they are in memory: little-endian, like the S16LE audio stream
+    size_t written = fwrite(samples, sizeof(int16_t) * channels, numFrames, file);
+    frames += written;
+    return written == numFrames;
+}
+
+bool WavWriter::close() {
+    if (!file) return true;
+    uint64_t dataBytes = frames * channels * sizeof(int16_t);
+    bool ok = fseek(file, 0, SEEK_SET) == 0 && writeHeader(HEADER_BYTES - 8 + dataBytes > 0xFFFFFFFFu);
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool WavWriter::writeHeader(bool rf64) {
+    uint64_t dataBytes = frames * channels * sizeof(int16_t);
+    uint64_t riffBytes = HEADER_BYTES - 8 + dataBytes;
+    uint8_t h[HEADER_BYTES] = {};
+    uint8_t* p = h;
+    auto tag = [&p](const char* id) { for (int i = 0; i < 4; ++i) *p++ = (uint8_t)id[i]; };
+    auto put = [&p](uint64_t value, int bytes) { putLe(p, value, bytes); p += bytes; };
+
+    tag(rf64 ? "RF64" : "RIFF");
+    put(rf64 ? 0xFFFFFFFFu : riffBytes, 4);
+    tag("WAVE");
+    // ds64 once the sizes need 64 bits, otherwise a JUNK chunk of the same size that readers skip
+    tag(rf64 ? "ds64" : "JUNK");
+    put(DS64_SIZE, 4);
+    if (rf64) {
+        put(riffBytes, 8);
+        put(dataBytes, 8);
+        put(frames, 8);
+        put(0, 4); // no table entries
+    } else {
+        p += DS64_SIZE;
+    }
+    tag("fmt ");
+    put(16, 4);
+    put(1, 2); // PCM
+    put(channels, 2);
+    put(sampleRate, 4);
+    put(sampleRate * channels * 2, 4); // byte rate
+    put(channels * 2, 2);              // block align
+    put(16, 2);                        // bits per sample
+    tag("data");
+    put(rf64 ? 0xFFFFFFFFu : dataBytes, 4);
+    return fwrite(h, 1, sizeof(h), file) == sizeof(h);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// 16-bit PCM WAV file writer. The header is written on open() with placeholder sizes and
+// patched by close(), so the file can be written block by block. A JUNK chunk reserves room
+// for a ds64 chunk, so files that outgrow 4 GB are finished as RF64 instead of wrapping.
+class WavWriter {
+public:
+    WavWriter() = default;
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+    ~WavWriter() { close(); }
+
+    bool open(const std::string& filename, int sampleRate, int channels);
+    // Interleaved samples, numFrames * channels of them
+    bool write(const int16_t* samples, size_t numFrames);
+    bool close();
+
+    bool isOpen() const { return file != nullptr; }
+    uint64_t framesWritten() const { return frames; }
+
+private:
+    bool writeHeader(bool rf64);
+
+    FILE* file = nullptr;
+    int sampleRate = 0;
+    int channels = 0;
+    uint64_t frames = 0;
+};
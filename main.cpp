@@ -10,7 +10,6 @@
 #include <algorithm>
 #include <iterator>
 #include <cstdio>
-#include <complex>
 #include <atomic>
 #include <cstring>
 #include <cstdlib>
@@ -20,6 +19,7 @@
 #include <sstream> // For string stream operations
 #include <thread>  // For std::thread
 #include <chrono>  // For std::chrono timing
+#include <functional>
 
 #include "imgui.h"
 #include "imgui_impl_sdl3.h"
@@ -32,42 +32,65 @@
 #include "Oscillator.h"
 #include "Voice.h"
 #include "Synthesizer.h"
+#include "Engine.h"
 #include "Preset.h"
-#include "Melody.h"
+#include "Patch.h"
+#include "PresetBank.h"
+#include "PresetIndex.h"
+#include "Log.h"
 #include "SineTable.h"
+#include "WavWriter.h"
+#include "SpectrumAnalyzer.h"
+#include "ScopeCapture.h"
+#include "Waterfall.h"
+#include "DspProfiler.h"
+#include "AudioOutput.h"
 
-// Global Melody instance
-Melody g_melody;
 
 // Visualization constants
 static const int SCOPE_BUFFER = 2048;
-static const int FFT_SIZE = 1024; // power of two
 static const int WATERFALL_WIDTH = 512;
 static const int WATERFALL_HEIGHT = 256;
-static const int MAX_VOICES = 16;
 static const int SCOPE_VOICE_BUFFER = 512;
+static const int SCOPE_READ_TRIES = 3; // snapshots torn by the audio thread are retried, then drawn anyway
 
 Synthesizer g_synth;
 std::mutex g_synthMutex;
 
 
 SDL_Window* g_window = nullptr;
-std::vector<std::string> presetFiles;
+std::vector<std::string> presetFiles; // current search results, refreshed from g_presetIndex
+PresetIndex g_presetIndex;
+static char g_presetSearch[64] = "";
 static SDL_DialogFileFilter filters[] = {{"JSON files", "json"}};
+static SDL_DialogFileFilter midiFileFilters[] = {{"MIDI files", "mid;midi"}};
+static std::mutex g_songMutex; // guards g_song and g_songName, so the GUI can read them without g_synthMutex
+static std::shared_ptr<const MidiFile> g_song; // last loaded MIDI file
+static std::string g_songName;
+static bool g_recordStems = false;
+static bool g_recordRequested = false; // handled after the GUI frame, opening the file can take a while
+// GUI copy of the engine's parameters. The controls window edits only this; ControlLink carries the changes.
+static ControlState g_controls;
+static ControlState g_controlsPublished; // last snapshot handed to the engine
+static Telemetry g_telemetry;
+static std::vector<std::function<void()>> g_engineActions; // run under g_synthMutex after the GUI frame
 std::string statusMessage;
-std::atomic<bool> g_arpThreadShouldExit = false;
 static char g_presetFilename[128] = "default_preset.json";
+static const char* PRESET_BANK_FILE = "presets.synbank";
+static DspProfiler::Window g_dspWindow; // the GUI's report window, refreshed with the CPU figure
+static DspReport g_dspReport;
+static const char* g_metricsFile = nullptr; // --metrics: profiler report rewritten every few seconds
+static const Uint64 METRICS_INTERVAL_MS = 5000;
+// Playback stream; --period or the Audio Output window picks its device period
+static AudioOutput g_audioOutput;
+static int g_periodSetting = AudioOutput::SDL_DEFAULT;
+static LatencyReport g_latency;
+PresetBank g_presetBank;
 
 
 
-// Thread-safe ring buffer for visualization (written by audio thread)
-static float g_leftScopeBuffer[SCOPE_BUFFER];
-static float g_rightScopeBuffer[SCOPE_BUFFER];
-static std::atomic<int> g_scopeWriteIndex{0};
-
-// Per-voice scope buffers
-static float g_voiceScopeBuffers[MAX_VOICES][SCOPE_VOICE_BUFFER];
-static std::atomic<int> g_voiceScopeWriteIdx[MAX_VOICES];
+// Master and per-voice scope history, published by the audio thread once per block
+static ScopeCapture g_scope;
 
 // Trigger settings
 // 0=zero,1=level(edge),2=edge,3=hysteresis
@@ -76,59 +99,32 @@ static float g_triggerLevel = 0.0f; // -1..1
 static int g_triggerEdge = 0; // 0=rising,1=falling
 static float g_triggerHysteresis = 0.01f; // 0..0.2
 
-// Round-robin voice allocator index
-static std::atomic<int> g_roundRobinIndex{0};
-
-// Waterfall texture and pixel buffer
-static GLuint g_waterfallTex = 0;
-static std::vector<unsigned char> g_waterfallPixels(WATERFALL_WIDTH * WATERFALL_HEIGHT * 3, 0);
-
-// Simple in-place radix-2 FFT
-void fft(std::vector<std::complex<float>>& a) {
-    const int n = (int)a.size();
-    int j = 0;
-    for (int i = 1; i < n; ++i) {
-        int bit = n >> 1;
-        for (; j & bit; bit >>= 1) j ^= bit;
-        j ^= bit;
-        if (i < j) std::swap(a[i], a[j]);
-    }
-    for (int len = 2; len <= n; len <<= 1) {
-        float ang = 2.0f * M_PI / len * -1.0f;
-        std::complex<float> wlen(std::cos(ang), fastSin(ang));
-        for (int i = 0; i < n; i += len) {
-            std::complex<float> w(1.0f, 0.0f);
-            for (int k = 0; k < len/2; ++k) {
-                std::complex<float> u = a[i+k];
-                std::complex<float> v = a[i+k+len/2] * w;
-                a[i+k] = u + v;
-                a[i+k+len/2] = u - v;
-                w *= wlen;
-            }
+// Spectrum of the master bus, analyzed on its own thread; the GUI reads finished frames
+static SpectrumAnalyzer g_spectrum;
+static SpectrumAnalyzer::Frame g_spectrumFrame;
+static bool g_spectrumValid = false;
+
+// Spectrogram texture, fed with the analyzer's frames
+static Waterfall g_waterfall;
+static int g_waterfallRows = 256; // history shown, up to Waterfall::HISTORY
+
+// First crossing of the current trigger condition among samples[0..count], 0 if there is none;
+// the caller needs count more samples after it
+static int findTrigger(const float* samples, int count) {
+    for (int b = 1; b <= count; ++b) {
+        float sa = samples[b - 1];
+        float sb = samples[b];
+        if (g_triggerMode == 0) { if (sa < -0.001f && sb >= -0.001f) return b; }
+        else if (g_triggerMode == 1 || g_triggerMode == 2) {
+            if (g_triggerEdge == 0) { if (sa < g_triggerLevel && sb >= g_triggerLevel) return b; }
+            else { if (sa > g_triggerLevel && sb <= g_triggerLevel) return b; }
+        } else if (g_triggerMode == 3) {
+            float low = g_triggerLevel - g_triggerHysteresis, high = g_triggerLevel + g_triggerHysteresis;
+            if (g_triggerEdge == 0) { if (sa <= low && sb >= high) return b; }
+            else { if (sa >= high && sb <= low) return b; }
         }
     }
-}
-
-// Map magnitude (dB  -100..0) to RGB
-static void magToColor(float db, unsigned char &r, unsigned char &g, unsigned char &b) {
-    float t = std::clamp((db + 100.0f) / 100.0f, 0.0f, 1.0f);
-    // blue -> cyan -> yellow -> red
-    if (t < 0.33f) {
-        float u = t / 0.33f;
-        r = static_cast<unsigned char>(0.0f * 255);
-        g = static_cast<unsigned char>((0.0f + u * 255.0f) );
-        b = static_cast<unsigned char>((128.0f + u * 127.0f));
-    } else if (t < 0.66f) {
-        float u = (t - 0.33f) / 0.33f;
-        r = static_cast<unsigned char>((u * 255.0f));
-        g = static_cast<unsigned char>((255.0f));
-        b = static_cast<unsigned char>((255.0f - u * 255.0f));
-    } else {
-        float u = (t - 0.66f) / 0.34f;
-        r = static_cast<unsigned char>((255.0f));
-        g = static_cast<unsigned char>((255.0f - u * 255.0f));
-        b = static_cast<unsigned char>(0);
-    }
+    return 0;
 }
 
 // Draw background grid into ImGui window draw list
@@ -149,333 +145,27 @@ static void drawGrid(ImDrawList* draw, const ImVec2& pos, const ImVec2& size, in
 
 // Audio callback function
 void SDLCALL audioCallback(void* userdata, SDL_AudioStream *stream, int additional_amount, int total_amount) {
-    std::lock_guard<std::mutex> lock(g_synthMutex);
     Synthesizer* synth = (Synthesizer*)userdata;
-    int numSamples = total_amount / sizeof(Sint16);
+    synth->profiler.beginCallback(); // before the lock, so time spent waiting for it counts
+    std::lock_guard<std::mutex> lock(g_synthMutex);
+
     Sint16* buffer = (Sint16*)SDL_malloc(total_amount);
     if (!buffer) {
-        SDL_Log("Failed to allocate audio buffer: %s", SDL_GetError());
+        LOG_ERROR("Failed to allocate audio buffer: %s", SDL_GetError());
         return;
     }
-
-    int channels = 2;
-    int numFrames = numSamples / channels;
-
-    // Update LFO
-    g_synth.modLfoPhase += g_synth.modLfoRate / static_cast<float>(SAMPLE_RATE);
-    if (g_synth.modLfoPhase >= 1.0f) {
-        g_synth.modLfoPhase -= 1.0f;
-    }
-    float lfoValue = fastSin(2.0f * M_PI * g_synth.modLfoPhase) * g_synth.modWheelValue * 1.0f; // 1 semitone max depth
-
-    // Apply global pitch mods to all voices
-    for (auto& voice : synth->voices) {
-        voice.setPitchBend(g_synth.pitchBend * g_synth.pitchBendRange);
-        voice.setLfoMod(lfoValue);
-    }
-
-    float lastMixedL = 0.0f, lastMixedR = 0.0f; // For debug
-    float lastOutL = 0.0f, lastOutR = 0.0f; // For debug
-    for (int frame = 0; frame < numFrames; ++frame) {
-        float mixedSampleL = 0.0f;
-        float mixedSampleR = 0.0f;
-
-        // --- Voice Synthesis and Unison ---
-        for (size_t v = 0; v < synth->voices.size(); ++v) {
-            int voiceUnison = synth->voices[v].getUnisonCount();
-            int N = (voiceUnison > 0) ? voiceUnison : synth->unisonCount;
-            N = std::clamp(N, 1, 8);
-
-            int voiceSpreadIdx = synth->voices[v].getUnisonSpreadIndex();
-            int spreadIdx = (voiceSpreadIdx >= 0) ? voiceSpreadIdx : synth->unisonSpreadIndex;
-            spreadIdx = std::clamp(spreadIdx, 0, 4);
-            const int spreadValues[5] = {0, 3, 10, 25, 50}; // detune in cents
-            int stepCentsLocal = spreadValues[spreadIdx];
-            const float phaseSpreadValues[5] = {0.0f, 0.0001f, 0.00025f, 0.0005f, 0.001f}; // phase offset in seconds
-            float stepPhaseSecLocal = phaseSpreadValues[spreadIdx];
-
-            float voiceSumL = 0.0f;
-            float voiceSumR = 0.0f;
-            float centerSample = 0.0f;
-
-            int center = (N - 1) / 2;
-            for (int k = 0; k < N; ++k) {
-                int offset = k - center;
-                float detune = offset * static_cast<float>(stepCentsLocal);
-                if (offset == 0) {
-                    float voiceLeft, voiceRight;
-                    synth->voices[v].generateStereoSample(voiceLeft, voiceRight);
-                    voiceSumL += voiceLeft;
-                    voiceSumR += voiceRight;
-                    centerSample = (voiceLeft + voiceRight) * 0.5f; // For visualization
-                } else {
-                    // For unison detuned voices, apply voice-level panning based on offset for stereo spread
-                    float voicePan = offset > 0 ? 0.5f : -0.5f; // Positive offset = right, negative = left
-                    float phaseOffSec = (offset * stepPhaseSecLocal);
-                    float detuneLeft, detuneRight;
-                    synth->voices[v].generateStereoSampleDetuned(detune, phaseOffSec, voicePan, detuneLeft, detuneRight);
-                    voiceSumL += detuneLeft;
-                    voiceSumR += detuneRight;
-                }
-            }
-            if (N > 0) {
-                voiceSumL /= static_cast<float>(N);
-                voiceSumR /= static_cast<float>(N);
-            }
-
-            mixedSampleL += voiceSumL * synth->voices[v].getMixLevel();
-            mixedSampleR += voiceSumR * synth->voices[v].getMixLevel();
-
-            int vid = v < MAX_VOICES ? v : (v % MAX_VOICES);
-            int writeIdx = g_voiceScopeWriteIdx[vid].fetch_add(1) % SCOPE_VOICE_BUFFER;
-            g_voiceScopeBuffers[vid][writeIdx] = centerSample;
-        }
-
-        if (!synth->voices.empty()) {
-            float normFactor = 1.0f / sqrtf(synth->voices.size());
-            mixedSampleL *= normFactor;
-            mixedSampleR *= normFactor;
-        }
-
-        lastMixedL = mixedSampleL;
-        lastMixedR = mixedSampleR;
-
-        // --- Stereo Flanger ---
-        float afterFlangerL = mixedSampleL;
-        float afterFlangerR = mixedSampleR;
-        if (synth->flangerEnabled && !synth->flangerBufferL.empty()) {
-            float lfo = fastSin(2.0f * M_PI * synth->flangerPhase);
-            synth->flangerPhase += synth->flangerRate / static_cast<float>(SAMPLE_RATE);
-            if (synth->flangerPhase >= 1.0f) synth->flangerPhase -= 1.0f;
-
-            float modDelaySec = synth->flangerDepth * (0.5f * (lfo + 1.0f));
-            int modDelaySamples = static_cast<int>(modDelaySec * SAMPLE_RATE);
-
-            // Left
-            int readIndexL = synth->flangerIndexL - modDelaySamples;
-            if (readIndexL < 0) readIndexL += (int)synth->flangerBufferL.size();
-            float delayedSampleL = synth->flangerBufferL[readIndexL];
-            afterFlangerL = (1.0f - synth->flangerMix) * mixedSampleL + synth->flangerMix * delayedSampleL;
-            synth->flangerBufferL[synth->flangerIndexL] = mixedSampleL;
-            synth->flangerIndexL = (synth->flangerIndexL + 1) % (int)synth->flangerBufferL.size();
-
-            // Right
-            int readIndexR = synth->flangerIndexR - modDelaySamples;
-            if (readIndexR < 0) readIndexR += (int)synth->flangerBufferR.size();
-            float delayedSampleR = synth->flangerBufferR[readIndexR];
-            afterFlangerR = (1.0f - synth->flangerMix) * mixedSampleR + synth->flangerMix * delayedSampleR;
-            synth->flangerBufferR[synth->flangerIndexR] = mixedSampleR;
-            synth->flangerIndexR = (synth->flangerIndexR + 1) % (int)synth->flangerBufferR.size();
-        }
-
-        // --- Stereo Delay ---
-        float afterDelayL = afterFlangerL;
-        float afterDelayR = afterFlangerR;
-        if (synth->delayEnabled && synth->delayMaxSamples > 0) {
-            int delaySamples = static_cast<int>(synth->delayTimeSec * SAMPLE_RATE);
-            if (delaySamples >= synth->delayMaxSamples) delaySamples = synth->delayMaxSamples - 1;
-            
-            // Left
-            int readIndexL = synth->delayIndexL - delaySamples;
-            if (readIndexL < 0) readIndexL += synth->delayMaxSamples;
-            float delayOutL = synth->delayBufferL[readIndexL];
-            synth->delayBufferL[synth->delayIndexL] = afterFlangerL + delayOutL * synth->delayFeedback;
-            afterDelayL = (1.0f - synth->delayMix) * afterFlangerL + synth->delayMix * delayOutL;
-            synth->delayIndexL = (synth->delayIndexL + 1) % synth->delayMaxSamples;
-
-            // Right
-            int readIndexR = synth->delayIndexR - delaySamples;
-            if (readIndexR < 0) readIndexR += synth->delayMaxSamples;
-            float delayOutR = synth->delayBufferR[readIndexR];
-            synth->delayBufferR[synth->delayIndexR] = afterFlangerR + delayOutR * synth->delayFeedback;
-            afterDelayR = (1.0f - synth->delayMix) * afterFlangerR + synth->delayMix * delayOutR;
-            synth->delayIndexR = (synth->delayIndexR + 1) % synth->delayMaxSamples;
-        }
-
-        // --- Enhanced Stereo Reverb ---
-        float afterReverbL = afterDelayL;
-        float afterReverbR = afterDelayR;
-        if (synth->reverbEnabled && synth->reverbMaxSamples > 0) {
-            // Pre-delay processing
-            int preDelaySamples = static_cast<int>(synth->reverbDelay * SAMPLE_RATE);
-            int preDelayIdxL = (synth->reverbIndexL - preDelaySamples + synth->reverbMaxSamples) % synth->reverbMaxSamples;
-            int preDelayIdxR = (synth->reverbIndexR - preDelaySamples + synth->reverbMaxSamples) % synth->reverbMaxSamples;
-
-            // Get pre-delayed signals
-            float preDelayedL = synth->reverbBufferL[preDelayIdxL];
-            float preDelayedR = synth->reverbBufferR[preDelayIdxR];
-
-            // Calculate tap delays based on size and diffusion
-            float baseDelay = 0.02f + synth->reverbSize * 0.08f; // 20ms to 100ms
-            float diffusion = 0.3f + synth->reverbDiffuse * 0.4f; // Spread taps
-
-            int taps[6];
-            taps[0] = static_cast<int>((baseDelay * 0.8f) * SAMPLE_RATE);
-            taps[1] = static_cast<int>((baseDelay * 1.2f) * SAMPLE_RATE);
-            taps[2] = static_cast<int>((baseDelay * 1.6f + diffusion * 0.1f) * SAMPLE_RATE);
-            taps[3] = static_cast<int>((baseDelay * 2.2f + diffusion * 0.2f) * SAMPLE_RATE);
-            taps[4] = static_cast<int>((baseDelay * 3.1f + diffusion * 0.3f) * SAMPLE_RATE);
-            taps[5] = static_cast<int>((baseDelay * 4.5f + diffusion * 0.4f) * SAMPLE_RATE);
-
-            // Left channel processing
-            float reverbOutL = 0.0f;
-            for (int i = 0; i < 6; ++i) {
-                int idx = (synth->reverbIndexL - taps[i] + synth->reverbMaxSamples) % synth->reverbMaxSamples;
-                reverbOutL += synth->reverbBufferL[idx] * (1.0f / 6.0f);
-            }
-
-            // Right channel processing
-            float reverbOutR = 0.0f;
-            for (int i = 0; i < 6; ++i) {
-                int idx = (synth->reverbIndexR - taps[i] + synth->reverbMaxSamples) % synth->reverbMaxSamples;
-                reverbOutR += synth->reverbBufferR[idx] * (1.0f / 6.0f);
-            }
-
-            // Apply size/decay
-            reverbOutL *= synth->reverbSize;
-            reverbOutR *= synth->reverbSize;
-
-            // Stereo cross-mixing
-            float crossL = reverbOutR * synth->reverbStereo * 0.3f;
-            float crossR = reverbOutL * synth->reverbStereo * 0.3f;
-            reverbOutL = reverbOutL * (1.0f - synth->reverbStereo * 0.3f) + crossL;
-            reverbOutR = reverbOutR * (1.0f - synth->reverbStereo * 0.3f) + crossR;
-
-            // Apply damping (low-pass filter effect)
-            static float dampFilterL = 0.0f, dampFilterR = 0.0f;
-            float dampCoeff = 1.0f - synth->reverbDamp * 0.1f;
-            dampFilterL = dampFilterL * dampCoeff + reverbOutL * (1.0f - dampCoeff);
-            dampFilterR = dampFilterR * dampCoeff + reverbOutR * (1.0f - dampCoeff);
-            reverbOutL = dampFilterL;
-            reverbOutR = dampFilterR;
-
-            // Write back to buffer with pre-delay input
-            synth->reverbBufferL[synth->reverbIndexL] = preDelayedL + reverbOutL * 0.7f; // Feedback
-            synth->reverbBufferR[synth->reverbIndexR] = preDelayedR + reverbOutR * 0.7f;
-
-            // Mix dry/wet
-            afterReverbL = synth->reverbDryMix * afterDelayL + synth->reverbWetMix * reverbOutL;
-            afterReverbR = synth->reverbDryMix * afterDelayR + synth->reverbWetMix * reverbOutR;
-
-            // Update indices
-            synth->reverbIndexL = (synth->reverbIndexL + 1) % synth->reverbMaxSamples;
-            synth->reverbIndexR = (synth->reverbIndexR + 1) % synth->reverbMaxSamples;
-        }
-
-        // --- Stereo Bus Compressor ---
-        float processedL = afterReverbL;
-        float processedR = afterReverbR;
-        if (synth->compressorEnabled) {
-            float attackSec = std::max(0.0001f, synth->compressorAttackMs * 0.001f);
-            float releaseSec = std::max(0.0001f, synth->compressorReleaseMs * 0.001f);
-            float attackCoef = std::exp(-1.0f / (attackSec * SAMPLE_RATE));
-            float releaseCoef = std::exp(-1.0f / (releaseSec * SAMPLE_RATE));
-            float makeup = std::pow(10.0f, synth->compressorMakeupDb / 20.0f);
-
-            // Left
-            float absValL = std::fabs(processedL) + 1e-20f;
-            float inDbL = 20.0f * std::log10(absValL);
-            float desiredGainL = 1.0f;
-            if (inDbL > synth->compressorThresholdDb) {
-                float outDb = synth->compressorThresholdDb + (inDbL - synth->compressorThresholdDb) / synth->compressorRatio;
-                desiredGainL = std::pow(10.0f, (outDb - inDbL) / 20.0f);
-            }
-            float coefL = (desiredGainL < synth->compressorGainL) ? attackCoef : releaseCoef;
-            synth->compressorGainL = coefL * synth->compressorGainL + (1.0f - coefL) * desiredGainL;
-            processedL *= synth->compressorGainL * makeup;
-
-            // Right
-            float absValR = std::fabs(processedR) + 1e-20f;
-            float inDbR = 20.0f * std::log10(absValR);
-            float desiredGainR = 1.0f;
-            if (inDbR > synth->compressorThresholdDb) {
-                float outDb = synth->compressorThresholdDb + (inDbR - synth->compressorThresholdDb) / synth->compressorRatio;
-                desiredGainR = std::pow(10.0f, (outDb - inDbR) / 20.0f);
-            }
-            float coefR = (desiredGainR < synth->compressorGainR) ? attackCoef : releaseCoef;
-             synth->compressorGainR = coefR * synth->compressorGainR + (1.0f - coefR) * desiredGainR;
-             processedR *= synth->compressorGainR * makeup;
-         }
-
-           // --- Filter ---
-           if (synth->filterEnabled) {
-                processedL = synth->filter.process(processedL);
-                processedR = synth->filter.process(processedR);
-           }
-
-          // --- DC Filter ---
-          if (synth->dcFilterEnabled) {
-              // High-pass filter for DC removal: y[n] = alpha * (y[n-1] + x[n] - x[n-1])
-              float yL = synth->dcFilterAlpha * (synth->dcFilterY1L + processedL - synth->dcFilterX1L);
-              synth->dcFilterX1L = processedL;
-              synth->dcFilterY1L = yL;
-              processedL = yL;
-
-              float yR = synth->dcFilterAlpha * (synth->dcFilterY1R + processedR - synth->dcFilterX1R);
-              synth->dcFilterX1R = processedR;
-              synth->dcFilterY1R = yR;
-              processedR = yR;
-          }
-
-          // --- Soft Clipping ---
-          if (synth->softClipEnabled) {
-              processedL = std::tanh(processedL * synth->softClipDrive) / synth->softClipDrive;
-              processedR = std::tanh(processedR * synth->softClipDrive) / synth->softClipDrive;
-          }
-
-           // --- Auto Gain ---
-           if (synth->autoGainEnabled) {
-               // Compute RMS
-
-               float rmsL = std::sqrt(processedL * processedL);
-               float rmsR = std::sqrt(processedR * processedR);
-               synth->autoGainRMSL = synth->autoGainAlpha * synth->autoGainRMSL + (1.0f - synth->autoGainAlpha) * rmsL;
-               synth->autoGainRMSR = synth->autoGainAlpha * synth->autoGainRMSR + (1.0f - synth->autoGainAlpha) * rmsR;
-
-               // Adjust gain if RMS is below target
-               float targetGainL = (synth->autoGainRMSL > 0.0f) ? synth->autoGainTargetRMS / synth->autoGainRMSL : 1.0f;
-               float targetGainR = (synth->autoGainRMSR > 0.0f) ? synth->autoGainTargetRMS / synth->autoGainRMSR : 1.0f;
-               synth->autoGainGainL = synth->autoGainAlpha * synth->autoGainGainL + (1.0f - synth->autoGainAlpha) * targetGainL;
-               synth->autoGainGainR = synth->autoGainAlpha * synth->autoGainGainR + (1.0f - synth->autoGainAlpha) * targetGainR;
-
-                processedL *= synth->autoGainGainL;
-                processedR *= synth->autoGainGainR;
-           }
-
-          // Apply master volume
-          processedL *= synth->masterVolume;
-          processedR *= synth->masterVolume;
-
-          // Apply panning (linear pan law)
-          float panLeft = 1.0f - std::max(0.0f, synth->pan);  // 1.0 when pan <= 0, decreases to 0 when pan = 1
-          float panRight = 1.0f + std::min(0.0f, synth->pan); // 1.0 when pan >= 0, decreases to 0 when pan = -1
-          processedL *= panLeft;
-          processedR *= panRight;
-
-          // Clamp final samples
-         float finalSampleL = std::clamp(processedL, -1.0f, 1.0f);
-         float finalSampleR = std::clamp(processedR, -1.0f, 1.0f);
-
-        // write to visualization ring buffer
-        int idx = g_scopeWriteIndex.fetch_add(1) % SCOPE_BUFFER;
-        g_leftScopeBuffer[idx] = finalSampleL;
-        g_rightScopeBuffer[idx] = finalSampleR;
-
-        Sint16 outSampleL = static_cast<Sint16>(finalSampleL * 32767);
-        Sint16 outSampleR = static_cast<Sint16>(finalSampleR * 32767);
-        buffer[frame * 2] = outSampleL;     // left
-        buffer[frame * 2 + 1] = outSampleR; // right
-        lastOutL = outSampleL;
-        lastOutR = outSampleR;
-    }
-
+    synth->profiler.mark(DspStage::Wait);
+    int numFrames = total_amount / (int)sizeof(Sint16) / 2;
+    renderAudio(synth, buffer, numFrames);
 
 
     int putResult = SDL_PutAudioStreamData(stream, buffer, total_amount);
     if (putResult < 0) {
-        SDL_Log("SDL_PutAudioStreamData failed: %s", SDL_GetError());
+        LOG_ERROR("SDL_PutAudioStreamData failed: %s", SDL_GetError());
     }
     SDL_free(buffer);
+    g_audioOutput.measure(stream, numFrames, SAMPLE_RATE);
+    synth->profiler.endCallback(numFrames, SAMPLE_RATE);
 }
 
 // A custom struct to hold information about the MIDI port
@@ -489,30 +179,21 @@ std::vector<std::unique_ptr<libremidi::midi_in>> g_midi_inputs;
 std::vector<PortData> g_midi_port_data;
 
 
-void handleNoteOff(int midiNote) {
-    // Find the voice that should handle this note off
-    auto it = g_synth.noteToVoice.find(midiNote);
-    if (it != g_synth.noteToVoice.end()) {
-        int voiceIndex = it->second;
-        
-        // Additional validation: ensure voice index is valid
-        if (voiceIndex >= 0 && voiceIndex < (int)g_synth.voices.size()) {
-            // Double-check that this voice is actually playing the note we're turning off
-            if (g_synth.voices[voiceIndex].getMidiNote() == midiNote) {
-                g_synth.voices[voiceIndex].noteOff();
-            }
-        }
-        
-        // Remove the note-to-voice mapping regardless of voice state
-        g_synth.noteToVoice.erase(it);
+// Debug dump of an incoming MIDI message; goes through the log ring, never the console
+static void logMidiMessage(const unsigned char* bytes, int length, int status, int note, int vel, int input) {
+    if (!Log::enabled(LogLevel::Debug)) return;
+    char hex[3 * 16 + 4];
+    int pos = 0;
+    for (int i = 0; i < length && i < 16; i++) {
+        pos += snprintf(hex + pos, sizeof(hex) - pos, i ? " %x" : "%x", bytes[i]);
     }
+    if (length > 16) snprintf(hex + pos, sizeof(hex) - pos, " ..");
+    LOG_DEBUG("MIDI: [%s] status=0x%x note=%d vel=%d input=%d", hex, status, note, vel, input);
 }
 
 #ifdef EMSCRIPTEN
 // JavaScript-callable MIDI callback function
 extern "C" void midiCallbackFromJS(unsigned char* data, int length, int inputIndex) {
-    std::lock_guard<std::mutex> lock(g_synthMutex);
-    
     if (length == 0) return;
     
     int status = data[0] & 0xF0;
@@ -520,333 +201,241 @@ extern "C" void midiCallbackFromJS(unsigned char* data, int length, int inputInd
     int vel = (length >= 3) ? data[2] : 0;
     
     // Debug output for incoming MIDI packets
-    std::cout << "MIDI: [";
-    for (int i = 0; i < length; i++) {
-        std::cout << std::hex << (int)data[i];
-        if (i < length - 1) std::cout << " ";
-    }
-    std::cout << std::dec << "] status=0x" << std::hex << status << std::dec 
-              << " note=" << midiNote << " vel=" << vel << " input=" << inputIndex << std::endl;
-    
-    // Process MIDI message the same way as libremidi
-    int voiceIndex = -1;
+    logMidiMessage(data, length, status, midiNote, vel, inputIndex);
     
-    // Pitch Bend
-    if (status == 0xE0) {
-        if (length >= 3) {
-            int lsb = data[1];
-            int msb = data[2];
-            int value = (msb << 7) | lsb;
-            g_synth.pitchBend = (value - 8192.0f) / 8192.0f;
-        }
-        return;
-    }
-    
-    // Control Change (for Mod Wheel)
-    if (status == 0xB0) {
-        if (length >= 3) {
-            int controller = data[1];
-            if (controller == 1) { // Modulation Wheel
-                g_synth.modWheelValue = data[2] / 127.0f;
-            }
-        }
-        return;
-    }
-    
-    // Only process Note On (0x90) and Note Off (0x80) from here
-    if (status != 0x90 && status != 0x80) return;
-    
-    // Note On
-    if (status == 0x90 && vel > 0) {
-        // Allocate voice using round-robin
-        int nVoices = (int)g_synth.voices.size();
-        voiceIndex = g_roundRobinIndex.fetch_add(1) % nVoices;
-        
-        // Check if this voice was playing another note and clean up
-        int oldMidiNote = g_synth.voices[voiceIndex].getMidiNote();
-        if (oldMidiNote != -1) {
-            auto it = g_synth.noteToVoice.find(oldMidiNote);
-            if (it != g_synth.noteToVoice.end() && it->second == voiceIndex) {
-                g_synth.noteToVoice.erase(it);
-            }
-            g_synth.voices[voiceIndex].noteOff();
-        }
-        
-        g_synth.voices[voiceIndex].noteOn(midiNote, vel);
-        g_synth.noteToVoice[midiNote] = voiceIndex;
-    }
-    // Note Off
-    else if (status == 0x80 || (status == 0x90 && vel == 0)) {
-        auto it = g_synth.noteToVoice.find(midiNote);
-        if (it != g_synth.noteToVoice.end()) {
-            voiceIndex = it->second;
-            if (voiceIndex >= 0 && voiceIndex < (int)g_synth.voices.size()) {
-                if (g_synth.voices[voiceIndex].getMidiNote() == midiNote) {
-                    g_synth.voices[voiceIndex].noteOff();
-                }
-            }
-            g_synth.noteToVoice.erase(it);
-        }
+    // Web MIDI delivers no timestamp through this path, so the message is stamped on arrival
+    if (!g_synth.midiQueue.push(data, length, midiClockNowNs())) {
+        LOG_WARN("MIDI queue full, message dropped");
     }
 }
 #endif
 
-// MIDI callback function
+// MIDI callback function: runs on the MIDI input thread, only stamps and queues the message
 void midiCallback(const libremidi::message& message, void* userData) {
-    std::lock_guard<std::mutex> lock(g_synthMutex);
     PortData* data = static_cast<PortData*>(userData);
 
     unsigned int nBytes = message.bytes.size();
     if (nBytes == 0) return;
 
     int status = message.bytes[0] & 0xF0;
-    int midiNote = message.bytes[1];
+    int midiNote = (nBytes >= 2) ? message.bytes[1] : 0;
     int vel = (nBytes >= 3) ? message.bytes[2] : 0;
 
 	// Debug output for incoming MIDI packets
-	std::cout << "MIDI: [";
-	for (unsigned int i = 0; i < nBytes; i++) {
-		std::cout << std::hex << (int)message.bytes[i];
-		if (i < nBytes - 1) std::cout << " ";
-	}
-	std::cout << std::dec << "] status=0x" << std::hex << status << std::dec 
-			  << " note=" << midiNote << " vel=" << vel << std::endl;
-    int voiceIndex = -1; // Declare voiceIndex here
-
-    // Pitch Bend
-    if (status == 0xE0) {
-        if (nBytes >= 3) {
-            int lsb = message.bytes[1];
-            int msb = message.bytes[2];
-            int value = (msb << 7) | lsb;
-            g_synth.pitchBend = (value - 8192.0f) / 8192.0f;
-        }
-        return;
-    }
+	logMidiMessage(message.bytes.data(), nBytes, status, midiNote, vel, (int)data->portNumber);
 
-    // Control Change (for Mod Wheel)
-    if (status == 0xB0) {
-        if (nBytes >= 3) {
-            int controller = message.bytes[1];
-            if (controller == 1) { // Modulation Wheel
-                g_synth.modWheelValue = message.bytes[2] / 127.0f;
-            }
-        }
-        return;
+    if (!g_synth.midiQueue.push(message.bytes.data(), nBytes, message.timestamp)) {
+        LOG_WARN("MIDI queue full, message dropped");
     }
+}
 
-    // Only process Note On (0x90) and Note Off (0x80) from here
-    if (status != 0x90 && status != 0x80) return;
-
-    if (g_synth.arpEnabled) {
-        if (status == 0x90 && vel > 0) { // Actual Note On for arpeggiator
-            if (std::find(g_synth.arpHeldNotes.begin(), g_synth.arpHeldNotes.end(), midiNote) == g_synth.arpHeldNotes.end()) {
-                g_synth.arpHeldNotes.push_back(midiNote);
-            }
-        } else if (status == 0x80 || (status == 0x90 && vel == 0)) { // Note Off (0x80 or 0x90 with vel == 0)
-            if (!g_synth.arpHold) {
-                g_synth.arpHeldNotes.erase(std::remove(g_synth.arpHeldNotes.begin(), g_synth.arpHeldNotes.end(), midiNote), g_synth.arpHeldNotes.end());
-            }
-        }
-    } else { // Arpeggiator is disabled
-        if (status == 0x90 && vel > 0) { // Actual Note On (0x90 with velocity > 0)
-            float velocity = vel / 127.0f;
-            int nVoices = (int)g_synth.voices.size();
-            if (nVoices == 0) return;
-
-            // Attempt 2 & 3: Find an inactive voice OR the least recently used active voice
-            int offVoiceIndex = -1;
-            int releaseVoiceIndex = -1;
-            uint64_t releaseLastUsed = (uint64_t)-1; // Max uint64_t value
-            int activeVoiceIndex = -1;
-            uint64_t activeLastUsed = (uint64_t)-1; // Max uint64_t value
-
-            for (int i = 0; i < nVoices; ++i) {
-                // Determine the state of the first oscillator in the voice
-                // Assuming all oscillators in a voice share the same envelope state for voice allocation purposes
-                Oscillator::EnvelopeState envState = g_synth.voices[i].getOscillator(0).getEnvelopeState();
-                
-                if (envState == Oscillator::EnvelopeState::OFF) {
-                    offVoiceIndex = i; // Found an OFF voice, prefer this and stop searching for this category
-                    break; // Prefer OFF voices immediately
-                } else if (envState == Oscillator::EnvelopeState::RELEASE) {
-                    if (g_synth.voices[i].getLastUsed() < releaseLastUsed) {
-                        releaseLastUsed = g_synth.voices[i].getLastUsed();
-                        releaseVoiceIndex = i;
-                    }
-                } else { // ATTACK, DECAY, SUSTAIN (active states)
-                    if (g_synth.voices[i].getLastUsed() < activeLastUsed) {
-                        activeLastUsed = g_synth.voices[i].getLastUsed();
-                        activeVoiceIndex = i;
-                    }
-                }
-            }
-            
-            // Prioritize voice selection: OFF > RELEASE > ACTIVE (LRU within each)
-            if (offVoiceIndex != -1) {
-                voiceIndex = offVoiceIndex;
-            } else if (releaseVoiceIndex != -1) {
-                voiceIndex = releaseVoiceIndex;
-            } else {
-                // If all voices are active (ATTACK, DECAY, SUSTAIN), steal the LRU active voice.
-                // This covers the case where activeVoiceIndex might still be -1 if nVoices is 0,
-                // but nVoices is checked at the beginning of the function.
-                voiceIndex = activeVoiceIndex;
-            }
-
-            // At this point, voiceIndex should be a valid index (either inactive, LRU release, or LRU active).
-
-            int oldMidiNoteOnStolenVoice = g_synth.voices[voiceIndex].getMidiNote();
-            if (oldMidiNoteOnStolenVoice != -1) {
-                auto it = g_synth.noteToVoice.find(oldMidiNoteOnStolenVoice);
-                if (it != g_synth.noteToVoice.end() && it->second == voiceIndex) {
-                    g_synth.noteToVoice.erase(it);
-                }
-            }
-
-            if (g_synth.voices[voiceIndex].getMidiNote() != -1) {
-                g_synth.voices[voiceIndex].noteOff();
-            }
-            g_synth.noteToVoice[midiNote] = voiceIndex;
-            g_synth.voices[voiceIndex].noteOn(midiNote, velocity);
-
-        } else if (status == 0x80 || (status == 0x90 && vel == 0)) { // Note Off (0x80 or 0x90 with velocity 0)
-            handleNoteOff(midiNote);
-        }
+// Copy the matching entries out of the index; never touches the disk, so it is safe every frame
+void refreshPresetFiles() {
+    static uint64_t lastGeneration = ~0ull;
+    static std::string lastSearch;
+    if (g_presetIndex.generation() == lastGeneration && lastSearch == g_presetSearch) return;
+    lastGeneration = g_presetIndex.generation();
+    lastSearch = g_presetSearch;
+    presetFiles.clear();
+    for (const PresetIndexEntry& entry : g_presetIndex.search(g_presetSearch)) {
+        presetFiles.push_back(entry.path);
     }
 }
 
-void arpThreadFunction() {
-    float perfFreq = (float)SDL_GetPerformanceFrequency();
-    while (!g_arpThreadShouldExit) {
-        uint64_t currentTime = SDL_GetPerformanceCounter();
-
-        { // Lock scope for arpeggiator logic
-            std::lock_guard<std::mutex> lock(g_synthMutex);
-
-            if (g_synth.arpEnabled) {
-                // Check if current arp note needs to be turned off (gate)
-                if (g_synth.arpActiveVoice != -1 && currentTime >= g_synth.arpOffDeadline) {
-                    g_synth.voices[g_synth.arpActiveVoice].noteOff();
-                    g_synth.arpActiveVoice = -1;
-                }
-
-                if (!g_synth.arpHeldNotes.empty()) { // ONLY if held notes exist
-                    float stepDuration = 60.0f / g_synth.arpBpm / 4.0f; // 16th notes
-                    if ((currentTime - g_synth.arpLastStepTime) / perfFreq >= stepDuration) {
-                        g_synth.arpLastStepTime = currentTime;
-
-                        // Stop previous note if still playing
-                        if (g_synth.arpActiveVoice != -1) {
-                            g_synth.voices[g_synth.arpActiveVoice].noteOff();
-                            g_synth.arpActiveVoice = -1;
-                        }
+// MIDI learn. Edits the mirror's map, which reaches the engine with the next control snapshot.
+static const Uint64 MIDI_LEARN_SETTLE_MS = 300;
+static Uint64 g_midiLearnStartMs = 0; // first controller received for the armed parameter, 0 if none yet
+static MidiSource g_midiLearnSource = MidiSource::CC;
 
-                        // Generate the list of notes to play
-                        std::vector<int> sortedNotes = g_synth.arpHeldNotes;
-                        std::sort(sortedNotes.begin(), sortedNotes.end());
-                        
-                        std::vector<int> arpPattern;
-                        for (int r = 0; r < g_synth.arpRange; ++r) {
-                            for (int note : sortedNotes) {
-                                arpPattern.push_back(note + r * 12);
-                            }
-                        }
-
-                        if (!arpPattern.empty()) {
-                            int patternSize = arpPattern.size();
-                            int noteToPlay;
-
-                            // Handle direction
-                            if (g_synth.arpDirection == 2) { // Up-Down
-                                int sequenceLength = std::max(1, patternSize * 2 - 2);
-                                int step = g_synth.arpStepIndex % sequenceLength;
-                                if (step < patternSize) {
-                                    noteToPlay = arpPattern[step];
-                                } else {
-                                    noteToPlay = arpPattern[patternSize - 2 - (step - patternSize)];
-                                }
-                            } else {
-                                if (g_synth.arpDirection == 1) { // Down
-                                    std::reverse(arpPattern.begin(), arpPattern.end());
-                                } else if (g_synth.arpDirection == 3) { // Random
-                                    g_synth.arpStepIndex = rand() % patternSize;
-                                }
-                                noteToPlay = arpPattern[g_synth.arpStepIndex % patternSize];
-                            }
-
-                            // Play the note
-                            int voiceIndex = g_roundRobinIndex.fetch_add(1) % g_synth.voices.size();
-                            g_synth.voices[voiceIndex].noteOn(noteToPlay, 0.8f); // Fixed velocity for now
-                            g_synth.arpActiveVoice = voiceIndex;
-                            g_synth.arpActiveMidi = noteToPlay;
-
-                            // Set note off time
-                            float gateDuration = stepDuration * g_synth.arpGate;
-                            g_synth.arpOffDeadline = currentTime + (uint64_t)(gateDuration * perfFreq);
-
-                            g_synth.arpStepIndex++;
-                        }
-                    }
-                } else {
-                    // No notes held, so stop any playing arp note
-                    if (g_synth.arpActiveVoice != -1) {
-                        g_synth.voices[g_synth.arpActiveVoice].noteOff();
-                        g_synth.arpActiveVoice = -1;
-                    }
-                    g_synth.arpStepIndex = 0; // Reset step index
-                }
-            } else {
-                // Arp is disabled, ensure any active arp note is turned off
-                if (g_synth.arpActiveVoice != -1) {
-                    g_synth.voices[g_synth.arpActiveVoice].noteOff();
-                    g_synth.arpActiveVoice = -1;
-                }
-            }
-        } // End lock scope for arpeggiator logic
+static void armMidiLearn(ParamId param) {
+    g_synth.midiMapper.arm(param);
+    g_midiLearnStartMs = 0;
+    statusMessage = std::string("MIDI learn: move a control for ") + paramInfo(param).label;
+}
 
-        // Sleep to prevent busy-waiting.
-        // The arpeggiator needs to be fairly responsive, so a short sleep is appropriate.
-        // Perhaps dynamically adjust based on whether arp is enabled/active.
-        std::this_thread::sleep_for(std::chrono::milliseconds(5)); // Sleep for 5ms
+// Right-click menu on a parameter's control
+static void midiLearnMenu(ParamId param) {
+    if (!ImGui::BeginPopupContextItem()) return;
+    if (ImGui::MenuItem("MIDI Learn")) armMidiLearn(param);
+    if (g_controls.patch.midiMap.findParam(param) && ImGui::MenuItem("Clear MIDI Mapping")) {
+        g_controls.patch.midiMap.remove(param);
     }
+    ImGui::EndPopup();
 }
 
-
+// The first controller moved after arming is assigned. Learn stays open a little longer because a 14-bit
+// CC or NRPN starts with a message that looks like a plain CC; what follows upgrades the mapping.
+static void pollMidiLearn() {
+    ParamId param = g_synth.midiMapper.learning();
+    MidiLearnEvent event;
+    bool changed = false;
+    while (g_synth.midiMapper.pollLearn(event)) {
+        if (param == ParamId::None) continue;
+        if (g_midiLearnStartMs != 0 && event.source <= g_midiLearnSource) continue;
+        MidiMapping mapping;
+        if (const MidiMapping* existing = g_controls.patch.midiMap.findParam(param)) {
+            mapping = *existing; // relearning keeps range and curve
+        } else {
+            const ParamInfo& info = paramInfo(param);
+            mapping.minValue = info.minValue;
+            mapping.maxValue = info.maxValue;
+            mapping.curve = info.logarithmic ? MidiCurve::Exponential : MidiCurve::Linear;
+        }
+        mapping.param = param;
+        mapping.source = event.source;
+        mapping.channel = event.channel;
+        mapping.number = event.number;
+        g_controls.patch.midiMap.set(mapping);
+        if (g_midiLearnStartMs == 0) g_midiLearnStartMs = SDL_GetTicks();
+        g_midiLearnSource = event.source;
+        changed = true;
+    }
+    if (changed) {
+        statusMessage = std::string("MIDI learn: mapped ") + paramInfo(param).label;
+    }
+    if (param != ParamId::None && g_midiLearnStartMs != 0 && SDL_GetTicks() - g_midiLearnStartMs > MIDI_LEARN_SETTLE_MS) {
+        g_synth.midiMapper.disarm();
+        g_midiLearnStartMs = 0;
+    }
+}
 
 void fileDialogCallback(void* userdata, const char* const* filelist, int filter) {
     if (!filelist || !filelist[0]) return;
     strcpy(g_presetFilename, filelist[0]);
     int action = (int)(uintptr_t)userdata;
+    // Capture the current state briefly, then leave file I/O to the preset worker.
+    // The preset index picks up the new file on its own.
+    Patch patch;
+    {
+        std::lock_guard<std::mutex> lock(g_synthMutex);
+        patch.capture(g_synth);
+    }
     if (action == 1) { // load
-        Preset::load(g_presetFilename);
-        statusMessage = "Preset loaded: " + std::string(g_presetFilename);
-        // Rescan preset files
-        presetFiles.clear();
-        for (const auto& entry : std::filesystem::directory_iterator(".")) {
-            if (entry.path().extension() == ".json") {
-                presetFiles.push_back(entry.path().filename().string());
-            }
-        }
+        Preset::loadAsync(g_presetFilename, patch);
+        statusMessage = "Loading preset: " + std::string(g_presetFilename);
     } else if (action == 2) { // save
-        Preset::save(g_presetFilename);
-        statusMessage = "Preset saved: " + std::string(g_presetFilename);
-        // Rescan preset files
-        presetFiles.clear();
-        for (const auto& entry : std::filesystem::directory_iterator(".")) {
-            if (entry.path().extension() == ".json") {
-                presetFiles.push_back(entry.path().filename().string());
-            }
-        }
+        Preset::saveAsync(g_presetFilename, patch);
+        statusMessage = "Saving preset: " + std::string(g_presetFilename);
+    }
+}
+
+// Decode the chosen MIDI file off the lock, then start it on the sample clock
+void midiFileDialogCallback(void* /*userdata*/, const char* const* filelist, int /*filter*/) {
+    if (!filelist || !filelist[0]) return;
+    auto song = std::make_shared<MidiFile>();
+    std::string error;
+    if (!song->load(filelist[0], SAMPLE_RATE, error)) {
+        statusMessage = error;
+        return;
+    }
+    std::string name = std::filesystem::path(filelist[0]).filename().string();
+    {
+        std::lock_guard<std::mutex> songLock(g_songMutex);
+        g_song = song;
+        g_songName = name;
+    }
+    std::lock_guard<std::mutex> lock(g_synthMutex);
+    g_synth.melody.stopMelody();
+    g_synth.voiceAllocator.allNotesOff();
+    g_synth.songPlayer.play(song, g_synth.sampleClock);
+    statusMessage = "Playing MIDI file: " + name;
+}
+
+#ifndef __EMSCRIPTEN__
+// Bounce a MIDI file to a WAV file without opening any device:
+//   sdl3-synth --render song.mid out.wav [preset.json] [--seed n]
+// Uses the same renderAudio() as the audio callback, so the file matches what live playback sounds like.
+// The result depends only on the song, the preset and the seed of the noise generators (default 0).
+static int renderOffline(const char* songFile, const char* wavFile, const char* presetFile, uint32_t seed) {
+    auto song = std::make_shared<MidiFile>();
+    std::string error;
+    if (!song->load(songFile, SAMPLE_RATE, error)) {
+        LOG_ERROR("%s", error.c_str());
+        return 1;
+    }
+    Patch patch;
+    patch.capture(g_synth);
+    if (Preset::read(presetFile, patch)) patch.apply(g_synth);
+
+    WavWriter wav;
+    if (!wav.open(wavFile, SAMPLE_RATE, 2)) {
+        LOG_ERROR("Cannot write %s", wavFile);
+        return 1;
+    }
+    const int64_t TAIL_FRAMES = 2 * SAMPLE_RATE; // releases and effects ring out after the last event
+
+    std::lock_guard<std::mutex> lock(g_synthMutex);
+    g_synth.seedRandom(seed);
+    size_t numEvents = song->events.size();
+    bool written = renderSong(&g_synth, song, TAIL_FRAMES, [&](const int16_t* block, int numFrames) {
+        return wav.write(block, numFrames);
+    });
+    if (!wav.close() || !written) {
+        LOG_ERROR("Write to %s failed", wavFile);
+        return 1;
+    }
+    LOG_INFO("Rendered %s (%zu events, %.1f s) to %s", songFile, numEvents,
+             (double)wav.framesWritten() / SAMPLE_RATE, wavFile);
+    return 0;
+}
+#endif
+
+// Start recording the master bus (and stems) to filename, or to a timestamped file if empty
+static void startRecording(std::string filename) {
+    if (filename.empty()) {
+        char name[64];
+        time_t now = time(nullptr);
+        strftime(name, sizeof(name), "recording-%Y%m%d-%H%M%S.wav", localtime(&now));
+        filename = name;
+    }
+    int stems = 0;
+    if (g_recordStems) {
+        std::lock_guard<std::mutex> lock(g_synthMutex);
+        stems = (int)g_synth.voices.size();
+    }
+    std::string error;
+    if (g_synth.recorder.start(filename, SAMPLE_RATE, stems, error)) {
+        statusMessage = "Recording to " + filename;
+        LOG_INFO("Recording to %s%s", filename.c_str(), stems ? " with voice stems" : "");
+    } else {
+        statusMessage = error;
+        LOG_ERROR("%s", error.c_str());
     }
 }
 
 int main(int argc, char* argv[]) {
-    srand(time(NULL));
+    Log::start();
 
     // Initialize sine lookup table for optimized oscillator processing
     initSineTable();
 
+#ifndef __EMSCRIPTEN__
+    if (argc >= 4 && strcmp(argv[1], "--render") == 0) {
+        const char* presetFile = "default_preset.json";
+        uint32_t seed = 0;
+        for (int i = 4; i < argc; ++i) {
+            if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+            else presetFile = argv[i];
+        }
+        int result = renderOffline(argv[2], argv[3], presetFile, seed);
+        Log::stop();
+        return result;
+    }
+    // sdl3-synth [--record out.wav] [--stems]: record the whole session
+    // [--metrics dsp.prom | dsp.json]: keep writing the DSP profiler's report
+    // [--period frames | auto]: device period to ask SDL for, or find the smallest one that does not glitch
+    const char* recordFile = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordFile = argv[++i];
+        else if (strcmp(argv[i], "--stems") == 0) g_recordStems = true;
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) g_metricsFile = argv[++i];
+        else if (strcmp(argv[i], "--period") == 0 && i + 1 < argc) {
+            ++i;
+            g_periodSetting = strcmp(argv[i], "auto") == 0 ? AudioOutput::AUTO : std::max(0, atoi(argv[i]));
+        }
+    }
+#endif
+
     if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO)) {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
         return 1;
@@ -864,12 +453,9 @@ int main(int argc, char* argv[]) {
     std::string cwd = std::filesystem::current_path().string();
 	
 #ifndef __EMSCRIPTEN__
-    // Scan for preset files
-    for (const auto& entry : std::filesystem::directory_iterator(".")) {
-        if (entry.path().extension() == ".json") {
-            presetFiles.push_back(entry.path().filename().string());
-        }
-    }
+    // Index preset files in the background
+    g_presetIndex.start(".", ".preset_index.cache");
+    g_presetBank.open(PRESET_BANK_FILE);
 #endif
 	
     // Setup SDL window with OpenGL context
@@ -933,24 +519,12 @@ int main(int argc, char* argv[]) {
 	io.Fonts->AddFontDefault();
 	
     // Setup audio device
-    SDL_AudioSpec desiredSpec;
-    SDL_zero(desiredSpec);
-    desiredSpec.freq = SAMPLE_RATE;
-    desiredSpec.format = SDL_AUDIO_S16LE;
-    desiredSpec.channels = 2; // stereo
-
-    SDL_AudioStream* audioStream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &desiredSpec, audioCallback, &g_synth);
-    if (!audioStream) {
-        std::cerr << "Failed to open audio device stream! SDL_Error: " << SDL_GetError() << std::endl;
-        SDL_DestroyWindow(window);
-        SDL_GL_DestroyContext(gl_context);
-        SDL_Quit();
-        return 1;
-    }
+    g_spectrum.start(SAMPLE_RATE); // before the audio thread starts pushing
+    g_synth.scope = &g_scope;
+    g_synth.spectrum = &g_spectrum;
 
-    if (!SDL_ResumeAudioStreamDevice(audioStream)) {
-        std::cerr << "Failed to resume audio device stream! SDL_Error: " << SDL_GetError() << std::endl;
-        SDL_DestroyAudioStream(audioStream);
+    if (!g_audioOutput.open(g_periodSetting, audioCallback, &g_synth)) {
+        std::cerr << "Failed to open audio device stream! SDL_Error: " << SDL_GetError() << std::endl;
         SDL_DestroyWindow(window);
         SDL_GL_DestroyContext(gl_context);
         SDL_Quit();
@@ -959,13 +533,13 @@ int main(int argc, char* argv[]) {
 
     // Setup MIDI input - disable automatic polling to prevent errors
     try {
-        std::cout << "Initializing Web MIDI..." << std::endl;
+        LOG_INFO("Initializing Web MIDI...");
         
         // Create observer callbacks
         libremidi::observer_configuration callbacks{
             .input_added =
                 [&](const libremidi::input_port& id) {
-                std::cout << "MIDI Input connected: " << id.port_name << std::endl;
+                LOG_INFO("MIDI Input connected: %s", id.port_name.c_str());
                 
                 // Create port data for this input
                 g_midi_port_data.push_back({.portNumber = (unsigned int)g_midi_port_data.size(), 
@@ -974,7 +548,8 @@ int main(int argc, char* argv[]) {
                 auto conf = libremidi::input_configuration{
                     .on_message = [&, portIndex = g_midi_port_data.size() - 1](const libremidi::message& msg) { 
                         midiCallback(msg, &g_midi_port_data[portIndex]); 
-                    }
+                    },
+                    .timestamps = libremidi::timestamp_mode::SystemMonotonic
                 };
                 
                 auto& input = g_midi_inputs.emplace_back(
@@ -984,7 +559,7 @@ int main(int argc, char* argv[]) {
             
             .input_removed =
                 [&](const libremidi::input_port& id) {
-                std::cout << "MIDI Input removed: " << id.port_name << std::endl;
+                LOG_INFO("MIDI Input removed: %s", id.port_name.c_str());
                 // Find and remove the corresponding input
                 auto it = std::find_if(g_midi_port_data.begin(), g_midi_port_data.end(),
                                       [&id](const PortData& pd) { return pd.portName == id.port_name; });
@@ -1007,10 +582,10 @@ int main(int argc, char* argv[]) {
         
         // Get all existing input ports and open them
         auto input_ports = obs.get_input_ports();
-        std::cout << "Found " << input_ports.size() << " MIDI input ports:" << std::endl;
+        LOG_INFO("Found %zu MIDI input ports:", input_ports.size());
         
         for (const auto& port : input_ports) {
-            std::cout << "  Opening MIDI Input: " << port.port_name << std::endl;
+            LOG_INFO("  Opening MIDI Input: %s", port.port_name.c_str());
             
             // Create port data for this input
             g_midi_port_data.push_back({.portNumber = (unsigned int)g_midi_port_data.size(), 
@@ -1019,7 +594,8 @@ int main(int argc, char* argv[]) {
             auto conf = libremidi::input_configuration{
                 .on_message = [&, portIndex = g_midi_port_data.size() - 1](const libremidi::message& msg) { 
                     midiCallback(msg, &g_midi_port_data[portIndex]); 
-                }
+                },
+                .timestamps = libremidi::timestamp_mode::SystemMonotonic
             };
             
             auto& input = g_midi_inputs.emplace_back(
@@ -1027,11 +603,11 @@ int main(int argc, char* argv[]) {
             input->open_port(port);
         }
         
-        std::cout << "MIDI observer initialized - monitoring for device changes..." << std::endl;
+        LOG_INFO("MIDI observer initialized - monitoring for device changes...");
         
     } catch (const std::exception& e) {
-        std::cerr << "Failed to initialize Web MIDI: " << e.what() << std::endl;
-        std::cerr << "Continuing without MIDI input." << std::endl;
+        LOG_ERROR("Failed to initialize Web MIDI: %s", e.what());
+        LOG_ERROR("Continuing without MIDI input.");
     }
 
     bool quit = false;
@@ -1049,20 +625,24 @@ int main(int argc, char* argv[]) {
     lastTotalCpuTime = initialCpuTimes.first;
     lastIdleCpuTime = initialCpuTimes.second;
 
-#ifndef __EMSCRIPTEN__
-    std::thread arpThread(arpThreadFunction); // Launch arpeggiator thread
-#endif
-
 #ifndef __EMSCRIPTEN__
     Preset::load("default_preset.json"); // Load default preset at startup
+    if (recordFile) startRecording(recordFile);
 #endif
 	
-	g_melody.startMelody(); // Start melody at app startup
-	std::cout << "Melody started - should play automatically" << std::endl;
+    // The controls mirror starts from the engine; its first snapshot is the baseline for later edits
+    {
+        std::lock_guard<std::mutex> lock(g_synthMutex);
+        g_controls.capture(g_synth);
+    }
+    g_controlsPublished = g_controls;
+    g_synth.controlLink.publish(g_controls);
+
+	g_synth.melody.startMelody(g_synth.scheduler); // Start melody at app startup
+	LOG_INFO("Melody started - should play automatically");
 
     while (!quit) {
         uint64_t currentTime = SDL_GetPerformanceCounter();
-        float perfFreq = (float)SDL_GetPerformanceFrequency(); // Moved perfFreq here
 
         // Update CPU usage periodically
         if (currentTime - lastCpuUpdateTime >= cpuUpdateInterval) {
@@ -1076,9 +656,15 @@ int main(int argc, char* argv[]) {
                 cpuUsage = 0.0f;
             }
 
-            // Update window title
+            // Update window title; the DSP figure is the audio callback's p99 share of its deadline
+            g_synth.profiler.report(g_dspReport, g_dspWindow);
+            g_synth.governor.report(g_dspReport.governor);
             char titleBuf[256];
-            snprintf(titleBuf, sizeof(titleBuf), "SDL3 Synthesizer | CPU: %.1f%%", cpuUsage);
+            if (DspProfiler::ENABLED) {
+                snprintf(titleBuf, sizeof(titleBuf), "SDL3 Synthesizer | CPU: %.1f%% | DSP: %.1f%%", cpuUsage, g_dspReport.load.p99);
+            } else {
+                snprintf(titleBuf, sizeof(titleBuf), "SDL3 Synthesizer | CPU: %.1f%%", cpuUsage);
+            }
             SDL_SetWindowTitle(window, titleBuf);
 
             lastTotalCpuTime = currentCpuTimes.first;
@@ -1086,11 +672,40 @@ int main(int argc, char* argv[]) {
             lastCpuUpdateTime = currentTime;
         }
 
-        // --- Melody Playback Logic ---
-        { // Lock scope for melody playback logic
-            std::lock_guard<std::mutex> lock(g_synthMutex);
-            g_melody.updateMelodyPlayback(currentTime, perfFreq, g_synth, g_roundRobinIndex);
-        } // End lock scope for melody playback logic
+#ifndef __EMSCRIPTEN__
+        if (g_metricsFile && DspProfiler::ENABLED) {
+            static DspProfiler::Window metricsWindow;
+            static Uint64 lastMetricsMs = SDL_GetTicks();
+            if (SDL_GetTicks() - lastMetricsMs >= METRICS_INTERVAL_MS) {
+                lastMetricsMs = SDL_GetTicks();
+                DspReport report;
+                g_synth.profiler.report(report, metricsWindow);
+                g_synth.governor.report(report.governor);
+                if (!DspProfiler::writeReport(g_metricsFile, report)) LOG_ERROR("Could not write %s", g_metricsFile);
+            }
+        }
+#endif
+
+        // Automatic period: step after underruns, or down while nothing plays
+        g_audioOutput.poll(g_telemetry.activeVoices == 0);
+        g_audioOutput.report(g_latency);
+
+        // Finished background preset jobs; free patch snapshots the audio thread has retired
+        Preset::poll(statusMessage);
+        if (g_recordRequested) {
+            g_recordRequested = false;
+            startRecording("");
+        }
+        std::string recorderMessage;
+        if (g_synth.recorder.poll(recorderMessage)) {
+            statusMessage = recorderMessage;
+            LOG_INFO("%s", recorderMessage.c_str());
+        }
+#ifdef __EMSCRIPTEN__
+        Log::drain(); // no drainer thread on the web build
+#endif
+        g_synth.patchExchange.collect();
+        g_synth.controlLink.collect();
 
 
         while (SDL_PollEvent(&e) != 0) {
@@ -1107,38 +722,27 @@ int main(int argc, char* argv[]) {
                 } else if (e.key.key == SDLK_SPACE) { // Toggle startup melody
                     std::lock_guard<std::mutex> lock(g_synthMutex);
                     // Always stop all playing notes first
-                    for (auto& voice : g_synth.voices) {
-                        voice.noteOff();
-                    }
-                    g_synth.noteToVoice.clear();
+                    g_synth.voiceAllocator.allNotesOff();
                     // Clear arpeggiator state
-                    g_synth.arpHeldNotes.clear();
-                    g_synth.arpActiveVoice = -1;
-                    g_synth.arpActiveMidi = -1;
+                    g_synth.arp.reset();
                     
-                    if (g_melody.melodyPlaying) {
+                    if (g_synth.melody.melodyPlaying) {
                         // Stop melody if currently playing
-                        g_melody.stopMelody();
+                        g_synth.melody.stopMelody();
                     } else {
                         // Start melody
-                        g_melody.startMelody();
+                        g_synth.melody.startMelody(g_synth.scheduler);
                     }
                 } else if (e.key.key == SDLK_F1) { // Detect F1 key press
                     std::lock_guard<std::mutex> lock(g_synthMutex);
                     // Stop melody if playing
-                    if (g_melody.melodyPlaying) {
-                        g_melody.stopMelody();
+                    if (g_synth.melody.melodyPlaying) {
+                        g_synth.melody.stopMelody();
                     }
                     // Stop all voices
-                    for (auto& voice : g_synth.voices) {
-                        voice.noteOff();
-                    }
+                    g_synth.voiceAllocator.allNotesOff();
                     // Clear arpeggiator state
-                    g_synth.arpHeldNotes.clear();
-                    g_synth.arpActiveVoice = -1;
-                    g_synth.arpActiveMidi = -1;
-                    // Clear note-to-voice mapping
-                    g_synth.noteToVoice.clear();
+                    g_synth.arp.reset();
                 }
             }
         }
@@ -1149,195 +753,99 @@ int main(int argc, char* argv[]) {
         ImGui::NewFrame();
 
         // Our synthesizer GUI will go here
+        // Engine-side parameter changes (presets, MIDI controllers) land in the mirror unless a control is held
+        g_synth.controlLink.pollTelemetry(g_telemetry);
+        if (!ImGui::IsAnyItemActive() && g_synth.controlLink.pollEngineState(g_controls)) g_controlsPublished = g_controls;
+
+        // The controls window edits only the mirror; no lock is held while it is built
         ImGui::Begin("Synthesizer Controls");
 		{
-            std::lock_guard<std::mutex> lock(g_synthMutex);
+            Patch& patch = g_controls.patch;
+            pollMidiLearn();
             ImGui::Text("Master Volume");
             // Gain presets buttons
             float _presets_vals[] = {0.0f, 0.12f, 0.25f, 0.5f, 0.75f, 0.87f, 1.0f};
             const char* _presets_lbl[] = {"0%","12%","25%","50%","75%","87%","100%"};
             for (int pi = 0; pi < 7; ++pi) {
-                if (ImGui::Button(_presets_lbl[pi])) { g_synth.masterVolume = _presets_vals[pi]; }
+                if (ImGui::Button(_presets_lbl[pi])) { patch.masterVolume = _presets_vals[pi]; }
                 if (pi < 6) ImGui::SameLine();
             }
-            ImGui::SliderFloat("##masterVolume", &g_synth.masterVolume, 0.0f, 1.0f);
+            ImGui::SliderFloat("##masterVolume", &patch.masterVolume, 0.0f, 1.0f);
+            midiLearnMenu(ParamId::MasterVolume);
 
             ImGui::Text("Pan");
-            ImGui::SliderFloat("##pan", &g_synth.pan, -1.0f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
-
-            for (int i = 0; i < 1; ++i) { // Controls for Voice 1 only
-                if (i >= g_synth.voices.size()) break;
-                ImGui::PushID(i);
+            ImGui::SliderFloat("##pan", &patch.pan, -1.0f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+            midiLearnMenu(ParamId::Pan);
+
+            ImGui::Text("Voices: %d / %d sounding", g_telemetry.activeVoices, g_telemetry.numVoices);
+            ImGui::PlotHistogram("Envelopes", g_telemetry.envelope, std::min(g_telemetry.numVoices, Telemetry::MAX_VOICES),
+                                 0, nullptr, 0.0f, 1.0f, ImVec2(0.0f, 40.0f));
+            ImGui::ProgressBar(g_telemetry.peak[0], ImVec2(-1.0f, 0.0f), "L");
+            ImGui::ProgressBar(g_telemetry.peak[1], ImVec2(-1.0f, 0.0f), "R");
+
+            // One parameter set, played by every voice
+            {
+                VoiceParams& voice = patch.voice;
                 ImGui::Separator();
-                ImGui::Text("Voice %d", i + 1);
-
-                float freq = g_synth.voices[i].getFrequency();
-                if (ImGui::SliderFloat("Frequency", &freq, 20.0f, 20000.0f, "%.1f Hz")) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setFrequency(freq);
-                    }
-                }
-
-                float amp = g_synth.voices[i].getAmplitude();
-                if (ImGui::SliderFloat("Gain", &amp, 0.0f, 1.0f)) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setAmplitude(amp);
-                    }
-                }
-                float mix = g_synth.voices[i].getMixLevel();
-                if (ImGui::SliderFloat("Mix", &mix, 0.0f, 1.0f)) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setMixLevel(mix);
-                    }
-                }
+                ImGui::Text("Voice");
 
-                // Frequency (base)
-                // single freq control shown below with per-voice controls
+                ImGui::SliderFloat("Frequency", &g_controls.voiceFrequency, 20.0f, 20000.0f, "%.1f Hz");
+                ImGui::SliderFloat("Gain", &g_controls.voiceAmplitude, 0.0f, 1.0f);
+                ImGui::SliderFloat("Mix", &voice.mixLevel, 0.0f, 1.0f);
 
                 // Per-VCO controls
                 const char* vcoWaveNames[] = {"Sine","Square","Saw","Triangle","Saw Up","Saw Down","Pulse","Random"};
                 for (int vi_vco = 0; vi_vco < 3; ++vi_vco) {
+                    VcoParams& vco = voice.vcos[vi_vco];
                     ImGui::PushID(vi_vco);
                     ImGui::Separator();
                     char title[32]; snprintf(title, sizeof(title), "VCO %d", vi_vco+1);
                     ImGui::Text("%s", title);
-                    int widx = g_synth.voices[i].getVcoWaveform(vi_vco);
-                    if (ImGui::Combo("Waveform", &widx, vcoWaveNames, IM_ARRAYSIZE(vcoWaveNames))) {
-                        for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                            g_synth.voices[voiceIdx].setVcoWaveform(vi_vco, static_cast<Oscillator::WaveformType>(widx));
-                        }
-                    }
-                    float vmix = g_synth.voices[i].getVcoMix(vi_vco);
-                    if (ImGui::SliderFloat("VCO Gain", &vmix, 0.0f, 1.0f)) {
-                        for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                            g_synth.voices[voiceIdx].setVcoMix(vi_vco, vmix);
-                        }
-                    }
-                    float vpitch = g_synth.voices[i].getVcoPitchShift(vi_vco);
-                    if (ImGui::SliderFloat("VCO Pitch (st)", &vpitch, -36.0f, 36.0f)) {
-                        for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                            g_synth.voices[voiceIdx].setVcoPitchShift(vi_vco, vpitch);
-                        }
-                    }
-                    float vdet = g_synth.voices[i].getVcoDetune(vi_vco);
-                    if (ImGui::SliderFloat("VCO Detune (c)", &vdet, -100.0f, 100.0f)) {
-                        for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                            g_synth.voices[voiceIdx].setVcoDetune(vi_vco, vdet);
-                        }
-                    }
-                    float vphase = g_synth.voices[i].getVcoPhaseMs(vi_vco);
-                    if (ImGui::SliderFloat("Phase (ms)", &vphase, -50.0f, 50.0f)) {
-                        for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                            g_synth.voices[voiceIdx].setVcoPhaseMs(vi_vco, vphase);
-                        }
-                    }
-                    float vpw = g_synth.voices[i].getVcoPulseWidth(vi_vco);
-                    if (ImGui::SliderFloat("Pulse Width", &vpw, 0.01f, 0.99f)) {
-                        for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                            g_synth.voices[voiceIdx].setVcoPulseWidth(vi_vco, vpw);
-                        }
-                    }
-                    float vpan = g_synth.voices[i].getVcoPan(vi_vco);
-                    if (ImGui::SliderFloat("Pan", &vpan, -1.0f, 1.0f, "%.2f")) {
-                        for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                            g_synth.voices[voiceIdx].setVcoPan(vi_vco, vpan);
-                        }
-                    }
+                    ImGui::Combo("Waveform", &vco.waveform, vcoWaveNames, IM_ARRAYSIZE(vcoWaveNames));
+                    ImGui::SliderFloat("VCO Gain", &vco.mix, 0.0f, 1.0f);
+                    ImGui::SliderFloat("VCO Pitch (st)", &vco.pitchShift, -36.0f, 36.0f);
+                    ImGui::SliderFloat("VCO Detune (c)", &vco.detune, -100.0f, 100.0f);
+                    ImGui::SliderFloat("Phase (ms)", &vco.phaseMs, -50.0f, 50.0f);
+                    ImGui::SliderFloat("Pulse Width", &vco.pulseWidth, 0.01f, 0.99f);
+                    ImGui::SliderFloat("Pan", &vco.pan, -1.0f, 1.0f, "%.2f");
                     ImGui::PopID();
                 }
 
-                // Per-voice unison controls (0 = use global)
-                int vUnison = g_synth.voices[i].getUnisonCount();
-                if (ImGui::SliderInt("Unison Voices (per voice, 0=global)", &vUnison, 0, 8)) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setUnisonCount(vUnison);
-                    }
-                }
+                // Voice unison controls (0 = use global)
+                ImGui::SliderInt("Unison Voices (per voice, 0=global)", &voice.unisonCount, 0, 8);
                 const char* vSpreadNames[] = {"Global","Off","Tight","Medium","Wide","Extra Wide"};
-                int vSpreadUi = g_synth.voices[i].getUnisonSpreadIndex() + 1; // -1->0
+                int vSpreadUi = voice.unisonSpreadIndex + 1; // -1->0
                 if (ImGui::Combo("Unison Spread (per voice)", &vSpreadUi, vSpreadNames, IM_ARRAYSIZE(vSpreadNames))) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setUnisonSpreadIndex(vSpreadUi - 1);
-                    }
+                    voice.unisonSpreadIndex = vSpreadUi - 1;
                 }
 
                 // ADSR Controls
                 ImGui::Text("ADSR Envelope");
-                float attack = g_synth.voices[i].getAttackTime();
-                if (ImGui::SliderFloat("Attack", &attack, 0.0f, 2.0f, "%.2f s")) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setAttackTime(attack);
-                    }
-                }
-                float decay = g_synth.voices[i].getDecayTime();
-                if (ImGui::SliderFloat("Decay", &decay, 0.0f, 2.0f, "%.2f s")) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setDecayTime(decay);
-                    }
-                }
-                float sustain = g_synth.voices[i].getSustainLevel();
-                if (ImGui::SliderFloat("Sustain", &sustain, 0.0f, 1.0f, "%.2f")) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setSustainLevel(sustain);
-                    }
-                }
-                float release = g_synth.voices[i].getReleaseTime();
-                if (ImGui::SliderFloat("Release", &release, 0.0f, 5.0f, "%.2f s")) {
-                    for (size_t voiceIdx = 0; voiceIdx < g_synth.voices.size(); ++voiceIdx) {
-                        g_synth.voices[voiceIdx].setReleaseTime(release);
-                    }
-                }
-
-                ImGui::PopID();
+                ImGui::SliderFloat("Attack", &voice.attackTime, 0.0f, 2.0f, "%.2f s");
+                midiLearnMenu(ParamId::VoiceAttack);
+                ImGui::SliderFloat("Decay", &voice.decayTime, 0.0f, 2.0f, "%.2f s");
+                midiLearnMenu(ParamId::VoiceDecay);
+                ImGui::SliderFloat("Sustain", &voice.sustainLevel, 0.0f, 1.0f, "%.2f");
+                midiLearnMenu(ParamId::VoiceSustain);
+                ImGui::SliderFloat("Release", &voice.releaseTime, 0.0f, 5.0f, "%.2f s");
+                midiLearnMenu(ParamId::VoiceRelease);
             }
 
             // Unison
             ImGui::Separator();
             ImGui::Text("Unison");
-            ImGui::SliderInt("Unison Voices", &g_synth.unisonCount, 1, 8);
+            ImGui::SliderInt("Unison Voices", &patch.unisonCount, 1, 8);
             const char* spreadNames[] = {"Off","Tight","Medium","Wide","Extra Wide"};
-            ImGui::Combo("Unison Spread", &g_synth.unisonSpreadIndex, spreadNames, IM_ARRAYSIZE(spreadNames));
+            ImGui::Combo("Unison Spread", &patch.unisonSpreadIndex, spreadNames, IM_ARRAYSIZE(spreadNames));
 
 #ifndef __EMSCRIPTEN__
-            // Synchronization and Preset Save/Load
-            ImGui::Separator();
-            if (ImGui::Button("Copy Voice 1 Params to All")) {
-                int nVoices = (int)g_synth.voices.size();
-                if (nVoices > 1) { // Only copy if there are other voices
-                    Voice& sourceVoice = g_synth.voices[0]; // Voice 1 (0-indexed)
-
-                    for (int i = 1; i < nVoices; ++i) {
-                        Voice& destVoice = g_synth.voices[i];
-
-                        // Copy ADSR parameters
-                        destVoice.setAttackTime(sourceVoice.getAttackTime());
-                        destVoice.setDecayTime(sourceVoice.getDecayTime());
-                        destVoice.setSustainLevel(sourceVoice.getSustainLevel());
-                        destVoice.setReleaseTime(sourceVoice.getReleaseTime());
-                        
-                        // Copy Mix Level
-                        destVoice.setMixLevel(sourceVoice.getMixLevel());
-
-                        // Copy Unison parameters
-                        destVoice.setUnisonCount(sourceVoice.getUnisonCount());
-                        destVoice.setUnisonSpreadIndex(sourceVoice.getUnisonSpreadIndex());
-
-                        // Copy VCO parameters (assuming 3 VCOs per voice)
-                        for (int vco_idx = 0; vco_idx < 3; ++vco_idx) {
-                            destVoice.setVcoWaveform(vco_idx, static_cast<Oscillator::WaveformType>(sourceVoice.getVcoWaveform(vco_idx)));
-                            destVoice.setVcoMix(vco_idx, sourceVoice.getVcoMix(vco_idx));
-                            destVoice.setVcoDetune(vco_idx, sourceVoice.getVcoDetune(vco_idx));
-                            destVoice.setVcoPhaseMs(vco_idx, sourceVoice.getVcoPhaseMs(vco_idx));
-                            destVoice.setVcoPulseWidth(vco_idx, sourceVoice.getVcoPulseWidth(vco_idx));
-                            destVoice.setVcoPitchShift(vco_idx, sourceVoice.getVcoPitchShift(vco_idx));
-                        }
-                    }
-                }
-            }
-
+            // Preset Save/Load
             ImGui::Separator();
             ImGui::Text("Presets");
             static int currentPreset = 0;
+            ImGui::InputText("Search", g_presetSearch, sizeof(g_presetSearch));
+            refreshPresetFiles();
+            if (currentPreset >= (int)presetFiles.size()) currentPreset = 0;
             if (ImGui::Combo("Preset", &currentPreset, [](void* data, int idx, const char** out_text) {
                 std::vector<std::string>* files = (std::vector<std::string>*)data;
                 if (idx < 0 || idx >= (int)files->size()) return false;
@@ -1347,13 +855,14 @@ int main(int argc, char* argv[]) {
                 strcpy(g_presetFilename, presetFiles[currentPreset].c_str());
             }
             if (ImGui::Button("Save")) {
-                Preset::save(g_presetFilename);
-                statusMessage = "Preset saved: " + std::string(g_presetFilename);
+                Preset::saveAsync(g_presetFilename, patch);
+                statusMessage = "Saving preset: " + std::string(g_presetFilename);
             }
             ImGui::SameLine();
             if (ImGui::Button("Load")) {
-                Preset::load(g_presetFilename);
-                statusMessage = "Preset loaded: " + std::string(g_presetFilename);
+                // Parsed on the preset worker and swapped in by the audio thread between blocks
+                Preset::loadAsync(g_presetFilename, patch);
+                statusMessage = "Loading preset: " + std::string(g_presetFilename);
             }
             ImGui::SameLine();
             if (ImGui::Button("Save...")) {
@@ -1363,210 +872,369 @@ int main(int argc, char* argv[]) {
             if (ImGui::Button("Load...")) {
                 SDL_ShowOpenFileDialog(fileDialogCallback, (void*)1, g_window, filters, 1, cwd.c_str(), false);
             }
+
+            // Binary bank: patches are read straight from the mapped file, no parsing
+            static int currentBankPatch = -1;
+            std::string bankLabel = currentBankPatch >= 0 && currentBankPatch < g_presetBank.size()
+                ? std::string(g_presetBank.name(currentBankPatch)) : std::string("(none)");
+            if (ImGui::BeginCombo("Bank", bankLabel.c_str())) {
+                for (int i = 0; i < g_presetBank.size(); ++i) {
+                    std::string label = std::string(g_presetBank.name(i)) + "##" + std::to_string(i);
+                    if (ImGui::Selectable(label.c_str(), i == currentBankPatch)) {
+                        currentBankPatch = i;
+                        Patch* bankPatch = new Patch(patch); // what the record leaves out stays as it is
+                        g_presetBank.get(i, *bankPatch);
+                        statusMessage = "Bank patch: " + bankPatch->name;
+                        g_synth.patchExchange.publish(bankPatch);
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::Button("Build Bank")) {
+                // Built next to the bank on the preset worker; the open bank stays in use until the new file is complete
+                std::string tempFile = std::string(PRESET_BANK_FILE) + ".tmp";
+                Preset::runAsync([paths = g_presetIndex.paths(), tempFile](std::string& status) {
+                    if (PresetBank::importJson(paths, tempFile)) return true;
+                    status = "Failed to build preset bank";
+                    return false;
+                }, [tempFile](bool ok, std::string& status) {
+                    if (!ok) return;
+                    g_presetBank.close();
+                    currentBankPatch = -1;
+                    std::error_code ec;
+                    std::filesystem::rename(tempFile, PRESET_BANK_FILE, ec);
+                    if (!ec && g_presetBank.open(PRESET_BANK_FILE)) {
+                        status = "Bank built with " + std::to_string(g_presetBank.size()) + " patches";
+                    } else {
+                        status = "Failed to build preset bank";
+                    }
+                });
+                statusMessage = "Building preset bank: " + std::string(PRESET_BANK_FILE);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Export Bank")) {
+                Preset::runAsync([](std::string& status) {
+                    int count = PresetBank::exportJson(PRESET_BANK_FILE, "bank_export");
+                    status = count < 0 ? std::string("No preset bank to export")
+                        : "Exported " + std::to_string(count) + " patches to bank_export";
+                    return count >= 0;
+                });
+                statusMessage = "Exporting preset bank to bank_export";
+            }
 #endif
 			
             // Modulation
             ImGui::Separator();
             ImGui::Text("Modulation");
-            ImGui::SliderFloat("Pitch Bend Range (st)", &g_synth.pitchBendRange, 0.0f, 12.0f);
-            ImGui::SliderFloat("Mod LFO Rate (Hz)", &g_synth.modLfoRate, 0.0f, 20.0f);
+            ImGui::SliderFloat("Pitch Bend Range (st)", &patch.pitchBendRange, 0.0f, 12.0f);
+            midiLearnMenu(ParamId::PitchBendRange);
+            ImGui::SliderFloat("Mod LFO Rate (Hz)", &patch.modLfoRate, 0.0f, 20.0f);
+            midiLearnMenu(ParamId::ModLfoRate);
+
+            // Multitimbral parts
+            ImGui::Separator();
+            ImGui::Text("Parts");
+            if (ImGui::Checkbox("Multitimbral (MIDI channel = part)", &patch.multitimbral)) {
+                g_engineActions.push_back([] { g_synth.voiceAllocator.allNotesOff(); });
+            }
+            if (patch.multitimbral) {
+                static int currentPart = 1;
+                ImGui::SliderInt("Part", &currentPart, 1, NUM_PARTS);
+                Part& part = patch.parts[currentPart - 1];
+                ImGui::Text("Sounding voices: %d", g_telemetry.partVoices[currentPart - 1]);
+                ImGui::Checkbox("Mute Part", &part.muted);
+                ImGui::SliderFloat("Part Volume", &part.volume, 0.0f, 2.0f);
+                ImGui::SliderFloat("Part Pan", &part.pan, -1.0f, 1.0f);
+                ImGui::SliderFloat("Part FX Send", &part.fxSend, 0.0f, 1.0f);
+                ImGui::SliderInt("Part Voice Budget", &part.maxVoices, 1, std::max(1, g_telemetry.numVoices));
+                if (ImGui::Button("Copy Voice to Part")) {
+                    part.voice = patch.voice;
+                }
+#ifndef __EMSCRIPTEN__
+                ImGui::SameLine();
+                if (ImGui::Button("Load Preset into Part")) {
+                    Preset::loadPartAsync(g_presetFilename, patch, currentPart - 1);
+                    statusMessage = "Loading preset into part " + std::to_string(currentPart) + ": " + g_presetFilename;
+                }
+#endif
+            }
+
+            // MPE
+            ImGui::Separator();
+            ImGui::Text("MPE");
+            ImGui::Checkbox("MPE Enabled", &g_controls.mpeEnabled);
+            if (g_controls.mpeEnabled) {
+                if (ImGui::SliderInt("Lower Zone Members", &g_controls.mpeLowerMembers, 0, 15)) {
+                    g_controls.mpeUpperMembers = std::min(g_controls.mpeUpperMembers, 14 - g_controls.mpeLowerMembers);
+                }
+                if (ImGui::SliderInt("Upper Zone Members", &g_controls.mpeUpperMembers, 0, 15)) {
+                    g_controls.mpeLowerMembers = std::min(g_controls.mpeLowerMembers, 14 - g_controls.mpeUpperMembers);
+                }
+                ImGui::SliderFloat("Member Bend Range (st)", &g_controls.mpeMemberBendRange, 1.0f, 96.0f);
+                ImGui::SliderFloat("Pressure Depth", &g_controls.mpePressureDepth, 0.0f, 2.0f);
+            }
+
+            // MIDI learn
+            ImGui::Separator();
+            ImGui::Text("MIDI Mappings");
+            ImGui::Text("Controller messages merged: %llu, dropped: %llu",
+                        (unsigned long long)g_synth.midiQueue.mergedCount(), (unsigned long long)g_synth.midiQueue.droppedCount());
+            ParamId learning = g_synth.midiMapper.learning();
+            if (learning != ParamId::None) {
+                ImGui::Text("Learning %s: move a control", paramInfo(learning).label);
+                ImGui::SameLine();
+                if (ImGui::Button("Cancel Learn")) g_synth.midiMapper.disarm();
+            }
+            static int learnParam = 0;
+            ImGui::Combo("Learn Parameter", &learnParam, [](void*, int idx, const char** out_text) {
+                *out_text = paramInfo((ParamId)idx).label;
+                return true;
+            }, nullptr, (int)ParamId::Count);
+            ImGui::SameLine();
+            if (ImGui::Button("Learn")) armMidiLearn((ParamId)learnParam);
+            for (int i = 0; i < patch.midiMap.size(); ++i) {
+                MidiMapping& m = patch.midiMap[i];
+                const char* sourceNames[] = {"CC", "CC14", "NRPN"};
+                ImGui::PushID(i);
+                ImGui::Text("%s <- Ch %d %s %d", paramInfo(m.param).label, m.channel + 1, sourceNames[(int)m.source], m.number);
+                const ParamInfo& info = paramInfo(m.param);
+                ImGui::SliderFloat("Min", &m.minValue, info.minValue, info.maxValue);
+                ImGui::SliderFloat("Max", &m.maxValue, info.minValue, info.maxValue);
+                int curve = (int)m.curve;
+                const char* curveNames[] = {"Linear", "Exponential", "Inverted"};
+                if (ImGui::Combo("Curve", &curve, curveNames, IM_ARRAYSIZE(curveNames))) {
+                    m.curve = (MidiCurve)curve;
+                }
+                if (ImGui::Button("Remove")) {
+                    patch.midiMap.remove(m.param);
+                    ImGui::PopID();
+                    break;
+                }
+                ImGui::PopID();
+            }
+
+            // Recording of the master bus
+            ImGui::Separator();
+            ImGui::Text("Recorder");
+            if (g_synth.recorder.recording()) {
+                if (ImGui::Button("Stop Recording")) g_engineActions.push_back([] { g_synth.recorder.stop(); });
+                ImGui::SameLine();
+                ImGui::Text("%.1f s", g_synth.recorder.framesRecorded() / (float)SAMPLE_RATE);
+            } else if (!g_synth.recorder.busy()) {
+                if (ImGui::Button("Record")) g_recordRequested = true;
+                ImGui::SameLine();
+                ImGui::Checkbox("Voice Stems", &g_recordStems);
+            } else {
+                ImGui::Text("Finishing recording...");
+            }
+            if (g_synth.recorder.overrunFrames() > 0) {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "Disk overruns: %llu frames lost",
+                                   (unsigned long long)g_synth.recorder.overrunFrames());
+            }
+
+            // MIDI file playback
+            ImGui::Separator();
+            ImGui::Text("MIDI File");
+            if (ImGui::Button("Open MIDI File...")) {
+                SDL_ShowOpenFileDialog(midiFileDialogCallback, nullptr, g_window, midiFileFilters, 1, cwd.c_str(), false);
+            }
+            std::shared_ptr<const MidiFile> song;
+            std::string songName;
+            {
+                std::lock_guard<std::mutex> songLock(g_songMutex);
+                song = g_song;
+                songName = g_songName;
+            }
+            if (song) {
+                ImGui::SameLine();
+                bool songPlaying = g_telemetry.songPlaying;
+                if (ImGui::Button(songPlaying ? "Stop##song" : "Play##song")) {
+                    g_engineActions.push_back([songPlaying, song] {
+                        if (songPlaying) {
+                            g_synth.songPlayer.stop();
+                        } else {
+                            g_synth.melody.stopMelody();
+                            g_synth.songPlayer.play(song, g_synth.sampleClock);
+                        }
+                        g_synth.voiceAllocator.allNotesOff();
+                    });
+                }
+                float position = songPlaying ? std::min(g_telemetry.songPosition, song->lengthFrames) / (float)SAMPLE_RATE : 0.0f;
+                ImGui::Text("%s  %.1f / %.1f s, %zu events", songName.c_str(), position,
+                            song->lengthFrames / (float)SAMPLE_RATE, song->events.size());
+            }
 
             // Arpeggiator
             ImGui::Separator();
             ImGui::Text("Arpeggiator");
-            bool wasArpEnabled = g_synth.arpEnabled;
-            if (ImGui::Checkbox("Enabled", &g_synth.arpEnabled) && wasArpEnabled != g_synth.arpEnabled) {
+            if (ImGui::Checkbox("Enabled", &patch.arpEnabled)) {
                 // State changed, reset everything to avoid stuck notes
-                for (auto& voice : g_synth.voices) {
-                    voice.noteOff();
-                }
-                if (g_synth.arpActiveVoice != -1) {
-                    g_synth.voices[g_synth.arpActiveVoice].noteOff();
-                    g_synth.arpActiveVoice = -1;
-                }
-                g_synth.arpHeldNotes.clear();
-                g_synth.noteToVoice.clear();
+                g_engineActions.push_back([] {
+                    g_synth.voiceAllocator.allNotesOff();
+                    g_synth.arp.reset();
+                });
             }
 
-            if (g_synth.arpEnabled) {
-                ImGui::SliderFloat("BPM", &g_synth.arpBpm, 30.0f, 240.0f);
-                ImGui::SliderFloat("Gate", &g_synth.arpGate, 0.01f, 1.0f);
+            if (patch.arpEnabled) {
+                ImGui::SliderFloat("BPM", &patch.arpBpm, 30.0f, 240.0f);
+                midiLearnMenu(ParamId::ArpBpm);
+                ImGui::SliderFloat("Gate", &patch.arpGate, 0.01f, 1.0f);
+                midiLearnMenu(ParamId::ArpGate);
                 const char* arpDir[] = {"Up", "Down", "Up-Down", "Random"};
-                ImGui::Combo("Direction", &g_synth.arpDirection, arpDir, IM_ARRAYSIZE(arpDir));
-                ImGui::SliderInt("Range (Octaves)", &g_synth.arpRange, 1, 4);
-                ImGui::Checkbox("Hold", &g_synth.arpHold);
+                ImGui::Combo("Direction", &patch.arpDirection, arpDir, IM_ARRAYSIZE(arpDir));
+                ImGui::SliderInt("Range (Octaves)", &patch.arpRange, 1, 4);
+                ImGui::Checkbox("Hold", &patch.arpHold);
+                ImGui::SliderFloat("Swing", &patch.arpSwing, 0.0f, 0.5f);
+                midiLearnMenu(ParamId::ArpSwing);
+                ImGui::SliderInt("Ratchet", &patch.arpRatchet, 1, 4);
             }
 
             // Effects
             ImGui::Separator();
             ImGui::Text("Effects");
 
-            if (ImGui::Checkbox("Flanger", &g_synth.flangerEnabled)) {}
-            if (g_synth.flangerEnabled) {
-                ImGui::SliderFloat("Flanger Rate (Hz)", &g_synth.flangerRate, 0.01f, 10.0f);
-                ImGui::SliderFloat("Flanger Depth (s)", &g_synth.flangerDepth, 0.0f, 0.02f);
-                ImGui::SliderFloat("Flanger Mix", &g_synth.flangerMix, 0.0f, 1.0f);
+            if (ImGui::Checkbox("Flanger", &patch.flangerEnabled)) {}
+            if (patch.flangerEnabled) {
+                ImGui::SliderFloat("Flanger Rate (Hz)", &patch.flangerRate, 0.01f, 10.0f);
+                midiLearnMenu(ParamId::FlangerRate);
+                ImGui::SliderFloat("Flanger Depth (s)", &patch.flangerDepth, 0.0f, 0.02f);
+                midiLearnMenu(ParamId::FlangerDepth);
+                ImGui::SliderFloat("Flanger Mix", &patch.flangerMix, 0.0f, 1.0f);
+                midiLearnMenu(ParamId::FlangerMix);
             }
 
-            if (ImGui::Checkbox("Delay", &g_synth.delayEnabled)) {}
-            if (g_synth.delayEnabled) {
-                ImGui::SliderFloat("Delay Time (s)", &g_synth.delayTimeSec, 0.01f, 2.0f);
-                ImGui::SliderFloat("Delay Feedback", &g_synth.delayFeedback, 0.0f, 0.95f);
-                ImGui::SliderFloat("Delay Mix", &g_synth.delayMix, 0.0f, 1.0f);
+            if (ImGui::Checkbox("Delay", &patch.delayEnabled)) {}
+            if (patch.delayEnabled) {
+                ImGui::SliderFloat("Delay Time (s)", &patch.delayTimeSec, 0.01f, 2.0f);
+                midiLearnMenu(ParamId::DelayTime);
+                ImGui::SliderFloat("Delay Feedback", &patch.delayFeedback, 0.0f, 0.95f);
+                midiLearnMenu(ParamId::DelayFeedback);
+                ImGui::SliderFloat("Delay Mix", &patch.delayMix, 0.0f, 1.0f);
+                midiLearnMenu(ParamId::DelayMix);
             }
 
-            if (ImGui::Checkbox("Reverb", &g_synth.reverbEnabled)) {}
-            if (g_synth.reverbEnabled) {
-                ImGui::SliderFloat("Size", &g_synth.reverbSize, 0.0f, 1.0f);
-                ImGui::SliderFloat("Damp", &g_synth.reverbDamp, 0.0f, 1.0f);
-                ImGui::SliderFloat("Pre-Delay", &g_synth.reverbDelay, 0.0f, 0.2f, "%.3f");
-                ImGui::SliderFloat("Diffuse", &g_synth.reverbDiffuse, 0.0f, 1.0f);
-                ImGui::SliderFloat("Stereo", &g_synth.reverbStereo, 0.0f, 1.0f);
-                ImGui::SliderFloat("Dry Mix", &g_synth.reverbDryMix, 0.0f, 1.0f);
-                ImGui::SliderFloat("Wet Mix", &g_synth.reverbWetMix, 0.0f, 1.0f);
+            if (ImGui::Checkbox("Reverb", &patch.reverbEnabled)) {}
+            if (patch.reverbEnabled) {
+                ImGui::SliderFloat("Size", &patch.reverbSize, 0.0f, 1.0f);
+                midiLearnMenu(ParamId::ReverbSize);
+                ImGui::SliderFloat("Damp", &patch.reverbDamp, 0.0f, 1.0f);
+                midiLearnMenu(ParamId::ReverbDamp);
+                ImGui::SliderFloat("Pre-Delay", &patch.reverbDelay, 0.0f, 0.2f, "%.3f");
+                ImGui::SliderFloat("Diffuse", &patch.reverbDiffuse, 0.0f, 1.0f);
+                midiLearnMenu(ParamId::ReverbDiffuse);
+                ImGui::SliderFloat("Stereo", &patch.reverbStereo, 0.0f, 1.0f);
+                ImGui::SliderFloat("Dry Mix", &patch.reverbDryMix, 0.0f, 1.0f);
+                midiLearnMenu(ParamId::ReverbDryMix);
+                ImGui::SliderFloat("Wet Mix", &patch.reverbWetMix, 0.0f, 1.0f);
+                midiLearnMenu(ParamId::ReverbWetMix);
             }
 
              // Analog Filter
              ImGui::Separator();
              ImGui::Text("Analog Filter");
-             if (ImGui::Checkbox("Filter Enabled", &g_synth.filterEnabled)) {}
-             static float cutoff = g_synth.filter.getCutoff();
-             if (ImGui::SliderFloat("Cutoff (Hz)", &cutoff, 20.0f, 20000.0f)) {
-                 g_synth.filter.setCutoff(cutoff);
-             }
-             ImGui::Text("Cutoff: %.1f Hz", g_synth.filter.getCutoff());
+             if (ImGui::Checkbox("Filter Enabled", &patch.filterEnabled)) {}
+             ImGui::SliderFloat("Cutoff (Hz)", &patch.filterCutoff, 20.0f, 20000.0f);
+             midiLearnMenu(ParamId::FilterCutoff);
+             ImGui::Text("Cutoff: %.1f Hz", patch.filterCutoff);
 
-             static float resonance = g_synth.filter.getResonance();
-             if (ImGui::SliderFloat("Resonance (Q)", &resonance, 0.1f, 10.0f)) {
-                 g_synth.filter.setResonance(resonance);
-             }
-             ImGui::Text("Resonance: %.2f", g_synth.filter.getResonance());
+             ImGui::SliderFloat("Resonance (Q)", &patch.filterResonance, 0.1f, 10.0f);
+             midiLearnMenu(ParamId::FilterResonance);
+             ImGui::Text("Resonance: %.2f", patch.filterResonance);
 
-             static float drive = g_synth.filter.getDrive();
-             if (ImGui::SliderFloat("Drive", &drive, 0.1f, 10.0f)) {
-                 g_synth.filter.setDrive(drive);
-             }
-             ImGui::Text("Drive: %.2f", g_synth.filter.getDrive());
+             ImGui::SliderFloat("Drive", &patch.filterDrive, 0.1f, 10.0f);
+             midiLearnMenu(ParamId::FilterDrive);
+             ImGui::Text("Drive: %.2f", patch.filterDrive);
 
-             static float inertial = g_synth.filter.getInertial();
-             if (ImGui::SliderFloat("Inertial", &inertial, 0.0f, 0.99f)) {
-                 g_synth.filter.setInertial(inertial);
-			 }
+             ImGui::SliderFloat("Inertial", &patch.filterInertial, 0.0f, 0.99f);
 
-             static int oversampling = g_synth.filter.getOversampling();
+             int oversampling = patch.filterOversampling == 0 ? 0 : (int)std::log2(patch.filterOversampling);
              if (ImGui::Combo("Oversampling", &oversampling, "0\0x2\0x4\0x8\0\0")) {
-                 g_synth.filter.setOversampling(oversampling == 0 ? 0 : (1 << (oversampling))); // 0,2,4,8
+                 patch.filterOversampling = oversampling == 0 ? 0 : (1 << (oversampling)); // 0,2,4,8
              }
-             ImGui::Text("Oversampling: x%d", g_synth.filter.getOversampling());
+             ImGui::Text("Oversampling: x%d", patch.filterOversampling);
 					 
               // Mixer / Bus compression
  			 ImGui::Separator();
  			 ImGui::Text("Mixer / Bus Compression");
- 			 ImGui::Checkbox("Compressor", &g_synth.compressorEnabled);
- 			 if (g_synth.compressorEnabled) {
- 				 ImGui::SliderFloat("Threshold (dB)", &g_synth.compressorThresholdDb, -60.0f, 0.0f);
- 				 ImGui::SliderFloat("Ratio", &g_synth.compressorRatio, 1.0f, 20.0f);
- 				 ImGui::SliderFloat("Attack (ms)", &g_synth.compressorAttackMs, 0.1f, 200.0f);
- 				 ImGui::SliderFloat("Release (ms)", &g_synth.compressorReleaseMs, 5.0f, 2000.0f);
- 				 ImGui::SliderFloat("Makeup (dB)", &g_synth.compressorMakeupDb, -12.0f, 12.0f);
+ 			 ImGui::Checkbox("Compressor", &patch.compressorEnabled);
+ 			 if (patch.compressorEnabled) {
+ 				 ImGui::SliderFloat("Threshold (dB)", &patch.compressorThresholdDb, -60.0f, 0.0f);
+ 				 midiLearnMenu(ParamId::CompressorThreshold);
+ 				 ImGui::SliderFloat("Ratio", &patch.compressorRatio, 1.0f, 20.0f);
+ 				 midiLearnMenu(ParamId::CompressorRatio);
+ 				 ImGui::SliderFloat("Attack (ms)", &patch.compressorAttackMs, 0.1f, 200.0f);
+ 				 ImGui::SliderFloat("Release (ms)", &patch.compressorReleaseMs, 5.0f, 2000.0f);
+ 				 ImGui::SliderFloat("Makeup (dB)", &patch.compressorMakeupDb, -12.0f, 12.0f);
+ 				 midiLearnMenu(ParamId::CompressorMakeup);
               }
 
               // DC Filter
               ImGui::Separator();
               ImGui::Text("DC Filter");
-              ImGui::Checkbox("DC Filter", &g_synth.dcFilterEnabled);
-              if (g_synth.dcFilterEnabled) {
-                  ImGui::SliderFloat("DC Filter Alpha", &g_synth.dcFilterAlpha, 0.9f, 0.999f);
+              ImGui::Checkbox("DC Filter", &patch.dcFilterEnabled);
+              if (patch.dcFilterEnabled) {
+                  ImGui::SliderFloat("DC Filter Alpha", &patch.dcFilterAlpha, 0.9f, 0.999f);
               }
 
               // Soft Clipping
               ImGui::Separator();
               ImGui::Text("Soft Clipping");
-              ImGui::Checkbox("Soft Clipping", &g_synth.softClipEnabled);
-              if (g_synth.softClipEnabled) {
-                  ImGui::SliderFloat("Soft Clip Drive", &g_synth.softClipDrive, 1.0f, 10.0f);
+              ImGui::Checkbox("Soft Clipping", &patch.softClipEnabled);
+              if (patch.softClipEnabled) {
+                  ImGui::SliderFloat("Soft Clip Drive", &patch.softClipDrive, 1.0f, 10.0f);
               }
 
               // Auto Gain
               ImGui::Separator();
               ImGui::Text("Auto Gain");
-              ImGui::Checkbox("Auto Gain", &g_synth.autoGainEnabled);
-              if (g_synth.autoGainEnabled) {
-                  ImGui::SliderFloat("Target RMS", &g_synth.autoGainTargetRMS, 0.1f, 0.8f);
-                  ImGui::SliderFloat("Auto Gain Alpha", &g_synth.autoGainAlpha, 0.9f, 0.999f);
+              ImGui::Checkbox("Auto Gain", &patch.autoGainEnabled);
+              if (patch.autoGainEnabled) {
+                  ImGui::SliderFloat("Target RMS", &patch.autoGainTargetRMS, 0.1f, 0.8f);
+                  ImGui::SliderFloat("Auto Gain Alpha", &patch.autoGainAlpha, 0.9f, 0.999f);
               }
 
   			 ImGui::End();
 		}
 
+        // Edits reach the engine as one snapshot per frame; the rare actions that need the engine
+        // itself run after the frame is built, under a short lock
+        if (!(g_controls == g_controlsPublished)) {
+            g_synth.controlLink.publish(g_controls);
+            g_controlsPublished = g_controls;
+        }
+        if (!g_engineActions.empty()) {
+            std::lock_guard<std::mutex> lock(g_synthMutex);
+            for (auto& action : g_engineActions) action();
+            g_engineActions.clear();
+        }
 
 
-         // Visualization update: compute FFT waterfall and upload texture (do this before ImGui draw calls)
-        if (g_waterfallTex == 0) {
-            glGenTextures(1, &g_waterfallTex);
-            glBindTexture(GL_TEXTURE_2D, g_waterfallTex);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, WATERFALL_WIDTH, WATERFALL_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, g_waterfallPixels.data());
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        }
 
-        int writeIdx = g_scopeWriteIndex.load();
-        std::vector<std::complex<float>> fftIn(FFT_SIZE);
-        for (int i = 0; i < FFT_SIZE; ++i) {
-            int read = (writeIdx - FFT_SIZE + i + SCOPE_BUFFER) % SCOPE_BUFFER;
-            float s = g_leftScopeBuffer[read]; // Use left channel for FFT
-            float w = 0.5f * (1.0f - std::cos(2.0f * M_PI * i / (FFT_SIZE - 1)));
-            fftIn[i] = std::complex<float>(s * w, 0.0f);
-        }
-        fft(fftIn);
-        std::vector<float> mags(WATERFALL_WIDTH);
-        for (int b = 0; b < WATERFALL_WIDTH; ++b) {
-            int idxBin = 1 + (b * (FFT_SIZE/2 - 1)) / WATERFALL_WIDTH;
-            float mag = std::abs(fftIn[idxBin]);
-            mags[b] = 20.0f * std::log10(mag + 1e-6f);
-        }
-        memmove(g_waterfallPixels.data() + 3*WATERFALL_WIDTH, g_waterfallPixels.data(), (WATERFALL_HEIGHT-1)*3*WATERFALL_WIDTH);
-        for (int x = 0; x < WATERFALL_WIDTH; ++x) {
-            unsigned char r,g,b;
-            magToColor(mags[x], r,g,b);
-            g_waterfallPixels[x*3+0] = r;
-            g_waterfallPixels[x*3+1] = g;
-            g_waterfallPixels[x*3+2] = b;
+#ifdef __EMSCRIPTEN__
+        g_spectrum.process(); // no analysis thread on the web build
+#endif
+        // One waterfall row per finished analysis frame (do this before ImGui draw calls)
+        while (g_spectrum.pop(g_spectrumFrame)) {
+            g_spectrumValid = true;
+            g_waterfall.addRow(g_spectrumFrame);
         }
-        glBindTexture(GL_TEXTURE_2D, g_waterfallTex);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WATERFALL_WIDTH, WATERFALL_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, g_waterfallPixels.data());
 
         // Draw oscilloscope, goniometer and waterfall in ImGui window
-        ImGui::Begin("Scope & Spectrum");
-        
-        static std::vector<float> scopeSamplesL(1024);
-        static std::vector<float> scopeSamplesR(1024);
+        bool scopeVisible = ImGui::Begin("Scope & Spectrum");
+        g_scope.enabled.store(scopeVisible, std::memory_order_relaxed); // no capture while collapsed or hidden
+
+        // Twice the display length: the trigger is searched in the older half
+        static std::vector<float> scopeHistoryL(SCOPE_BUFFER);
+        static std::vector<float> scopeHistoryR(SCOPE_BUFFER);
+        static std::vector<float> scopeSamplesL(SCOPE_BUFFER / 2);
+        static std::vector<float> scopeSamplesR(SCOPE_BUFFER / 2);
         int len = (int)scopeSamplesL.size();
-        
-        int triggerRead = -1;
-        int start = (writeIdx - len + SCOPE_BUFFER) % SCOPE_BUFFER;
-        for (int i = 0; i < len - 1; ++i) {
-            int a = (start + i) % SCOPE_BUFFER;
-            int b = (start + i + 1) % SCOPE_BUFFER;
-            float sa = g_leftScopeBuffer[a]; // Trigger on left channel
-            float sb = g_leftScopeBuffer[b];
-            if (g_triggerMode == 0) { if (sa < -0.001f && sb >= -0.001f) { triggerRead = b; break; } }
-            else if (g_triggerMode == 1 || g_triggerMode == 2) {
-                if (g_triggerEdge == 0) { if (sa < g_triggerLevel && sb >= g_triggerLevel) { triggerRead = b; break; } }
-                    else { if (sa > g_triggerLevel && sb <= g_triggerLevel) { triggerRead = b; break; } }
-            } else if (g_triggerMode == 3) {
-                float low = g_triggerLevel - g_triggerHysteresis, high = g_triggerLevel + g_triggerHysteresis;
-                if (g_triggerEdge == 0) { if (sa <= low && sb >= high) { triggerRead = b; break; } }
-                else { if (sa >= high && sb <= low) { triggerRead = b; break; } }
-            }
-        }
-        if (triggerRead == -1) triggerRead = start;
-
-        for (int i = 0; i < len; ++i) {
-            int read = (triggerRead + i) % SCOPE_BUFFER;
-            scopeSamplesL[i] = g_leftScopeBuffer[read];
-            scopeSamplesR[i] = g_rightScopeBuffer[read];
+        for (int tries = 0; tries < SCOPE_READ_TRIES; ++tries) {
+            if (g_scope.readMaster(scopeHistoryL.data(), scopeHistoryR.data(), SCOPE_BUFFER)) break;
         }
+        int triggerRead = findTrigger(scopeHistoryL.data(), len); // Trigger on left channel
+        std::copy_n(scopeHistoryL.begin() + triggerRead, len, scopeSamplesL.begin());
+        std::copy_n(scopeHistoryR.begin() + triggerRead, len, scopeSamplesR.begin());
 
         ImVec2 avail = ImGui::GetContentRegionAvail();
         float halfWidth = avail.x * 0.5f; // Half width for each channel
@@ -1612,8 +1280,8 @@ int main(int argc, char* argv[]) {
         // Per-voice oscilloscopes
         ImGui::Separator();
         ImGui::Text("Voice Oscilloscopes");
-        int numVoices = (int)g_synth.voices.size();
-        int showVoices = std::min(numVoices, MAX_VOICES);
+        int numVoices = g_telemetry.numVoices;
+        int showVoices = std::min(numVoices, ScopeCapture::MAX_VOICES);
 
         // Calculate dynamic grid layout
         float availWidth = ImGui::GetContentRegionAvail().x;
@@ -1629,33 +1297,14 @@ int main(int argc, char* argv[]) {
         for (int vi = 0; vi < showVoices; ++vi) {
             ImGui::BeginGroup();
 
-            std::vector<float> vbuf(SCOPE_VOICE_BUFFER);
-            int w = g_voiceScopeWriteIdx[vi].load();
-            int trigger = -1;
-            int vstart = (w - SCOPE_VOICE_BUFFER + SCOPE_VOICE_BUFFER) % SCOPE_VOICE_BUFFER;
-            for (int j = 0; j < SCOPE_VOICE_BUFFER - 1; ++j) {
-                int a = (vstart + j) % SCOPE_VOICE_BUFFER;
-                int b = (vstart + j + 1) % SCOPE_VOICE_BUFFER;
-                float sa = g_voiceScopeBuffers[vi][a];
-                float sb = g_voiceScopeBuffers[vi][b];
-                if (g_triggerMode == 0) { if (sa < -0.001f && sb >= -0.001f) { trigger = b; break; } }
-                else if (g_triggerMode == 1 || g_triggerMode == 2) {
-                    if (g_triggerEdge == 0) { if (sa < g_triggerLevel && sb >= g_triggerLevel) { trigger = b; break; } }
-                    else { if (sa > g_triggerLevel && sb <= g_triggerLevel) { trigger = b; break; } }
-                } else if (g_triggerMode == 3) {
-                    float low = g_triggerLevel - g_triggerHysteresis, high = g_triggerLevel + g_triggerHysteresis;
-                    if (g_triggerEdge == 0) { if (sa <= low && sb >= high) { trigger = b; break; } }
-                    else { if (sa >= high && sb <= low) { trigger = b; break; } }
-                }
-            }
-            if (trigger == -1) trigger = vstart;
-            for (int i = 0; i < SCOPE_VOICE_BUFFER; ++i) {
-                int read = (trigger + i) % SCOPE_VOICE_BUFFER;
-                vbuf[i] = g_voiceScopeBuffers[vi][read];
+            float vbuf[SCOPE_VOICE_BUFFER * 2];
+            for (int tries = 0; tries < SCOPE_READ_TRIES; ++tries) {
+                if (g_scope.readVoice(vi, vbuf, SCOPE_VOICE_BUFFER * 2)) break;
             }
+            int trigger = findTrigger(vbuf, SCOPE_VOICE_BUFFER);
             char oscId[32];
             snprintf(oscId, sizeof(oscId), "##VoiceOscilloscope%d", vi);
-            ImGui::PlotLines(oscId, vbuf.data(), SCOPE_VOICE_BUFFER, 0, nullptr, -1.0f, 1.0f, ImVec2(plotWidth, 60));
+            ImGui::PlotLines(oscId, vbuf + trigger, SCOPE_VOICE_BUFFER, 0, nullptr, -1.0f, 1.0f, ImVec2(plotWidth, 60));
 
             ImGui::EndGroup();
 
@@ -1680,11 +1329,9 @@ int main(int argc, char* argv[]) {
         float radius = 0.45f * std::min(gonSz.x, gonSz.y);
         ImVec2 prevPt(0,0);
         bool havePrev = false;
-        int goniometerWidx = g_scopeWriteIndex.load();
-        for (int i = 0; i < gSamples; ++i) {
-            int read = (goniometerWidx - gSamples + i + SCOPE_BUFFER) % SCOPE_BUFFER;
-            float L = g_leftScopeBuffer[read];
-            float R = g_rightScopeBuffer[read];
+        for (int i = SCOPE_BUFFER - gSamples; i < SCOPE_BUFFER; ++i) {
+            float L = scopeHistoryL[i];
+            float R = scopeHistoryR[i];
             float px = center.x + L * radius;
             float py = center.y - R * radius;
             ImVec2 pt(px, py);
@@ -1698,7 +1345,45 @@ int main(int argc, char* argv[]) {
         // Spectrum (waterfall)
         ImGui::BeginGroup();
         ImGui::Text("Spectrum (waterfall)");
-        ImGui::Image((void*)(intptr_t)g_waterfallTex, ImVec2((float)WATERFALL_WIDTH, (float)WATERFALL_HEIGHT));
+        g_waterfall.draw((float)WATERFALL_WIDTH, (float)WATERFALL_HEIGHT, g_waterfallRows);
+
+        // Latest frame as curves on a log-frequency axis: left, right, and the louder peak hold
+        ImVec2 specSize((float)WATERFALL_WIDTH, 120.0f);
+        ImVec2 specPos = ImGui::GetCursorScreenPos();
+        ImDrawList* specDraw = ImGui::GetWindowDrawList();
+        specDraw->AddRectFilled(specPos, ImVec2(specPos.x + specSize.x, specPos.y + specSize.y), IM_COL32(20,20,20,255));
+        if (g_spectrumValid) {
+            auto bandY = [&](float db) { return specPos.y + specSize.y * std::clamp(-db / 100.0f, 0.0f, 1.0f); };
+            const ImU32 curveColors[3] = {IM_COL32(100,255,100,220), IM_COL32(255,120,120,220), IM_COL32(255,255,255,140)};
+            for (int curve = 0; curve < 3; ++curve) {
+                ImVec2 prev;
+                for (int b = 0; b < SpectrumAnalyzer::BANDS; ++b) {
+                    float db = curve < 2 ? g_spectrumFrame.average[curve][b]
+                                         : std::max(g_spectrumFrame.peak[0][b], g_spectrumFrame.peak[1][b]);
+                    ImVec2 pt(specPos.x + specSize.x * b / (SpectrumAnalyzer::BANDS - 1), bandY(db));
+                    if (b > 0) specDraw->AddLine(prev, pt, curveColors[curve], 1.0f);
+                    prev = pt;
+                }
+            }
+        }
+        ImGui::Dummy(specSize);
+
+        static int hopChoice = 1;
+        const char* hopLabels[] = {"1/2", "1/4", "1/8"};
+        ImGui::SetNextItemWidth(80.0f);
+        if (ImGui::Combo("Hop", &hopChoice, hopLabels, IM_ARRAYSIZE(hopLabels))) {
+            g_spectrum.hop = SpectrumAnalyzer::FFT_SIZE >> (hopChoice + 1);
+        }
+        ImGui::SameLine();
+        float averaging = g_spectrum.averaging;
+        ImGui::SetNextItemWidth(120.0f);
+        if (ImGui::SliderFloat("Averaging", &averaging, 0.0f, 0.95f)) g_spectrum.averaging = averaging;
+        ImGui::SameLine();
+        float peakDecay = g_spectrum.peakDecayDb;
+        ImGui::SetNextItemWidth(120.0f);
+        if (ImGui::SliderFloat("Peak Fall (dB/s)", &peakDecay, 1.0f, 100.0f, "%.0f")) g_spectrum.peakDecayDb = peakDecay;
+        ImGui::SetNextItemWidth(200.0f);
+        ImGui::SliderInt("History (frames)", &g_waterfallRows, 64, Waterfall::HISTORY);
         ImGui::EndGroup();
 
         ImGui::Separator();
@@ -1706,6 +1391,86 @@ int main(int argc, char* argv[]) {
 
         ImGui::End();
 
+        // Audio callback timing per DSP stage over the last half second
+        if (ImGui::Begin("DSP Profiler")) {
+            const DspReport& r = g_dspReport;
+            if (!DspProfiler::ENABLED) {
+                ImGui::TextUnformatted("Not compiled in (SYNTH_PROFILER=OFF)");
+            } else {
+                ImGui::Text("Buffer %.0f us, load p50 %.1f%%  p99 %.1f%%  max %.1f%%",
+                            r.budgetUs, r.load.p50, r.load.p99, r.load.max);
+                ImGui::ProgressBar(std::min(r.load.p99 / 100.0f, 1.0f), ImVec2(-1.0f, 0.0f), "p99 load");
+                ImGui::Text("Overruns: %llu of %llu callbacks, %llu just now",
+                            (unsigned long long)r.totalOverruns, (unsigned long long)r.totalCallbacks,
+                            (unsigned long long)r.overruns);
+                if (ImGui::BeginTable("DspStages", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+                    ImGui::TableSetupColumn("Stage");
+                    ImGui::TableSetupColumn("p50 (us)");
+                    ImGui::TableSetupColumn("p99 (us)");
+                    ImGui::TableSetupColumn("max (us)");
+                    ImGui::TableHeadersRow();
+                    auto row = [](const char* name, const DspStats& stats) {
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn(); ImGui::TextUnformatted(name);
+                        ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.p50);
+                        ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.p99);
+                        ImGui::TableNextColumn(); ImGui::Text("%.1f", stats.max);
+                    };
+                    for (int s = 0; s < (int)DspStage::Count; ++s) row(dspStageName((DspStage)s), r.stages[s]);
+                    row("callback", r.total);
+                    ImGui::EndTable();
+                }
+
+                // Overload governor: thresholds in percent of the buffer's duration
+                LoadGovernor& governor = g_synth.governor;
+                ImGui::Separator();
+                ImGui::TextUnformatted("Overload governor");
+                bool governorOn = governor.enabled.load();
+                if (ImGui::Checkbox("Enabled", &governorOn)) governor.enabled.store(governorOn);
+                float high = governor.highLoad.load() * 100.0f, low = governor.lowLoad.load() * 100.0f;
+                if (ImGui::SliderFloat("Engage above", &high, 10.0f, 100.0f, "%.0f%%")) {
+                    governor.highLoad.store(high * 0.01f);
+                    if (low > high) governor.lowLoad.store(high * 0.01f);
+                }
+                if (ImGui::SliderFloat("Restore below", &low, 5.0f, 100.0f, "%.0f%%")) {
+                    governor.lowLoad.store(std::min(low, high) * 0.01f);
+                }
+                float cullDb = governor.cullDb.load();
+                if (ImGui::SliderFloat("Cull tails below", &cullDb, -80.0f, -20.0f, "%.0f dB")) governor.cullDb.store(cullDb);
+                const GovernorReport& g = r.governor;
+                ImGui::Text("Engaged: %d of %d actions, %llu tails culled", g.level, (int)GovernorAction::Count,
+                            (unsigned long long)g.voicesCulled);
+                for (int a = 0; a < (int)GovernorAction::Count; ++a) {
+                    bool on = g.level > a && !(a == (int)GovernorAction::Oversampling && g.oversamplingSkipped);
+                    ImGui::Text("  %s%s: engaged %llu, restored %llu", governorActionName((GovernorAction)a),
+                                      on ? " (on)" : "", (unsigned long long)g.engaged[a],
+                                      (unsigned long long)g.restored[a]);
+                }
+            }
+        }
+        ImGui::End();
+
+        // Device period and the latency it gives, measured from the data queued in the stream
+        if (ImGui::Begin("Audio Output")) {
+            static const char* PERIOD_LABELS[] = {"SDL default", "Auto", "64", "128", "256", "512", "1024", "2048"};
+            int current = 0;
+            if (g_audioOutput.setting() == AudioOutput::AUTO) current = 1;
+            for (int p = 0; p < AudioOutput::NUM_PERIODS; ++p) {
+                if (g_audioOutput.setting() == AudioOutput::PERIODS[p]) current = p + 2;
+            }
+            if (ImGui::Combo("Device period", &current, PERIOD_LABELS, IM_ARRAYSIZE(PERIOD_LABELS))) {
+                int setting = current == 0 ? AudioOutput::SDL_DEFAULT
+                            : current == 1 ? AudioOutput::AUTO : AudioOutput::PERIODS[current - 2];
+                if (!g_audioOutput.reopen(setting)) statusMessage = "Could not reopen the audio device";
+            }
+            const LatencyReport& l = g_latency;
+            ImGui::Text("Period %d frames, callback %d frames, %d queued", l.devicePeriod, l.blockFrames, l.queuedFrames);
+            ImGui::Text("Output latency %.1f ms, MIDI to sound %.1f ms", l.outputMs, l.midiToSoundMs);
+            ImGui::Text("Underruns: %llu at this period, %llu in all",
+                        (unsigned long long)l.periodUnderruns, (unsigned long long)l.underruns);
+        }
+        ImGui::End();
+
         // Render
         uint64_t renderStart = SDL_GetPerformanceCounter();
         ImGui::Render();
@@ -1725,8 +1490,21 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Finish a recording that is still running
+    {
+        std::lock_guard<std::mutex> lock(g_synthMutex);
+        g_synth.recorder.stop();
+    }
+    std::string recorderMessage;
+    while (g_synth.recorder.busy()) {
+        if (g_synth.recorder.poll(recorderMessage)) LOG_INFO("%s", recorderMessage.c_str());
+        else std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
     // Save application state on exit
     Preset::save("default_preset.json");
+    Preset::shutdown();
+    g_presetIndex.stop();
 
     // Cleanup - close all MIDI inputs
     for (auto& midi_input : g_midi_inputs) {
@@ -1736,7 +1514,9 @@ int main(int argc, char* argv[]) {
     }
     g_midi_inputs.clear();
     g_midi_port_data.clear();
-    SDL_DestroyAudioStream(audioStream);
+    g_audioOutput.close();
+    g_spectrum.stop();
+    g_waterfall.destroy();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL3_Shutdown();
     ImGui::DestroyContext();
@@ -1745,10 +1525,7 @@ int main(int argc, char* argv[]) {
     SDL_DestroyWindow(window);
     SDL_Quit();
 
-#ifndef __EMSCRIPTEN__
-    g_arpThreadShouldExit = true; // Signal arpeggiator thread to exit
-    arpThread.join(); // Wait for arpeggiator thread to finish
-#endif
+    Log::stop();
 
     return 0;
 }